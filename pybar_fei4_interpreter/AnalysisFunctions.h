@@ -12,6 +12,7 @@
 
 #include "Basis.h"
 #include "defines.h"
+#include "CpuDispatch.h"
 
 // counts from the event number column of the cluster table how often a cluster occurs in every event
 unsigned int getNclusterInEvents(int64_t*& rEventNumber, const unsigned int& rSize, int64_t*& rResultEventNumber, unsigned int*& rResultCount)
@@ -173,10 +174,95 @@ void in1d_sorted(int64_t*& rEventArrayOne, const unsigned int& rSizeArrayOne, in
 }
 
 
+#ifdef __SIMD_HAVE_AVX2
+// AVX2 versions of the index histogramming, check 8 indices at once; they return at the first block with an index out of range
+// and the remaining indices are histogrammed by the baseline version that throws the exception at the correct index
+__SIMD_TARGET_AVX2 unsigned int histogram_1d_avx2(const unsigned int*& x, const unsigned int& rSize, const unsigned int& rNbinsX, uint32_t*& rResult)
+{
+	if (rNbinsX == 0)
+		return 0;
+	const __m256i tMaxX = _mm256_set1_epi32(rNbinsX - 1);
+	unsigned int i = 0;
+	for (; i + 8 <= rSize; i += 8) {
+		__m256i tX = _mm256_loadu_si256((const __m256i*) (x + i));
+		if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(_mm256_min_epu32(tX, tMaxX), tX)) != -1)  // unsigned x <= rNbinsX - 1 for all indices
+			return i;
+		for (unsigned int j = i; j < i + 8; ++j) {
+			if (rResult[x[j]] < 4294967295)
+				++rResult[x[j]];
+			else
+				throw std::out_of_range("The histogram has more than 4294967295 entries per bin. This is not supported.");
+		}
+	}
+	return i;
+}
+
+__SIMD_TARGET_AVX2 unsigned int histogram_2d_avx2(const unsigned int*& x, const unsigned int*& y, const unsigned int& rSize, const unsigned int& rNbinsX, const unsigned int& rNbinsY, uint32_t*& rResult)
+{
+	if (rNbinsX == 0 || rNbinsY == 0)
+		return 0;
+	const __m256i tMaxX = _mm256_set1_epi32(rNbinsX - 1);
+	const __m256i tMaxY = _mm256_set1_epi32(rNbinsY - 1);
+	const __m256i tNbinsY = _mm256_set1_epi32(rNbinsY);
+	unsigned int tIndex[8];
+	unsigned int i = 0;
+	for (; i + 8 <= rSize; i += 8) {
+		__m256i tX = _mm256_loadu_si256((const __m256i*) (x + i));
+		__m256i tY = _mm256_loadu_si256((const __m256i*) (y + i));
+		__m256i tValid = _mm256_and_si256(_mm256_cmpeq_epi32(_mm256_min_epu32(tX, tMaxX), tX), _mm256_cmpeq_epi32(_mm256_min_epu32(tY, tMaxY), tY));
+		if (_mm256_movemask_epi8(tValid) != -1)
+			return i;
+		_mm256_storeu_si256((__m256i*) tIndex, _mm256_add_epi32(_mm256_mullo_epi32(tX, tNbinsY), tY));  // x * rNbinsY + y
+		for (unsigned int j = 0; j < 8; ++j) {
+			if (rResult[tIndex[j]] < 4294967295)
+				++rResult[tIndex[j]];
+			else
+				throw std::out_of_range("The histogram has more than 4294967295 entries per bin. This is not supported.");
+		}
+	}
+	return i;
+}
+
+__SIMD_TARGET_AVX2 unsigned int histogram_3d_avx2(const unsigned int*& x, const unsigned int*& y, const unsigned int*& z, const unsigned int& rSize, const unsigned int& rNbinsX, const unsigned int& rNbinsY, const unsigned int& rNbinsZ, uint32_t*& rResult)
+{
+	if (rNbinsX == 0 || rNbinsY == 0 || rNbinsZ == 0)
+		return 0;
+	const __m256i tMaxX = _mm256_set1_epi32(rNbinsX - 1);
+	const __m256i tMaxY = _mm256_set1_epi32(rNbinsY - 1);
+	const __m256i tMaxZ = _mm256_set1_epi32(rNbinsZ - 1);
+	const __m256i tNbinsYZ = _mm256_set1_epi32(rNbinsY * rNbinsZ);
+	const __m256i tNbinsZ = _mm256_set1_epi32(rNbinsZ);
+	unsigned int tIndex[8];
+	unsigned int i = 0;
+	for (; i + 8 <= rSize; i += 8) {
+		__m256i tX = _mm256_loadu_si256((const __m256i*) (x + i));
+		__m256i tY = _mm256_loadu_si256((const __m256i*) (y + i));
+		__m256i tZ = _mm256_loadu_si256((const __m256i*) (z + i));
+		__m256i tValid = _mm256_and_si256(_mm256_cmpeq_epi32(_mm256_min_epu32(tX, tMaxX), tX), _mm256_cmpeq_epi32(_mm256_min_epu32(tY, tMaxY), tY));
+		tValid = _mm256_and_si256(tValid, _mm256_cmpeq_epi32(_mm256_min_epu32(tZ, tMaxZ), tZ));
+		if (_mm256_movemask_epi8(tValid) != -1)
+			return i;
+		_mm256_storeu_si256((__m256i*) tIndex, _mm256_add_epi32(_mm256_add_epi32(_mm256_mullo_epi32(tX, tNbinsYZ), _mm256_mullo_epi32(tY, tNbinsZ)), tZ));  // x * rNbinsY * rNbinsZ + y * rNbinsZ + z
+		for (unsigned int j = 0; j < 8; ++j) {
+			if (rResult[tIndex[j]] < 4294967295)
+				++rResult[tIndex[j]];
+			else
+				throw std::out_of_range("The histogram has more than 4294967295 entries per bin. This is not supported.");
+		}
+	}
+	return i;
+}
+#endif
+
 // fast 1d index histogramming (bin size = 1, values starting from 0)
 void histogram_1d(const unsigned int*& x, const unsigned int& rSize, const unsigned int& rNbinsX, uint32_t*& rResult)
 {
-	for (unsigned int i = 0; i < rSize; ++i) {
+	unsigned int i = 0;
+#ifdef __SIMD_HAVE_AVX2
+	if (getSimdLevel() >= __SIMD_AVX2)
+		i = histogram_1d_avx2(x, rSize, rNbinsX, rResult);
+#endif
+	for (; i < rSize; ++i) {
 		if (x[i] >= rNbinsX)
 			throw std::out_of_range("The histogram indices are out of range");
 		if (rResult[x[i]] < 4294967295)
@@ -190,7 +276,12 @@ void histogram_1d(const unsigned int*& x, const unsigned int& rSize, const unsig
 // fast 2d index histogramming (bin size = 1, values starting from 0)
 void histogram_2d(const unsigned int*& x, const unsigned int*& y, const unsigned int& rSize, const unsigned int& rNbinsX, const unsigned int& rNbinsY, uint32_t*& rResult)
 {
-	for (unsigned int i = 0; i < rSize; ++i) {
+	unsigned int i = 0;
+#ifdef __SIMD_HAVE_AVX2
+	if (getSimdLevel() >= __SIMD_AVX2)
+		i = histogram_2d_avx2(x, y, rSize, rNbinsX, rNbinsY, rResult);
+#endif
+	for (; i < rSize; ++i) {
 		if (x[i] >= rNbinsX || y[i] >= rNbinsY)
 			throw std::out_of_range("The histogram indices are out of range");
 		if (rResult[x[i] * rNbinsY + y[i]] < 4294967295)
@@ -203,7 +294,12 @@ void histogram_2d(const unsigned int*& x, const unsigned int*& y, const unsigned
 // fast 3d index histogramming (bin size = 1, values starting from 0)
 void histogram_3d(const unsigned int*& x, const unsigned int*& y, const unsigned int*& z, const unsigned int& rSize, const unsigned int& rNbinsX, const unsigned int& rNbinsY, const unsigned int& rNbinsZ, uint32_t*& rResult)
 {
-	for (unsigned int i = 0; i < rSize; ++i) {
+	unsigned int i = 0;
+#ifdef __SIMD_HAVE_AVX2
+	if (getSimdLevel() >= __SIMD_AVX2)
+		i = histogram_3d_avx2(x, y, z, rSize, rNbinsX, rNbinsY, rNbinsZ, rResult);
+#endif
+	for (; i < rSize; ++i) {
 		if (x[i] >= rNbinsX || y[i] >= rNbinsY || z[i] >= rNbinsZ) {
 			std::stringstream errorString;
 			errorString<<"The histogram indices (x/y/z)=("<<x[i]<<"/"<<y[i]<<"/"<<z[i]<<") are out of range.";
@@ -0,0 +1,87 @@
+#pragma once
+// run time detection of the SIMD instruction sets, the extensions are compiled for the baseline architecture
+// and the kernels that profit from newer instruction sets are compiled additionally for these and selected with cpuid
+#include <string>
+#include <cstdlib>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#endif
+
+// instruction set levels of the kernel versions
+const unsigned int __SIMD_BASELINE=0;  // plain C++ code
+const unsigned int __SIMD_SSE2=1;  // SSE2, always available on x86-64
+const unsigned int __SIMD_AVX2=2;  // AVX2, selected at run time
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define __SIMD_HAVE_SSE2
+#include <emmintrin.h>
+#endif
+
+// AVX2 kernels are compiled per function without changing the architecture flags of the extension
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define __SIMD_HAVE_AVX2
+#define __SIMD_TARGET_AVX2 __attribute__((target("avx2")))
+#define __SIMD_FORCE_INLINE inline __attribute__((always_inline))
+#include <immintrin.h>
+#elif defined(_MSC_VER) && _MSC_VER >= 1700 && (defined(_M_X64) || defined(_M_IX86))  // MSVC++ 11 (2012) provides the AVX2 intrinsics without /arch flag
+#define __SIMD_HAVE_AVX2
+#define __SIMD_TARGET_AVX2
+#define __SIMD_FORCE_INLINE __forceinline
+#include <immintrin.h>
+#else
+#define __SIMD_TARGET_AVX2
+#define __SIMD_FORCE_INLINE inline
+#endif
+
+// returns the highest instruction set level supported by the CPU and the operating system
+inline unsigned int detectSimdLevel()
+{
+  unsigned int tLevel = __SIMD_BASELINE;
+#ifdef __SIMD_HAVE_SSE2
+  tLevel = __SIMD_SSE2;
+#endif
+#if defined(__SIMD_HAVE_AVX2) && defined(_MSC_VER)
+  int tCpuInfo[4];
+  __cpuid(tCpuInfo, 0);
+  if (tCpuInfo[0] >= 7) {
+    __cpuid(tCpuInfo, 1);
+    bool tOsSavesYmm = ((tCpuInfo[2] & (1 << 27)) != 0) && ((tCpuInfo[2] & (1 << 28)) != 0) && ((_xgetbv(0) & 0x6) == 0x6);  // OSXSAVE, AVX and YMM state enabled by the OS
+    __cpuidex(tCpuInfo, 7, 0);
+    if (tOsSavesYmm && (tCpuInfo[1] & (1 << 5)) != 0)  // AVX2
+      tLevel = __SIMD_AVX2;
+  }
+#elif defined(__SIMD_HAVE_AVX2)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))  // also checks the OS support
+    tLevel = __SIMD_AVX2;
+#endif
+  const char* tMaxLevel = std::getenv("PYBAR_FEI4_INTERPRETER_SIMD");  // allows to restrict the kernel versions, e.g. for comparisons
+  if (tMaxLevel != 0) {
+    std::string tMaxLevelName(tMaxLevel);
+    if (tMaxLevelName == "baseline")
+      tLevel = __SIMD_BASELINE;
+    else if (tMaxLevelName == "sse2" && tLevel > __SIMD_SSE2)
+      tLevel = __SIMD_SSE2;
+  }
+  return tLevel;
+}
+
+// returns the instruction set level of the active kernel versions, determined once at import time
+inline unsigned int getSimdLevel()
+{
+  static const unsigned int tLevel = detectSimdLevel();
+  return tLevel;
+}
+
+inline std::string getSimdLevelName(const unsigned int& rLevel)
+{
+  switch (rLevel) {
+    case __SIMD_AVX2:
+      return "AVX2";
+    case __SIMD_SSE2:
+      return "SSE2";
+    default:
+      return "baseline";
+  }
+}
@@ -4,12 +4,15 @@ Histogram::Histogram(void)
 {
   setSourceFileName("Histogram()");
 //  setDebugOutput(true);
+  _simdLevel = getSimdLevel();
   setStandardSettings();
 }
 
 Histogram::~Histogram(void)
 {
   debug("~Histogram()");
+  for (size_t i = 0; i < _chunkHistograms.size(); ++i)
+    delete _chunkHistograms[i];
   deleteOccupancyArray();
   deleteTotArray();
   deleteTdcValueArray();
@@ -27,14 +30,24 @@ void Histogram::setStandardSettings()
   _parInfo = 0;
   _lastMetaEventIndex = 0;
   _metaEventIndex = 0;
+  _nMetaEventIndexLength = 0;
+  _nMetaEventIndexSet = 0;
   _occupancy = 0;
+  _cumulatedOccupancy = 0;
+  _nThresholdScanSteps = 0;
   _relBcid = 0;
   _tot = 0;
+  _totSum = 0;
+  _totSquareSum = 0;
   _meanTot = 0;
+  _rmsTot = 0;
   _tdcValue = 0;
   _tdcTriggerDistance = 0;
   _totPixel = 0;
   _tdcPixel = 0;
+  _tdcPixelMinTdc = 0;
+  _tdcPixelBinWidth = 1;
+  _nTdcPixelBins = __N_TDC_VALUES;
   _NparameterValues = 1;
   _createOccHist = false;
   _createRelBCIDhist = false;
@@ -45,6 +58,21 @@ void Histogram::setStandardSettings()
   _createTdcPixelHist = false;
   _createTotPixelHist = false;
   _maxTot = 13;
+  _nThreads = 1;
+  _minHitsPerThread = __PARALLEL_MIN_HITS;
+  _sparseReset = false;
+  _fillSequence = 0;
+  _fillDepth = 0;
+  _fillingThread = getCurrentThreadId();
+  _snapshotState = __SNAPSHOT_IDLE;
+  _snapshotNparameterValues = 0;
+  _snapshotNtdcPixelBins = 0;
+  _nTimeSlices = 0;
+  _timeSliceLength = 0;
+  _metaInfoV2 = 0;
+  _nMetaInfoV2Length = 0;
+  _actualTimeSlice.nHits = 0;
+  _actualTimeSliceReadOut = 0;
 }
 
 void Histogram::createOccupancyHist(bool createOccHist)
@@ -134,9 +162,164 @@ void Histogram::setMaxTot(const unsigned int& rMaxTot)
   _maxTot = rMaxTot;
 }
 
+void Histogram::setTdcPixelHistRange(const unsigned int& rMinTdc, const unsigned int& rMaxTdc, const unsigned int& rTdcBinWidth)
+{
+  info("setTdcPixelHistRange(...)");
+  if (rMinTdc >= rMaxTdc || rMaxTdc > __N_TDC_VALUES || rTdcBinWidth == 0)
+    throw std::invalid_argument("TDC pixel histogram range has to be within 0 and " + IntToStr(__N_TDC_VALUES) + " with a bin width > 0.");
+  _tdcPixelMinTdc = rMinTdc;
+  _tdcPixelBinWidth = rTdcBinWidth;
+  _nTdcPixelBins = (rMaxTdc - rMinTdc + rTdcBinWidth - 1) / rTdcBinWidth;
+  if (_tdcPixel != 0)  // the dense histogram has the old number of bins
+    delete[] _tdcPixel;
+  _tdcPixel = 0;
+  resetTdcPixelArray();
+}
+
+void Histogram::setSparseReset(bool rSparseReset)
+{
+  info("setSparseReset(...)");
+  if (rSparseReset && !_sparseReset) {  // the blocks filled before are not known
+    std::fill(_occupancyFilledBlocks.begin(), _occupancyFilledBlocks.end(), 1);
+    std::fill(_totSumFilledBlocks.begin(), _totSumFilledBlocks.end(), 1);
+    std::fill(_totPixelFilledBlocks.begin(), _totPixelFilledBlocks.end(), 1);
+  }
+  _sparseReset = rSparseReset;
+}
+
+void Histogram::markFilledBlocks(std::vector<unsigned char>& rFilledBlocks, const size_t& rFirstBin, const size_t& rNbins)
+{
+  std::fill(rFilledBlocks.begin() + rFirstBin / __RESET_BLOCK_SIZE, rFilledBlocks.begin() + (rFirstBin + rNbins + __RESET_BLOCK_SIZE - 1) / __RESET_BLOCK_SIZE, 1);
+}
+
+template<typename T> void Histogram::resetArray(T* pArray, const size_t& rNbins, const std::vector<unsigned char>& rFilledBlocks, const bool& rSparseReset)
+{
+  if (!rSparseReset) {
+    std::fill(pArray, pArray + rNbins, (T) 0);  // contiguous, compiled to a memset
+    return;
+  }
+  for (size_t i = 0; i < rFilledBlocks.size(); ++i)
+    if (rFilledBlocks[i] != 0)
+      std::fill(pArray + i * __RESET_BLOCK_SIZE, pArray + std::min((i + 1) * __RESET_BLOCK_SIZE, rNbins), (T) 0);
+}
+
+template<typename T> void Histogram::addArray(T* pArray, const T* pOtherArray, const size_t& rNbins, std::vector<unsigned char>& rFilledBlocks, const std::vector<unsigned char>& rOtherFilledBlocks, const bool& rSparseReset)
+{
+  if (!rSparseReset) {
+    for (size_t i = 0; i < rNbins; ++i)
+      pArray[i] += pOtherArray[i];
+    return;
+  }
+  for (size_t i = 0; i < rOtherFilledBlocks.size(); ++i) {
+    if (rOtherFilledBlocks[i] != 0) {
+      for (size_t j = i * __RESET_BLOCK_SIZE; j < std::min((i + 1) * __RESET_BLOCK_SIZE, rNbins); ++j)
+        pArray[j] += pOtherArray[j];
+      rFilledBlocks[i] = 1;
+    }
+  }
+}
+
+void Histogram::setNthreads(const unsigned int& rNthreads, const unsigned int& rMinHitsPerThread)
+{
+  info("setNthreads(...) with " + IntToStr(rNthreads) + " threads");
+  _nThreads = rNthreads > 0 ? rNthreads : getNumberOfCores();
+  _minHitsPerThread = std::max(rMinHitsPerThread, 1u);
+}
+
 void Histogram::addHits(HitInfo*& rHitInfo, const unsigned int& rNhits)
 {
   debug("addHits()");
+  FillGuard tFillGuard(*this);
+  updateMetaEventIndex();
+  unsigned int tNchunks = std::min(_nThreads, rNhits / _minHitsPerThread);
+  if (tNchunks > 1)
+    addHitsParallel(rHitInfo, rNhits, tNchunks);
+  else
+    addHitsSerial(rHitInfo, rNhits);
+}
+
+void Histogram::addHitsSerial(HitInfo*& rHitInfo, const unsigned int& rNhits)
+{
+#ifdef __SIMD_HAVE_AVX2
+  if (_simdLevel >= __SIMD_AVX2) {
+    addHitsAvx2(rHitInfo, rNhits);
+    return;
+  }
+#endif
+  addHitsBaseline(rHitInfo, rNhits);
+}
+
+void Histogram::addHitsBaseline(HitInfo*& rHitInfo, const unsigned int& rNhits)
+{
+  addHitsKernel(rHitInfo, rNhits);
+}
+
+#ifdef __SIMD_HAVE_AVX2
+// the values of 8 hits are gathered from the packed hit structs and checked at once, virtual hits are skipped; at the first block with a value
+// out of range the remaining hits are histogrammed by the kernel that throws the exception at the correct hit
+void Histogram::addHitsAvx2(HitInfo*& rHitInfo, const unsigned int& rNhits)
+{
+  const __m256i tOffsets = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32((int) sizeof(HitInfo)));
+  const __m256i tZero = _mm256_setzero_si256();
+  const __m256i tByteMask = _mm256_set1_epi32(0xFF);
+  const __m256i tShortMask = _mm256_set1_epi32(0xFFFF);
+  const __m256i tNoHit = _mm256_set1_epi32(__NO_HIT);
+  const __m256i tMaxColumnIndex = _mm256_set1_epi32(RAW_DATA_MAX_COLUMN - 1);
+  const __m256i tMaxRowIndex = _mm256_set1_epi32(RAW_DATA_MAX_ROW - 1);
+  const __m256i tMaxTot = _mm256_set1_epi32(__MAXHITTOT);
+  const __m256i tMaxTdc = _mm256_set1_epi32(__N_TDC_VALUES - 1);
+  const __m256i tMaxTdcTriggerDistance = _mm256_set1_epi32(__N_TDC_TRG_DIST_VALUES - 1);
+  const __m256i tMaxRelBcid = _mm256_set1_epi32(__MAXBCID - 1);
+  unsigned int tColumnIndex[8], tRowIndex[8], tTot[8], tRelBcid[8], tTdc[8], tTdcTriggerDistance[8];
+  unsigned int i = 0;
+  for (; i + 8 <= rNhits; i += 8) {
+    const char* tHits = (const char*) (rHitInfo + i);
+    // 32 bit gathers of neighbouring members, the event status is the last member and is read with the two bytes in front of it
+    __m256i tRelBcidColumn = _mm256_i32gather_epi32((const int*) (tHits + offsetof(HitInfo, relative_BCID)), tOffsets, 1);
+    __m256i tRowTot = _mm256_i32gather_epi32((const int*) (tHits + offsetof(HitInfo, row)), tOffsets, 1);
+    __m256i tTdcWord = _mm256_i32gather_epi32((const int*) (tHits + offsetof(HitInfo, TDC)), tOffsets, 1);
+    __m256i tTdcTriggerDistanceWord = _mm256_i32gather_epi32((const int*) (tHits + offsetof(HitInfo, TDC_trigger_distance)), tOffsets, 1);
+    __m256i tEventStatusWord = _mm256_i32gather_epi32((const int*) (tHits + offsetof(HitInfo, event_status) - 2), tOffsets, 1);
+    __m256i tColumn = _mm256_and_si256(_mm256_srli_epi32(tRelBcidColumn, 8 * (offsetof(HitInfo, column) - offsetof(HitInfo, relative_BCID))), tByteMask);
+    __m256i tRow = _mm256_and_si256(tRowTot, tShortMask);
+    __m256i tTotValues = _mm256_and_si256(_mm256_srli_epi32(tRowTot, 8 * (offsetof(HitInfo, tot) - offsetof(HitInfo, row))), tByteMask);
+    __m256i tRelBcidValues = _mm256_and_si256(tRelBcidColumn, tByteMask);
+    __m256i tTdcValues = _mm256_and_si256(tTdcWord, tShortMask);
+    __m256i tTdcTriggerDistanceValues = _mm256_and_si256(tTdcTriggerDistanceWord, tByteMask);
+    __m256i tEventStatus = _mm256_srli_epi32(tEventStatusWord, 16);
+
+    // virtual hits have the no hit status or column/row 0
+    __m256i tVirtual = _mm256_or_si256(_mm256_cmpeq_epi32(_mm256_and_si256(tEventStatus, tNoHit), tNoHit), _mm256_or_si256(_mm256_cmpeq_epi32(tColumn, tZero), _mm256_cmpeq_epi32(tRow, tZero)));
+    __m256i tColumnIndexValues = _mm256_sub_epi32(tColumn, _mm256_set1_epi32(1));
+    __m256i tRowIndexValues = _mm256_sub_epi32(tRow, _mm256_set1_epi32(1));
+    __m256i tInRange = _mm256_cmpeq_epi32(_mm256_min_epu32(tColumnIndexValues, tMaxColumnIndex), tColumnIndexValues);  // unsigned value <= maximum
+    tInRange = _mm256_and_si256(tInRange, _mm256_cmpeq_epi32(_mm256_min_epu32(tRowIndexValues, tMaxRowIndex), tRowIndexValues));
+    tInRange = _mm256_and_si256(tInRange, _mm256_cmpeq_epi32(_mm256_min_epu32(tTotValues, tMaxTot), tTotValues));
+    tInRange = _mm256_and_si256(tInRange, _mm256_cmpeq_epi32(_mm256_min_epu32(tTdcValues, tMaxTdc), tTdcValues));
+    tInRange = _mm256_and_si256(tInRange, _mm256_cmpeq_epi32(_mm256_min_epu32(tTdcTriggerDistanceValues, tMaxTdcTriggerDistance), tTdcTriggerDistanceValues));
+    tInRange = _mm256_and_si256(tInRange, _mm256_cmpeq_epi32(_mm256_min_epu32(tRelBcidValues, tMaxRelBcid), tRelBcidValues));
+    if (_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_or_si256(tInRange, tVirtual))) != 0xFF)
+      break;
+
+    _mm256_storeu_si256((__m256i*) tColumnIndex, tColumnIndexValues);
+    _mm256_storeu_si256((__m256i*) tRowIndex, tRowIndexValues);
+    _mm256_storeu_si256((__m256i*) tTot, tTotValues);
+    _mm256_storeu_si256((__m256i*) tRelBcid, tRelBcidValues);
+    _mm256_storeu_si256((__m256i*) tTdc, tTdcValues);
+    _mm256_storeu_si256((__m256i*) tTdcTriggerDistance, tTdcTriggerDistanceValues);
+    int tVirtualHits = _mm256_movemask_ps(_mm256_castsi256_ps(tVirtual));
+    for (unsigned int j = 0; j < 8; ++j) {
+      if ((tVirtualHits & (1 << j)) == 0)
+        addCheckedHit(rHitInfo[i + j], tColumnIndex[j], tRowIndex[j], tTot[j], tRelBcid[j], tTdc[j], tTdcTriggerDistance[j]);
+    }
+  }
+  HitInfo* tRemainingHits = rHitInfo + i;
+  addHitsKernel(tRemainingHits, rNhits - i);
+}
+#endif
+
+void Histogram::addHitsKernel(HitInfo*& rHitInfo, const unsigned int& rNhits)
+{
   for (unsigned int i = 0; i<rNhits; ++i) {
     if (((rHitInfo[i].event_status & __NO_HIT) == __NO_HIT) || (rHitInfo[i].column == 0) || (rHitInfo[i].row == 0))  // ignore virtual hits
       continue;
@@ -158,61 +341,222 @@ void Histogram::addHits(HitInfo*& rHitInfo, const unsigned int& rNhits)
     unsigned int tRelBcid = rHitInfo[i].relative_BCID;
     if (tRelBcid >= __MAXBCID)
       throw std::out_of_range("Relative BCID index out of range.");
+    addCheckedHit(rHitInfo[i], tColumnIndex, tRowIndex, tTot, tRelBcid, tTdc, tTdcTriggerDistance);
+  }
+}
 
-    unsigned int tParIndex = getParIndex(rHitInfo[i].event_number);
+void Histogram::addCheckedHit(HitInfo& rHit, const unsigned int& rColumnIndex, const unsigned int& rRowIndex, const unsigned int& rTot, const unsigned int& rRelBcid, const unsigned int& rTdc, const unsigned int& rTdcTriggerDistance)
+{
+  unsigned int tParIndex = getParIndex(rHit.event_number);
 
-    if (tParIndex >= getNparameters()) {
-      error("addHits: tParIndex "+IntToStr(tParIndex)+"\t> "+IntToStr(_NparameterValues));
-      throw std::out_of_range("Parameter index out of range.");
+  if (tParIndex >= getNparameters()) {
+    error("addHits: tParIndex "+IntToStr(tParIndex)+"\t> "+IntToStr(_NparameterValues));
+    throw std::out_of_range("Parameter index out of range.");
+  }
+  fillHit(rColumnIndex, rRowIndex, rTot, rRelBcid, rHit.event_status, rTdc, rTdcTriggerDistance, tParIndex);
+  if (_nTimeSlices > 0 && rTot <= _maxTot)
+    addTimeSliceHit(rColumnIndex + rRowIndex * RAW_DATA_MAX_COLUMN, rTot, getEventReadOut(rHit.event_number));
+}
+
+void Histogram::addHitsParallel(HitInfo*& rHitInfo, const unsigned int& rNhits, const unsigned int& rNchunks)
+{
+  if (Basis::infoSet())
+    info("addHitsParallel: " + IntToStr(rNhits) + " hits in " + IntToStr(rNchunks) + " chunks");
+  while (_chunkHistograms.size() < rNchunks - 1)
+    _chunkHistograms.push_back(new Histogram());
+  std::vector<ParallelChunk> tChunks(rNchunks);
+  for (unsigned int i = 0; i < rNchunks; ++i) {
+    ParallelChunk& rChunk = tChunks[i];
+    rChunk.histogram = i == 0 ? this : _chunkHistograms[i - 1];
+    rChunk.hits = rHitInfo + (size_t) ((uint64_t) rNhits * i / rNchunks);
+    rChunk.nHits = (unsigned int) ((uint64_t) rNhits * (i + 1) / rNchunks - (uint64_t) rNhits * i / rNchunks);
+    rChunk.outOfRange = false;
+    if (i > 0)
+      rChunk.histogram->copySettings(*this);
+  }
+
+  runParallel(&Histogram::addHitsParallelChunk, tChunks);  // the first chunk is histogrammed into this histogram in the calling thread
+
+  for (unsigned int i = 0; i < rNchunks; ++i) {  // add the chunk histograms in order up to the first failing chunk, then the histograms are the same as for the serial histogramming
+    if (i > 0) {
+      addChunkHistograms(*tChunks[i].histogram);
+      _lastMetaEventIndex = tChunks[i].histogram->_lastMetaEventIndex;
     }
-    if (_createOccHist) {
-      if (tTot <= _maxTot) {
-        if (_occupancy!=0) {
-          _occupancy[(size_t)tColumnIndex + (size_t)tRowIndex * (size_t)RAW_DATA_MAX_COLUMN + (size_t)tParIndex * (size_t)RAW_DATA_MAX_COLUMN * (size_t)RAW_DATA_MAX_ROW] += 1;
+    if (!tChunks[i].error.empty()) {
+      if (tChunks[i].outOfRange)
+        throw std::out_of_range(tChunks[i].error);
+      throw std::runtime_error(tChunks[i].error);
+    }
+  }
+}
+
+void Histogram::addHitsParallelChunk(ParallelChunk& rChunk)
+{
+  try {
+    rChunk.histogram->addHitsSerial(rChunk.hits, rChunk.nHits);
+    rChunk.histogram->closeTimeSlice();  // the slices of the chunk are added to the history
+  } catch (std::out_of_range& exception) {
+    rChunk.error = exception.what();
+    rChunk.outOfRange = true;
+  } catch (std::exception& exception) {
+    rChunk.error = exception.what();
+  }
+}
+
+void Histogram::copySettings(const Histogram& rHistogram)
+{
+  _maxTot = rHistogram._maxTot;
+  _parInfo = rHistogram._parInfo;
+  _nParInfoLength = rHistogram._nParInfoLength;
+  _metaEventIndex = rHistogram._metaEventIndex;
+  _nMetaEventIndexLength = rHistogram._nMetaEventIndexLength;
+  _nMetaEventIndexSet = rHistogram._nMetaEventIndexSet;
+  _lastMetaEventIndex = rHistogram._lastMetaEventIndex;
+  setSparseReset(rHistogram._sparseReset);  // the arrays are kept between the calls, only their filled blocks are reset and added
+  _createOccHist = rHistogram._createOccHist;
+  bool tNewParameters = _NparameterValues != rHistogram._NparameterValues;
+  _NparameterValues = rHistogram._NparameterValues;
+  if (rHistogram._occupancy == 0)
+    deleteOccupancyArray();
+  else if (_occupancy == 0 || tNewParameters)
+    allocateOccupancyArray();
+  resetOccupancyArray();
+  createRelBCIDHist(rHistogram._relBcid != 0);
+  createTotHist(rHistogram._tot != 0);
+  createTdcValueHist(rHistogram._tdcValue != 0);
+  createTdcTriggerDistanceHist(rHistogram._tdcTriggerDistance != 0);
+  _createTotPixelHist = rHistogram._createTotPixelHist;
+  if (rHistogram._totPixel == 0)
+    deleteTotPixelArray();
+  else if (_totPixel == 0)
+    allocateTotPixelArray();
+  resetTotPixelArray();
+  _tdcPixelMinTdc = rHistogram._tdcPixelMinTdc;
+  _tdcPixelBinWidth = rHistogram._tdcPixelBinWidth;
+  _nTdcPixelBins = rHistogram._nTdcPixelBins;
+  createTdcPixelHist(!rHistogram._tdcPixelBins.empty());
+  if (rHistogram._totSum == 0)
+    deleteMeanTotArray();
+  else if (_totSum == 0 || tNewParameters)
+    allocateMeanTotArray();
+  resetMeanTotArray();
+  _createMeanTotHist = rHistogram._createMeanTotHist;
+  _createRelBCIDhist = rHistogram._createRelBCIDhist;
+  _createTotHist = rHistogram._createTotHist;
+  _createTdcValueHist = rHistogram._createTdcValueHist;
+  _createTdcTriggerDistanceHist = rHistogram._createTdcTriggerDistanceHist;
+  _createTdcPixelHist = rHistogram._createTdcPixelHist;
+  _metaInfoV2 = rHistogram._metaInfoV2;
+  _nMetaInfoV2Length = rHistogram._nMetaInfoV2Length;
+  setTimeSlices(rHistogram._nTimeSlices, rHistogram._timeSliceLength);
+}
+
+void Histogram::addChunkHistograms(const Histogram& rHistogram)
+{
+  if (_occupancy != 0 && rHistogram._occupancy != 0)
+    addArray(_occupancy, rHistogram._occupancy, (size_t)RAW_DATA_MAX_COLUMN * (size_t)RAW_DATA_MAX_ROW * (size_t)_NparameterValues, _occupancyFilledBlocks, rHistogram._occupancyFilledBlocks, _sparseReset);
+  if (_totSum != 0 && rHistogram._totSum != 0) {  // both sums mark the same blocks
+    addArray(_totSum, rHistogram._totSum, (size_t)RAW_DATA_MAX_COLUMN * (size_t)RAW_DATA_MAX_ROW * (size_t)_NparameterValues, _totSumFilledBlocks, rHistogram._totSumFilledBlocks, _sparseReset);
+    addArray(_totSquareSum, rHistogram._totSquareSum, (size_t)RAW_DATA_MAX_COLUMN * (size_t)RAW_DATA_MAX_ROW * (size_t)_NparameterValues, _totSumFilledBlocks, rHistogram._totSumFilledBlocks, _sparseReset);
+  }
+  if (_relBcid != 0 && rHistogram._relBcid != 0)
+    for (size_t i = 0; i < __MAXBCID; ++i)
+      _relBcid[i] += rHistogram._relBcid[i];
+  if (_tot != 0 && rHistogram._tot != 0)
+    for (size_t i = 0; i <= __MAXHITTOT; ++i)
+      _tot[i] += rHistogram._tot[i];
+  if (_tdcValue != 0 && rHistogram._tdcValue != 0)
+    for (size_t i = 0; i < __N_TDC_VALUES; ++i)
+      _tdcValue[i] += rHistogram._tdcValue[i];
+  if (_tdcTriggerDistance != 0 && rHistogram._tdcTriggerDistance != 0)
+    for (size_t i = 0; i < __N_TDC_TRG_DIST_VALUES; ++i)
+      _tdcTriggerDistance[i] += rHistogram._tdcTriggerDistance[i];
+  if (_totPixel != 0 && rHistogram._totPixel != 0)
+    addArray(_totPixel, rHistogram._totPixel, (size_t)RAW_DATA_MAX_COLUMN * (size_t)RAW_DATA_MAX_ROW * ((size_t)__MAXHITTOT + 1), _totPixelFilledBlocks, rHistogram._totPixelFilledBlocks, _sparseReset);
+  if (!_tdcPixelBins.empty() && !rHistogram._tdcPixelBins.empty())
+    for (size_t i = 0; i < _tdcPixelBins.size(); ++i)
+      addTdcPixelBins(_tdcPixelBins[i], rHistogram._tdcPixelBins[i]);
+  if (_nTimeSlices > 0) {
+    for (size_t i = 0; i < rHistogram._timeSlices.size(); ++i)
+      addTimeSlice(rHistogram._timeSlices[i]);
+  }
+}
+
+void Histogram::addEventHits(const HitInfo* pHits, const unsigned int& rNhits, const EventInfo& rEventInfo, const unsigned int& rReadOutIndex)
+{
+  if (rNhits == 0 || (rEventInfo.event_status & __NO_HIT) == __NO_HIT)  // ignore virtual hits
+    return;
+  unsigned int tParIndex = getReadOutParIndex(rReadOutIndex);
+  for (unsigned int i = 0; i < rNhits; ++i) {  // the ToT and relative BCID of the interpreter hits are in range, the TDC values are limited by the data types
+    unsigned int tColumnIndex = pHits[i].column - 1;
+    if (tColumnIndex > RAW_DATA_MAX_COLUMN-1)
+      throw std::out_of_range("Column index out of range.");
+    unsigned int tRowIndex = pHits[i].row - 1;
+    if (tRowIndex > RAW_DATA_MAX_ROW-1)  // the second hit of a data record in the last row with TOT2 = 15 is in row 337 if the maximum ToT is 15
+      throw std::out_of_range("Row index out of range.");
+    fillHit(tColumnIndex, tRowIndex, pHits[i].tot, pHits[i].relative_BCID, rEventInfo.event_status, rEventInfo.TDC, rEventInfo.TDC_trigger_distance, tParIndex);
+    if (_nTimeSlices > 0 && pHits[i].tot <= _maxTot)
+      addTimeSliceHit(tColumnIndex + tRowIndex * RAW_DATA_MAX_COLUMN, pHits[i].tot, rReadOutIndex);
+  }
+}
+
+void Histogram::fillHit(const unsigned int& rColumnIndex, const unsigned int& rRowIndex, const unsigned int& rTot, const unsigned int& rRelBcid, const unsigned short& rEventStatus, const unsigned int& rTdc, const unsigned int& rTdcTriggerDistance, const unsigned int& rParIndex)
+{
+  if (_createOccHist) {
+    if (rTot <= _maxTot) {
+      size_t tIndex = (size_t)rColumnIndex + (size_t)rRowIndex * (size_t)RAW_DATA_MAX_COLUMN + (size_t)rParIndex * (size_t)RAW_DATA_MAX_COLUMN * (size_t)RAW_DATA_MAX_ROW;
+      if (_occupancy!=0) {
+        _occupancy[tIndex] += 1;
+        if (_sparseReset)
+          _occupancyFilledBlocks[tIndex / __RESET_BLOCK_SIZE] = 1;
+      } else {
+        throw std::runtime_error("Occupancy array not initialized. Set scan parameter first!.");
+      }
+      if (_createMeanTotHist) {
+        if (_totSum!=0) {  // the mean and RMS ToT are calculated from the sums on request
+          _totSum[tIndex] += rTot;
+          _totSquareSum[tIndex] += rTot * rTot;
+          if (_sparseReset)
+            _totSumFilledBlocks[tIndex / __RESET_BLOCK_SIZE] = 1;
         } else {
-          throw std::runtime_error("Occupancy array not initialized. Set scan parameter first!.");
-        }
-        if (_createMeanTotHist) {
-          if (_meanTot!=0) {
-            float tOccupancy = (float)_occupancy[(size_t)tColumnIndex + (size_t)tRowIndex * (size_t)RAW_DATA_MAX_COLUMN + (size_t)tParIndex * (size_t)RAW_DATA_MAX_COLUMN * (size_t)RAW_DATA_MAX_ROW];
-            float tMeanTot = _meanTot[(size_t)tColumnIndex + (size_t)tRowIndex * (size_t)RAW_DATA_MAX_COLUMN + (size_t)tParIndex * (size_t)RAW_DATA_MAX_COLUMN * (size_t)RAW_DATA_MAX_ROW];
-            if (tMeanTot != tMeanTot)  // check for NAN, _meanTot initialized with NAN
-              tMeanTot = 0.0;
-            _meanTot[(size_t)tColumnIndex + (size_t)tRowIndex * (size_t)RAW_DATA_MAX_COLUMN + (size_t)tParIndex * (size_t)RAW_DATA_MAX_COLUMN * (size_t)RAW_DATA_MAX_ROW] = (tMeanTot * (tOccupancy - 1) + tTot) / tOccupancy;
-          } else {
-            throw std::runtime_error("Mean ToT array not initialized. Set scan parameter first!.");
-          }
+          throw std::runtime_error("Mean ToT array not initialized. Set scan parameter first!.");
         }
       }
     }
-    if (_createRelBCIDhist)
-      if (tTot <= _maxTot)
-        _relBcid[tRelBcid] += 1;
-    if (_createTotHist)
-      if (tTot <= __MAXHITTOT)
-        _tot[tTot] += 1;
-    if (((rHitInfo[i].event_status & (__NO_HIT | __MORE_THAN_ONE_HIT | __MORE_THAN_ONE_TDC_WORD | __TDC_INVALID)) == 0) && ((rHitInfo[i].event_status & __TDC_WORD) == __TDC_WORD)) {  // get TDC values from single hit events and unambiguous TDC word
-      if (_createTdcValueHist) {  // get TDC values from single hit events
-        _tdcValue[tTdc] += 1;
-      }
-      if (_createTdcTriggerDistanceHist) {  // get TDC values from single hit events
-        _tdcTriggerDistance[tTdcTriggerDistance] += 1;
-      }
-      if (_createTdcPixelHist) {
-        if (_tdcPixel != 0) {
-          if (tTdc >= __N_TDC_VALUES) {  // get TDC values from single hit events
-            info("TDC value out of range:" + IntToStr(tTdc) + ">" + IntToStr(__N_TDC_VALUES));
-            tTdc = 0;
-          }
-          _tdcPixel[(size_t)tColumnIndex + (size_t)tRowIndex * (size_t)RAW_DATA_MAX_COLUMN + (size_t)tTdc * (size_t)RAW_DATA_MAX_COLUMN * (size_t)RAW_DATA_MAX_ROW] += 1;
-        } else {
-          throw std::runtime_error("Output TDC pixel array array not set.");
+  }
+  if (_createRelBCIDhist)
+    if (rTot <= _maxTot)
+      _relBcid[rRelBcid] += 1;
+  if (_createTotHist)
+    if (rTot <= __MAXHITTOT)
+      _tot[rTot] += 1;
+  if (((rEventStatus & (__NO_HIT | __MORE_THAN_ONE_HIT | __MORE_THAN_ONE_TDC_WORD | __TDC_INVALID)) == 0) && ((rEventStatus & __TDC_WORD) == __TDC_WORD)) {  // get TDC values from single hit events and unambiguous TDC word
+    if (_createTdcValueHist) {  // get TDC values from single hit events
+      _tdcValue[rTdc] += 1;
+    }
+    if (_createTdcTriggerDistanceHist) {  // get TDC values from single hit events
+      _tdcTriggerDistance[rTdcTriggerDistance] += 1;
+    }
+    if (_createTdcPixelHist) {
+      if (!_tdcPixelBins.empty()) {
+        unsigned int tTdc = rTdc;
+        if (tTdc >= __N_TDC_VALUES) {  // get TDC values from single hit events
+          info("TDC value out of range:" + IntToStr(tTdc) + ">" + IntToStr(__N_TDC_VALUES));
+          tTdc = 0;
         }
+        if (tTdc >= _tdcPixelMinTdc && (tTdc - _tdcPixelMinTdc) / _tdcPixelBinWidth < _nTdcPixelBins)
+          addTdcPixelBin(_tdcPixelBins[(size_t)rColumnIndex + (size_t)rRowIndex * (size_t)RAW_DATA_MAX_COLUMN], (unsigned short) ((tTdc - _tdcPixelMinTdc) / _tdcPixelBinWidth), 1);
+      } else {
+        throw std::runtime_error("Output TDC pixel array array not set.");
       }
     }
-    if (_createTotPixelHist) {
-      if (tTot <= __MAXHITTOT)
-        _totPixel[(size_t)tColumnIndex + (size_t)tRowIndex * (size_t)RAW_DATA_MAX_COLUMN + (size_t)tTot * (size_t)RAW_DATA_MAX_COLUMN * (size_t)RAW_DATA_MAX_ROW] += 1;
+  }
+  if (_createTotPixelHist) {
+    if (rTot <= __MAXHITTOT) {
+      size_t tIndex = (size_t)rColumnIndex + (size_t)rRowIndex * (size_t)RAW_DATA_MAX_COLUMN + (size_t)rTot * (size_t)RAW_DATA_MAX_COLUMN * (size_t)RAW_DATA_MAX_ROW;
+      _totPixel[tIndex] += 1;
+      if (_sparseReset)
+        _totPixelFilledBlocks[tIndex / __RESET_BLOCK_SIZE] = 1;
     }
   }
 }
@@ -221,6 +565,8 @@ void Histogram::addClusterSeedHits(ClusterInfo*& rClusterInfo, const unsigned in
 {
   if (Basis::debugSet())
     debug("addClusterSeedHits(...,rNcluster="+IntToStr(rNcluster)+")");
+  FillGuard tFillGuard(*this);
+  updateMetaEventIndex();
   for (unsigned int i = 0; i<rNcluster; ++i) {
     unsigned short tColumnIndex = rClusterInfo[i].seed_column-1;
     if (tColumnIndex > RAW_DATA_MAX_COLUMN-1)
@@ -248,22 +594,94 @@ unsigned int Histogram::getParIndex(int64_t& rEventNumber)
 {
   if (_parInfo == 0)
     return 0;
-  for (uint64_t i=_lastMetaEventIndex; i<_nMetaEventIndexLength-1; ++i) {
-    if (_metaEventIndex[i+1] > (uint64_t) rEventNumber || _metaEventIndex[i+1] < _metaEventIndex[i]) {  // second case: meta event data not set yet (std value = 0), event number has to increase
-      _lastMetaEventIndex = i;
-      if (i < _nParInfoLength) {
-        return _parInfo[i];
-      } else {
-        error("Scan parameter index " + LongIntToStr(i) + " out of range");
-        throw std::out_of_range("Scan parameter index out of range.");
-      }
+  unsigned int tReadOut = getEventReadOut(rEventNumber);
+  if (tReadOut >= _nParInfoLength) {
+    error("Scan parameter index " + IntToStr(tReadOut) + " out of range");
+    throw std::out_of_range("Scan parameter index out of range.");
+  }
+  return _parInfo[tReadOut];
+}
+
+unsigned int Histogram::getEventReadOut(int64_t& rEventNumber)
+{
+  if (_nMetaEventIndexSet == 0) {
+    error("getParIndex: Correlation issues at event "+LongIntToStr(rEventNumber)+", no meta event index set");
+    throw std::logic_error("Event parameter correlation issues.");
+  }
+  uint64_t tEventNumber = (uint64_t) rEventNumber;
+  uint64_t tReadOut = _lastMetaEventIndex;
+  if ((tReadOut > 0 && _metaEventIndex[tReadOut] > tEventNumber) || (tReadOut + 1 < _nMetaEventIndexSet && _metaEventIndex[tReadOut + 1] <= tEventNumber)) {  // the event is not in the read out of the last event, search the last read out starting at or before the event
+    const uint64_t* tBase = _metaEventIndex;
+    unsigned int tN = _nMetaEventIndexSet;
+    while (tN > 1) {  // branchless binary search, the comparison only selects the next base
+      unsigned int tHalf = tN / 2;
+      tBase = (tBase[tHalf] <= tEventNumber) ? tBase + tHalf : tBase;
+      tN -= tHalf;
+    }
+    tReadOut = (uint64_t) (tBase - _metaEventIndex);  // events in front of the first read out belong to the first read out
+    _lastMetaEventIndex = tReadOut;
+  }
+  return (unsigned int) tReadOut;
+}
+
+void Histogram::updateMetaEventIndex()
+{
+  while (_nMetaEventIndexSet < _nMetaEventIndexLength) {
+    uint64_t tStartEvent = _metaEventIndex[_nMetaEventIndexSet];
+    uint64_t tLastStartEvent = _metaEventIndex[_nMetaEventIndexSet - 1];
+    if (tStartEvent < tLastStartEvent)  // meta event data not set yet (std value = 0), the event number has to increase
+      break;
+    if (tStartEvent == 0) {  // read outs in front without events or not set yet, they are set if a following read out is set
+      unsigned int tNextSet = _nMetaEventIndexSet + 1;
+      while (tNextSet < _nMetaEventIndexLength && _metaEventIndex[tNextSet] == 0)
+        ++tNextSet;
+      if (tNextSet == _nMetaEventIndexLength)
+        break;
+      _nMetaEventIndexSet = tNextSet;
+      continue;
     }
+    ++_nMetaEventIndexSet;
+  }
+}
+
+unsigned int Histogram::getReadOutParIndex(const unsigned int& rReadOutIndex)
+{
+  if (_parInfo == 0)
+    return 0;
+  if (rReadOutIndex >= _nParInfoLength) {
+    error("Scan parameter index " + IntToStr(rReadOutIndex) + " out of range");
+    throw std::out_of_range("Scan parameter index out of range.");
   }
-  if (_metaEventIndex[_nMetaEventIndexLength-1] <= (uint64_t) rEventNumber)  // last read outs
-    return _parInfo[_nMetaEventIndexLength-1];
-  error("getScanParameter: Correlation issues at event "+LongIntToStr(rEventNumber)+"\n_metaEventIndex[_nMetaEventIndexLength-1] "+LongIntToStr(_metaEventIndex[_nMetaEventIndexLength-1])+"\n_lastMetaEventIndex "+LongIntToStr(_lastMetaEventIndex));
-  throw std::logic_error("Event parameter correlation issues.");
-  return 0;
+  unsigned int tParIndex = _parInfo[rReadOutIndex];
+  if (tParIndex >= getNparameters()) {
+    error("addEventHits: tParIndex "+IntToStr(tParIndex)+"\t> "+IntToStr(_NparameterValues));
+    throw std::out_of_range("Parameter index out of range.");
+  }
+  return tParIndex;
+}
+
+unsigned int* Histogram::getReadOutOccupancy(const unsigned int& rReadOutIndex)
+{
+  if (_occupancy == 0)
+    throw std::runtime_error("Occupancy array not initialized. Set scan parameter first!.");
+  size_t tOffset = (size_t)getReadOutParIndex(rReadOutIndex) * (size_t)RAW_DATA_MAX_COLUMN * (size_t)RAW_DATA_MAX_ROW;
+  if (_sparseReset)  // the interpreter can fill any pixel
+    markFilledBlocks(_occupancyFilledBlocks, tOffset, (size_t)RAW_DATA_MAX_COLUMN * (size_t)RAW_DATA_MAX_ROW);
+  return _occupancy + tOffset;
+}
+
+void Histogram::getReadOutTotSums(const unsigned int& rReadOutIndex, uint64_t*& rTotSum, uint64_t*& rTotSquareSum)
+{
+  if (!_createMeanTotHist || _totSum == 0) {
+    rTotSum = 0;
+    rTotSquareSum = 0;
+    return;
+  }
+  size_t tOffset = (size_t)getReadOutParIndex(rReadOutIndex) * (size_t)RAW_DATA_MAX_COLUMN * (size_t)RAW_DATA_MAX_ROW;
+  if (_sparseReset)
+    markFilledBlocks(_totSumFilledBlocks, tOffset, (size_t)RAW_DATA_MAX_COLUMN * (size_t)RAW_DATA_MAX_ROW);
+  rTotSum = _totSum + tOffset;
+  rTotSquareSum = _totSquareSum + tOffset;
 }
 
 void Histogram::addScanParameter(int*& rParInfo, const unsigned int& rNparInfoLength)
@@ -305,6 +723,9 @@ void Histogram::addMetaEventIndex(uint64_t*& rMetaEventIndex, const unsigned int
   debug("addMetaEventIndex()");
   _nMetaEventIndexLength = rNmetaEventIndexLength;
   _metaEventIndex = rMetaEventIndex;
+  _nMetaEventIndexSet = _nMetaEventIndexLength > 0 ? 1 : 0;
+  _lastMetaEventIndex = 0;
+  updateMetaEventIndex();
   if (Basis::debugSet())
     for (unsigned int i=0; i<_nMetaEventIndexLength; ++i)
       std::cout<<"index "<<i<<"\t event number "<<_metaEventIndex[i]<<"\n";
@@ -316,6 +737,7 @@ void Histogram::allocateOccupancyArray()
   deleteOccupancyArray();
   try {
     _occupancy = new unsigned int[(size_t)RAW_DATA_MAX_COLUMN * (size_t)RAW_DATA_MAX_ROW * (size_t)getNparameters()];
+    _occupancyFilledBlocks.assign(((size_t)RAW_DATA_MAX_COLUMN * (size_t)RAW_DATA_MAX_ROW * (size_t)getNparameters() + __RESET_BLOCK_SIZE - 1) / __RESET_BLOCK_SIZE, 1);  // not initialized
   } catch(std::bad_alloc& exception) {
     error(std::string("allocateOccupancyArray: ")+std::string(exception.what()));
   }
@@ -327,17 +749,21 @@ void Histogram::deleteOccupancyArray()
   if (_occupancy != 0)
     delete[] _occupancy;
   _occupancy = 0;
+  _occupancyFilledBlocks.clear();
+  if (_cumulatedOccupancy != 0)
+    delete[] _cumulatedOccupancy;
+  _cumulatedOccupancy = 0;
+  _nThresholdScanSteps = 0;
 }
 
 void Histogram::resetOccupancyArray()
 {
   info("resetOccupancyArray()");
   if (_occupancy != 0) {
-    for (size_t i = 0; i < RAW_DATA_MAX_COLUMN; i++)
-      for (size_t j = 0; j < RAW_DATA_MAX_ROW; j++)
-        for (size_t k = 0; k < getNparameters(); k++)
-          _occupancy[i + j * (size_t)RAW_DATA_MAX_COLUMN + k * (size_t)RAW_DATA_MAX_COLUMN * (size_t)RAW_DATA_MAX_ROW] = 0;
+    resetArray(_occupancy, (size_t)RAW_DATA_MAX_COLUMN * (size_t)RAW_DATA_MAX_ROW * (size_t)getNparameters(), _occupancyFilledBlocks, _sparseReset);
+    std::fill(_occupancyFilledBlocks.begin(), _occupancyFilledBlocks.end(), 0);
   }
+  _nThresholdScanSteps = 0;
 }
 
 void Histogram::allocateMeanTotArray()
@@ -345,8 +771,14 @@ void Histogram::allocateMeanTotArray()
   debug("allocateMeanTotArray() with "+IntToStr(getNparameters())+" parameters");
   deleteMeanTotArray();
   try {
-    _meanTot = new float[(size_t)RAW_DATA_MAX_COLUMN * (size_t)RAW_DATA_MAX_ROW * (size_t)getNparameters()];
+    size_t tNbins = (size_t)RAW_DATA_MAX_COLUMN * (size_t)RAW_DATA_MAX_ROW * (size_t)getNparameters();
+    _totSum = new uint64_t[tNbins];
+    _totSquareSum = new uint64_t[tNbins];
+    _meanTot = new float[tNbins];
+    _rmsTot = new float[tNbins];
+    _totSumFilledBlocks.assign((tNbins + __RESET_BLOCK_SIZE - 1) / __RESET_BLOCK_SIZE, 1);
   } catch(std::bad_alloc& exception) {
+    deleteMeanTotArray();
     error(std::string("allocateMeanTotArray: ")+std::string(exception.what()));
   }
 }
@@ -354,20 +786,30 @@ void Histogram::allocateMeanTotArray()
 void Histogram::deleteMeanTotArray()
 {
   debug("deleteMeanTotArray()");
+  if (_totSum != 0)
+    delete[] _totSum;
+  _totSum = 0;
+  if (_totSquareSum != 0)
+    delete[] _totSquareSum;
+  _totSquareSum = 0;
   if (_meanTot != 0) {
     delete[] _meanTot;
   }
   _meanTot = 0;
+  if (_rmsTot != 0)
+    delete[] _rmsTot;
+  _rmsTot = 0;
+  _totSumFilledBlocks.clear();
 }
 
 void Histogram::resetMeanTotArray()
 {
   info("resetMeanTotArray()");
-  if (_meanTot != 0) {
-    for (size_t i = 0; i < RAW_DATA_MAX_COLUMN; i++)
-      for (size_t j = 0; j < RAW_DATA_MAX_ROW; j++)
-        for (size_t k = 0; k < getNparameters(); k++)
-          _meanTot[i + j * (size_t)RAW_DATA_MAX_COLUMN + k * (size_t)RAW_DATA_MAX_COLUMN * (size_t)RAW_DATA_MAX_ROW] = NAN;
+  if (_totSum != 0) {
+    size_t tNbins = (size_t)RAW_DATA_MAX_COLUMN * (size_t)RAW_DATA_MAX_ROW * (size_t)getNparameters();
+    resetArray(_totSum, tNbins, _totSumFilledBlocks, _sparseReset);
+    resetArray(_totSquareSum, tNbins, _totSumFilledBlocks, _sparseReset);
+    std::fill(_totSumFilledBlocks.begin(), _totSumFilledBlocks.end(), 0);
   }
 }
 
@@ -375,11 +817,9 @@ void Histogram::resetTdcPixelArray()
 {
   info("resetTdcPixelArray()");
   if (_createTdcPixelHist) {
-    if (_tdcPixel != 0) {
-      for (size_t i = 0; i < RAW_DATA_MAX_COLUMN; i++)
-        for (size_t j = 0; j < RAW_DATA_MAX_ROW; j++)
-          for (size_t k = 0; k < __N_TDC_VALUES; k++)
-            _tdcPixel[i + j * (size_t)RAW_DATA_MAX_COLUMN + k * (size_t)RAW_DATA_MAX_COLUMN * (size_t)RAW_DATA_MAX_ROW] = 0;
+    if (!_tdcPixelBins.empty()) {
+      for (size_t i = 0; i < _tdcPixelBins.size(); ++i)
+        _tdcPixelBins[i].clear();  // keeps the memory of the filled bins for the next scan step
     } else {
       throw std::runtime_error("Output TDC pixel array array not set.");
     }
@@ -391,13 +831,8 @@ void Histogram::resetTotPixelArray()
   info("resetTotPixelArray()");
   if (_createTotPixelHist) {
     if (_totPixel != 0) {
-      for (size_t i = 0; i < RAW_DATA_MAX_COLUMN; i++) {
-        for (size_t j = 0; j < RAW_DATA_MAX_ROW; j++) {
-          for (size_t k = 0; k <= __MAXHITTOT; k++) {
-            _totPixel[i + j * (size_t)RAW_DATA_MAX_COLUMN + k * (size_t)RAW_DATA_MAX_COLUMN * (size_t)RAW_DATA_MAX_ROW] = 0;
-          }
-        }
-      }
+      resetArray(_totPixel, (size_t)RAW_DATA_MAX_COLUMN * (size_t)RAW_DATA_MAX_ROW * ((size_t)__MAXHITTOT + 1), _totPixelFilledBlocks, _sparseReset);
+      std::fill(_totPixelFilledBlocks.begin(), _totPixelFilledBlocks.end(), 0);
     } else {
       throw std::runtime_error("Output ToT pixel array array not set.");
     }
@@ -536,6 +971,7 @@ void Histogram::allocateTotPixelArray()
   deleteTotPixelArray();
   try {
     _totPixel = new unsigned short[(size_t)RAW_DATA_MAX_COLUMN * (size_t)RAW_DATA_MAX_ROW * ((size_t)__MAXHITTOT + 1)];
+    _totPixelFilledBlocks.assign(((size_t)RAW_DATA_MAX_COLUMN * (size_t)RAW_DATA_MAX_ROW * ((size_t)__MAXHITTOT + 1) + __RESET_BLOCK_SIZE - 1) / __RESET_BLOCK_SIZE, 1);
   } catch(std::bad_alloc& exception) {
     error(std::string("allocateTotPixelArray: ")+std::string(exception.what()));
   }
@@ -546,7 +982,7 @@ void Histogram::allocateTdcPixelArray()
   debug("allocateTdcPixelArray()");
   deleteTdcPixelArray();
   try {
-    _tdcPixel = new unsigned short[(size_t) RAW_DATA_MAX_COLUMN * (size_t) RAW_DATA_MAX_ROW * (size_t)__N_TDC_VALUES];
+    _tdcPixelBins.resize((size_t)RAW_DATA_MAX_COLUMN * (size_t)RAW_DATA_MAX_ROW);  // the dense histogram is allocated on request
   } catch(std::bad_alloc& exception) {
     error(std::string("allocateTdcPixelArray: ")+std::string(exception.what()));
   }
@@ -558,16 +994,63 @@ void Histogram::deleteTotPixelArray()
   if (_totPixel != 0)
     delete[] _totPixel;
   _totPixel = 0;
+  _totPixelFilledBlocks.clear();
 }
 
 void Histogram::deleteTdcPixelArray()
 {
   debug("deleteTdcPixelArray");
+  std::vector<TdcPixelBins>().swap(_tdcPixelBins);
   if (_tdcPixel != 0)
     delete[] _tdcPixel;
   _tdcPixel = 0;
 }
 
+void Histogram::addTdcPixelBin(TdcPixelBins& rTdcPixelBins, const unsigned short& rBin, const unsigned int& rCount)
+{
+  TdcPixelBins::iterator tTdcPixelBin = std::lower_bound(rTdcPixelBins.begin(), rTdcPixelBins.end(), rBin, tdcPixelBinLess);
+  if (tTdcPixelBin != rTdcPixelBins.end() && tTdcPixelBin->bin == rBin) {
+    tTdcPixelBin->count += rCount;
+  } else {
+    TdcPixelBin tNewTdcPixelBin = {rBin, rCount};
+    rTdcPixelBins.insert(tTdcPixelBin, tNewTdcPixelBin);
+  }
+}
+
+void Histogram::addTdcPixelBins(TdcPixelBins& rTdcPixelBins, const TdcPixelBins& rOtherTdcPixelBins)
+{
+  if (rOtherTdcPixelBins.empty())
+    return;
+  if (rTdcPixelBins.empty()) {
+    rTdcPixelBins = rOtherTdcPixelBins;
+    return;
+  }
+  TdcPixelBins tTdcPixelBins;
+  tTdcPixelBins.reserve(rTdcPixelBins.size() + rOtherTdcPixelBins.size());
+  TdcPixelBins::const_iterator i = rTdcPixelBins.begin(), j = rOtherTdcPixelBins.begin();
+  while (i != rTdcPixelBins.end() || j != rOtherTdcPixelBins.end()) {
+    if (j == rOtherTdcPixelBins.end() || (i != rTdcPixelBins.end() && i->bin < j->bin))
+      tTdcPixelBins.push_back(*i++);
+    else if (i == rTdcPixelBins.end() || j->bin < i->bin)
+      tTdcPixelBins.push_back(*j++);
+    else {
+      TdcPixelBin tTdcPixelBin = {i->bin, i->count + j->count};
+      tTdcPixelBins.push_back(tTdcPixelBin);
+      ++i;
+      ++j;
+    }
+  }
+  rTdcPixelBins.swap(tTdcPixelBins);
+}
+
+void Histogram::fillTdcPixelArray(const std::vector<TdcPixelBins>& rTdcPixelBins, const unsigned int& rNtdcBins, unsigned short* pTdcPixel)
+{
+  std::fill(pTdcPixel, pTdcPixel + rTdcPixelBins.size() * (size_t)rNtdcBins, 0);
+  for (size_t i = 0; i < rTdcPixelBins.size(); ++i)
+    for (TdcPixelBins::const_iterator j = rTdcPixelBins[i].begin(); j != rTdcPixelBins[i].end(); ++j)
+      pTdcPixel[i + (size_t)j->bin * rTdcPixelBins.size()] = (unsigned short) std::min(j->count, 0xFFFFu);
+}
+
 unsigned int Histogram::getNparameters()
 {
   return _NparameterValues;
@@ -598,8 +1081,10 @@ void Histogram::getTotHist(unsigned int*& rTotHist, bool copy)
 void Histogram::getMeanTot(unsigned int& rNparameterValues, float*& rMeanTot, bool copy)
 {
   debug("getMeanTot(...)");
+  size_t tArrayLength = (size_t)RAW_DATA_MAX_COLUMN * (size_t)RAW_DATA_MAX_ROW * (size_t)_NparameterValues;
+  if (_totSum != 0 && _occupancy != 0)
+    calculateTotMoments(_occupancy, _totSum, _totSquareSum, tArrayLength, _meanTot, 0);
   if (copy) {
-    size_t tArrayLength = (size_t)(RAW_DATA_MAX_COLUMN - 1) + (size_t)(RAW_DATA_MAX_ROW - 1) * (size_t)RAW_DATA_MAX_COLUMN + (size_t)(_NparameterValues - 1) * (size_t)RAW_DATA_MAX_COLUMN * (size_t)RAW_DATA_MAX_ROW + 1;
     std::copy(_meanTot, _meanTot + tArrayLength, rMeanTot);
   } else {
     rMeanTot = _meanTot;
@@ -607,6 +1092,38 @@ void Histogram::getMeanTot(unsigned int& rNparameterValues, float*& rMeanTot, bo
   rNparameterValues = _NparameterValues;
 }
 
+void Histogram::getRmsTot(unsigned int& rNparameterValues, float*& rRmsTot, bool copy)
+{
+  debug("getRmsTot(...)");
+  size_t tArrayLength = (size_t)RAW_DATA_MAX_COLUMN * (size_t)RAW_DATA_MAX_ROW * (size_t)_NparameterValues;
+  if (_totSum != 0 && _occupancy != 0)
+    calculateTotMoments(_occupancy, _totSum, _totSquareSum, tArrayLength, 0, _rmsTot);
+  if (copy) {
+    std::copy(_rmsTot, _rmsTot + tArrayLength, rRmsTot);
+  } else {
+    rRmsTot = _rmsTot;
+  }
+  rNparameterValues = _NparameterValues;
+}
+
+void Histogram::calculateTotMoments(const unsigned int* pOccupancy, const uint64_t* pTotSum, const uint64_t* pTotSquareSum, const size_t& rNbins, float* pMeanTot, float* pRmsTot)
+{
+  for (size_t i = 0; i < rNbins; ++i) {
+    if (pOccupancy[i] == 0) {
+      if (pMeanTot != 0)
+        pMeanTot[i] = NAN;
+      if (pRmsTot != 0)
+        pRmsTot[i] = NAN;
+      continue;
+    }
+    double tMeanTot = (double) pTotSum[i] / (double) pOccupancy[i];
+    if (pMeanTot != 0)
+      pMeanTot[i] = (float) tMeanTot;
+    if (pRmsTot != 0)
+      pRmsTot[i] = (float) std::sqrt(std::max((double) pTotSquareSum[i] / (double) pOccupancy[i] - tMeanTot * tMeanTot, 0.));  // rounding can give a small negative variance
+  }
+}
+
 void Histogram::getTdcValuesHist(unsigned int*& rTdcValueHist, bool copy)
 {
   debug("getTdcValuesHist(...)");
@@ -650,14 +1167,51 @@ void Histogram::getTotPixelHist(unsigned short*& rTotPixelHist, bool copy)
 void Histogram::getTdcPixelHist(unsigned short*& rTdcPixelHist, bool copy)
 {
   debug("getTdcPixelHist(...)");
+  if (_tdcPixelBins.empty()) {
+    if (!copy)
+      rTdcPixelHist = 0;
+    return;
+  }
   if (copy) {
-    std::copy(_tdcPixel, _tdcPixel + __N_TDC_VALUES, rTdcPixelHist);
-  } else {
-    rTdcPixelHist = _tdcPixel;
+    fillTdcPixelArray(_tdcPixelBins, _nTdcPixelBins, rTdcPixelHist);
+    return;
   }
+  if (_tdcPixel == 0) {
+    try {
+      _tdcPixel = new unsigned short[(size_t)RAW_DATA_MAX_COLUMN * (size_t)RAW_DATA_MAX_ROW * (size_t)_nTdcPixelBins];
+    } catch(std::bad_alloc& exception) {
+      error(std::string("getTdcPixelHist: ")+std::string(exception.what()));
+      rTdcPixelHist = 0;
+      return;
+    }
+  }
+  fillTdcPixelArray(_tdcPixelBins, _nTdcPixelBins, _tdcPixel);
+  rTdcPixelHist = _tdcPixel;
+}
+
+unsigned int Histogram::getNtdcPixelHistEntries()
+{
+  size_t tNentries = 0;
+  for (size_t i = 0; i < _tdcPixelBins.size(); ++i)
+    tNentries += _tdcPixelBins[i].size();
+  return (unsigned int) tNentries;
 }
 
-void Histogram::calculateThresholdScanArrays(double rMuArray[], double rSigmaArray[], const unsigned int& rMaxInjections, const unsigned int& min_parameter, const unsigned int& max_parameter)
+void Histogram::getTdcPixelHistEntries(unsigned short* pColumnIndex, unsigned short* pRowIndex, unsigned short* pTdcBin, unsigned int* pCount)
+{
+  debug("getTdcPixelHistEntries(...)");
+  size_t tEntry = 0;
+  for (size_t i = 0; i < _tdcPixelBins.size(); ++i) {
+    for (TdcPixelBins::const_iterator j = _tdcPixelBins[i].begin(); j != _tdcPixelBins[i].end(); ++j, ++tEntry) {
+      pColumnIndex[tEntry] = (unsigned short) (i % RAW_DATA_MAX_COLUMN);
+      pRowIndex[tEntry] = (unsigned short) (i / RAW_DATA_MAX_COLUMN);
+      pTdcBin[tEntry] = j->bin;
+      pCount[tEntry] = j->count;
+    }
+  }
+}
+
+void Histogram::calculateThresholdScanArrays(double rMuArray[], double rSigmaArray[], const unsigned int& rMaxInjections, const unsigned int& min_parameter, const unsigned int& max_parameter, const bool& rFitSCurves)
 {
   debug("calculateThresholdScanArrays(...)");
   // fast algorithm from M. Mertens, PhD thesis, FZ Juelich 2010
@@ -668,41 +1222,205 @@ void Histogram::calculateThresholdScanArrays(double rMuArray[], double rSigmaArr
   if (_NparameterValues<2)  // a minimum number of different scans is needed
     return;
 
-  unsigned int q_min = min_parameter;
-  unsigned int q_max = max_parameter;
-  unsigned int A = rMaxInjections;
-  double d = ((double)q_max - (double)q_min)/(double)(getNparameters()-1);
+  unsigned int tNpixels = RAW_DATA_MAX_COLUMN * RAW_DATA_MAX_ROW;
+  unsigned int tNblocks = (tNpixels + __THRESHOLD_BLOCK_SIZE - 1) / __THRESHOLD_BLOCK_SIZE;
+  std::vector<ThresholdScanTask> tTasks(std::max(1u, std::min(_nThreads, tNblocks)));
+  for (unsigned int i = 0; i < tTasks.size(); ++i) {  // the tasks have whole blocks of pixels
+    ThresholdScanTask& rTask = tTasks[i];
+    rTask.occupancy = _occupancy;
+    rTask.nParameters = _NparameterValues;
+    rTask.firstPixel = std::min(tNblocks * i / (unsigned int) tTasks.size() * __THRESHOLD_BLOCK_SIZE, tNpixels);
+    rTask.lastPixel = std::min(tNblocks * (i + 1) / (unsigned int) tTasks.size() * __THRESHOLD_BLOCK_SIZE, tNpixels);
+    rTask.maxInjections = rMaxInjections;
+    rTask.minParameter = (double) min_parameter;
+    rTask.maxParameter = (double) max_parameter;
+    rTask.parameterStep = ((double)max_parameter - (double)min_parameter)/(double)(_NparameterValues-1);
+    rTask.fitSCurves = rFitSCurves;
+    rTask.mu = rMuArray;
+    rTask.sigma = rSigmaArray;
+  }
+  runParallel(&Histogram::calculateThresholdScanTask, tTasks);
+}
+
+void Histogram::setThresholdScanSteps(const unsigned int& rNsteps)
+{
+  if (Basis::debugSet())
+    debug("setThresholdScanSteps(" + IntToStr(rNsteps) + ")");
+  if (_occupancy==0)
+    throw std::runtime_error("Occupancy array not initialized. Set scan parameter first!.");
+  if (rNsteps > _NparameterValues)
+    throw std::out_of_range("Threshold scan step out of range.");
+  const size_t tNpixels = (size_t)RAW_DATA_MAX_COLUMN * (size_t)RAW_DATA_MAX_ROW;
+  if (_cumulatedOccupancy == 0) {
+    try {
+      _cumulatedOccupancy = new unsigned int[tNpixels * (size_t)_NparameterValues];
+    } catch(std::bad_alloc& exception) {
+      error(std::string("setThresholdScanSteps: ")+std::string(exception.what()));
+      return;
+    }
+    _nThresholdScanSteps = 0;
+  }
+  if (rNsteps < _nThresholdScanSteps)  // the steps are scanned again
+    _nThresholdScanSteps = 0;
+  for (unsigned int k = _nThresholdScanSteps; k < rNsteps; ++k) {  // O(pixels) per new step
+    const unsigned int* tOccupancy = _occupancy + (size_t)k * tNpixels;
+    unsigned int* tCumulatedOccupancy = _cumulatedOccupancy + (size_t)k * tNpixels;
+    if (k == 0)
+      std::copy(tOccupancy, tOccupancy + tNpixels, tCumulatedOccupancy);
+    else
+      for (size_t i = 0; i < tNpixels; ++i)
+        tCumulatedOccupancy[i] = tCumulatedOccupancy[i - tNpixels] + tOccupancy[i];
+  }
+  _nThresholdScanSteps = rNsteps;
+}
+
+void Histogram::calculateThresholdScanEstimates(double rMuArray[], double rSigmaArray[], const unsigned int& rMaxInjections, const unsigned int& min_parameter, const unsigned int& max_parameter)
+{
+  debug("calculateThresholdScanEstimates(...)");
+  // fast algorithm from M. Mertens for the completed steps, the fully occupied following steps do not change the noise sums;
+  // with the prefix sums of the occupancy the sums below the threshold (mu1) and above (mu2) are known for any threshold
+
+  if (_occupancy==0)
+    throw std::runtime_error("Occupancy array not initialized. Set scan parameter first!.");
+
+  if (_NparameterValues<2 || _nThresholdScanSteps == 0)
+    return;
+
+  const size_t tNpixels = (size_t)RAW_DATA_MAX_COLUMN * (size_t)RAW_DATA_MAX_ROW;
+  double A = (double) rMaxInjections;
+  double d = ((double)max_parameter - (double)min_parameter)/(double)(_NparameterValues-1);
+  unsigned int tLastStep = _nThresholdScanSteps - 1;
+  double tLastParameter = (double)max_parameter - (double)(_NparameterValues - 1 - tLastStep)*d;  // the threshold of M hits is M / A steps below the last step
+  const unsigned int* M = _cumulatedOccupancy + (size_t)tLastStep * tNpixels;
+
+  for (size_t i = 0; i < tNpixels; ++i) {
+    double threshold = tLastParameter+d/2 - d*(double)M[i]/A;
+    double tStepsBelow = std::ceil((threshold - (double)min_parameter)/d);
+    unsigned int tNstepsBelow = tStepsBelow > 0 ? (unsigned int) std::min(tStepsBelow, (double)_nThresholdScanSteps) : 0;
+    while (tNstepsBelow > 0 && (double)(tNstepsBelow-1)*d+(double)min_parameter >= threshold)  // same comparison as calculateThresholdScanArrays
+      --tNstepsBelow;
+    while (tNstepsBelow < _nThresholdScanSteps && (double)tNstepsBelow*d+(double)min_parameter < threshold)
+      ++tNstepsBelow;
+    int64_t mu1 = tNstepsBelow > 0 ? (int64_t)_cumulatedOccupancy[i + (size_t)(tNstepsBelow - 1) * tNpixels] : 0;
+    int64_t mu2 = (int64_t)(_nThresholdScanSteps - tNstepsBelow) * (int64_t)rMaxInjections - ((int64_t)M[i] - mu1);
+    rMuArray[i] = threshold;
+    rSigmaArray[i] = d*(double)(mu1+mu2)/A*sqrt(3.14159265358979323846/2);
+  }
+}
+
+void Histogram::calculateThresholdScanTask(ThresholdScanTask& rTask)
+{
+  const size_t tNpixels = (size_t)RAW_DATA_MAX_COLUMN * (size_t)RAW_DATA_MAX_ROW;
+  double A = (double) rTask.maxInjections;
+  double d = rTask.parameterStep;
+  unsigned int M[__THRESHOLD_BLOCK_SIZE];  // sum of the occupancies of each pixel of the block
+  double tThreshold[__THRESHOLD_BLOCK_SIZE];
+  double tMu[__THRESHOLD_BLOCK_SIZE];  // mu1 + mu2 of each pixel, the sums are exact
+  std::vector<double> tSCurves(rTask.fitSCurves ? (size_t)__THRESHOLD_BLOCK_SIZE * (size_t)rTask.nParameters : 0);  // the occupancies of each pixel of the block in a row for the fit
+
+  for (unsigned int tFirstPixel = rTask.firstPixel; tFirstPixel < rTask.lastPixel; tFirstPixel += __THRESHOLD_BLOCK_SIZE) {
+    unsigned int tNblockPixels = std::min(__THRESHOLD_BLOCK_SIZE, rTask.lastPixel - tFirstPixel);
+    for (unsigned int j = 0; j < tNblockPixels; ++j)
+      M[j] = 0;
+    for (unsigned int k = 0; k < rTask.nParameters; ++k) {  // the parameter slice of the block is contiguous
+      const unsigned int* tOccupancy = rTask.occupancy + tFirstPixel + (size_t)k * tNpixels;
+      for (unsigned int j = 0; j < tNblockPixels; ++j)
+        M[j] += tOccupancy[j];
+    }
+    for (unsigned int j = 0; j < tNblockPixels; ++j) {
+      tThreshold[j] = rTask.maxParameter+d/2 - d*(double)M[j]/A;
+      tMu[j] = 0;
+    }
+    for (unsigned int k = 0; k < rTask.nParameters; ++k) {  // mu1 below the threshold, mu2 above
+      const unsigned int* tOccupancy = rTask.occupancy + tFirstPixel + (size_t)k * tNpixels;
+      double tParameter = (double)k*d+rTask.minParameter;
+      for (unsigned int j = 0; j < tNblockPixels; ++j)
+        tMu[j] += tParameter < tThreshold[j] ? (double)tOccupancy[j] : A-(double)tOccupancy[j];
+    }
+    for (unsigned int j = 0; j < tNblockPixels; ++j) {
+      rTask.mu[tFirstPixel + j] = tThreshold[j];
+      rTask.sigma[tFirstPixel + j] = d*tMu[j]/A*sqrt(3.14159265358979323846/2);
+    }
+
+    if (!rTask.fitSCurves)
+      continue;
+    for (unsigned int k = 0; k < rTask.nParameters; ++k) {
+      const unsigned int* tOccupancy = rTask.occupancy + tFirstPixel + (size_t)k * tNpixels;
+      for (unsigned int j = 0; j < tNblockPixels; ++j)
+        tSCurves[(size_t)j * rTask.nParameters + k] = (double)tOccupancy[j];
+    }
+    for (unsigned int j = 0; j < tNblockPixels; ++j)
+      if (M[j] > 0)  // no S-curve without hits
+        fitSCurve(&tSCurves[(size_t)j * rTask.nParameters], rTask.nParameters, A, rTask.minParameter, d, rTask.mu[tFirstPixel + j], rTask.sigma[tFirstPixel + j]);
+  }
+}
 
-  for(unsigned int i=0; i<RAW_DATA_MAX_COLUMN; ++i) {
-    for(unsigned int j=0; j<RAW_DATA_MAX_ROW; ++j) {
-      unsigned int M = 0;
+double Histogram::getSCurveChi2(const double* pOccupancy, const unsigned int& rNparameters, const double& rMaxInjections, const double& rMinParameter, const double& rParameterStep, const double& rMu, const double& rSigma)
+{
+  double tChi2 = 0;
+  for (unsigned int k = 0; k < rNparameters; ++k) {
+    double tResidual = pOccupancy[k] - 0.5*rMaxInjections*(1+erf(((double)k*rParameterStep+rMinParameter-rMu)/(rSigma*sqrt(2.))));
+    tChi2 += tResidual*tResidual;
+  }
+  return tChi2;
+}
 
-      for(unsigned int k=0; k<getNparameters(); ++k) {
-        M += _occupancy[(size_t)i + (size_t)j * (size_t)RAW_DATA_MAX_COLUMN  + (size_t)k * (size_t)RAW_DATA_MAX_COLUMN * (size_t)RAW_DATA_MAX_ROW];
+void Histogram::fitSCurve(const double* pOccupancy, const unsigned int& rNparameters, const double& rMaxInjections, const double& rMinParameter, const double& rParameterStep, double& rMu, double& rSigma)
+{
+  // S-curve A/2 * (1 + erf((q - mu) / (sqrt(2) * sigma))), the residuals are not weighted
+  double tMu = rMu;
+  double tSigma = rSigma > 0 ? rSigma : rParameterStep;  // the fast algorithm noise can be 0
+  double tChi2 = getSCurveChi2(pOccupancy, rNparameters, rMaxInjections, rMinParameter, rParameterStep, tMu, tSigma);
+  double tLambda = 1e-3;
+  double tJmuMu = 0, tJmuSigma = 0, tJsigmaSigma = 0, tJmuR = 0, tJsigmaR = 0;  // J^T J and J^T r
+  bool tNewJacobian = true;
+  bool tConverged = false;
+  for (unsigned int i = 0; i < __SCURVE_FIT_MAX_ITERATIONS && !tConverged; ++i) {
+    if (tNewJacobian) {
+      tJmuMu = tJmuSigma = tJsigmaSigma = tJmuR = tJsigmaR = 0;
+      for (unsigned int k = 0; k < rNparameters; ++k) {
+        double z = ((double)k*rParameterStep+rMinParameter-tMu)/tSigma;
+        double tResidual = pOccupancy[k] - 0.5*rMaxInjections*(1+erf(z/sqrt(2.)));
+        double tDerivative = rMaxInjections*exp(-0.5*z*z)/(sqrt(2*3.14159265358979323846)*tSigma);  // of the S-curve with respect to q
+        double tJmu = -tDerivative;  // derivatives of the S-curve with respect to mu and sigma
+        double tJsigma = -tDerivative*z;
+        tJmuMu += tJmu*tJmu;
+        tJmuSigma += tJmu*tJsigma;
+        tJsigmaSigma += tJsigma*tJsigma;
+        tJmuR += tJmu*tResidual;
+        tJsigmaR += tJsigma*tResidual;
       }
-      double threshold = (double)q_max+d/2 - d*(double)M/(double)A;
-      rMuArray[i+j*RAW_DATA_MAX_COLUMN] = threshold;
-
-      double mu1 = 0;
-      double mu2 = 0;
-//      bool do_math = true;
-      for(unsigned int k=0; k<getNparameters(); ++k) {
-        if(((double)k*d+(double)q_min) < threshold) {
-          mu1 += (double)_occupancy[(size_t)i + (size_t)j * (size_t)RAW_DATA_MAX_COLUMN  + (size_t)k * (size_t)RAW_DATA_MAX_COLUMN * (size_t)RAW_DATA_MAX_ROW];
-        }else{
-//          if(do_math) {
-//          double G = 0.5 - (threshold - ((double)k*d+(double)q_min))/d;
-//            mu1 += G*(double)_occupancy[(size_t)i + (size_t)j * (size_t)RAW_DATA_MAX_COLUMN  + (size_t)k * (size_t)RAW_DATA_MAX_COLUMN * (size_t)RAW_DATA_MAX_ROW];
-//            mu2 += (1-G)*((double)A-(double)_occupancy[(size_t)i + (size_t)j * (size_t)RAW_DATA_MAX_COLUMN  + (size_t)k * (size_t)RAW_DATA_MAX_COLUMN * (size_t)RAW_DATA_MAX_ROW]);
-//            do_math = false;
-//          }else{
-            mu2 += ((double)A-(double)_occupancy[(size_t)i + (size_t)j * (size_t)RAW_DATA_MAX_COLUMN  + (size_t)k * (size_t)RAW_DATA_MAX_COLUMN * (size_t)RAW_DATA_MAX_ROW]);
-//          }
+      tNewJacobian = false;
+    }
+    double a = tJmuMu*(1+tLambda);
+    double b = tJmuSigma;
+    double c = tJsigmaSigma*(1+tLambda);
+    double tDeterminant = a*c - b*b;
+    if (tDeterminant > 0) {
+      double tDeltaMu = (c*tJmuR - b*tJsigmaR)/tDeterminant;
+      double tDeltaSigma = (a*tJsigmaR - b*tJmuR)/tDeterminant;
+      double tNewMu = tMu + tDeltaMu;
+      double tNewSigma = tSigma + tDeltaSigma;
+      if (tNewSigma > 0) {
+        double tNewChi2 = getSCurveChi2(pOccupancy, rNparameters, rMaxInjections, rMinParameter, rParameterStep, tNewMu, tNewSigma);
+        if (tNewChi2 <= tChi2) {
+          tConverged = std::fabs(tNewMu - tMu) < 1e-6*rParameterStep && std::fabs(tNewSigma - tSigma) < 1e-6*rParameterStep;
+          tMu = tNewMu;
+          tSigma = tNewSigma;
+          tChi2 = tNewChi2;
+          tLambda = std::max(tLambda/10, 1e-12);
+          tNewJacobian = true;
+          continue;
         }
       }
-      double noise = d*(mu1+mu2)/(double)A*sqrt(3.14159265358979323846/2);
-      rSigmaArray[i+j*RAW_DATA_MAX_COLUMN] = noise;
     }
+    tLambda *= 10;
+    if (tLambda > 1e12)  // no improvement possible
+      tConverged = true;
+  }
+  if (tConverged && tMu == tMu && tSigma == tSigma) {  // not NaN
+    rMu = tMu;
+    rSigma = tSigma;
   }
 }
 
@@ -717,6 +1435,153 @@ void Histogram::setNoScanParameter()
   resetMeanTotArray();
 }
 
+void Histogram::takeSnapshot()
+{
+  if (Basis::debugSet())
+    debug("takeSnapshot()");
+  _snapshotNparameterValues = _NparameterValues;  // the snapshot arrays are only used by this thread until the snapshot is requested
+  _occupancySnapshot.resize(_occupancy != 0 ? (size_t)RAW_DATA_MAX_COLUMN * (size_t)RAW_DATA_MAX_ROW * (size_t)_NparameterValues : 0);
+  _totSnapshot.resize(_tot != 0 ? __MAXHITTOT + 1 : 0);
+  _tdcValueSnapshot.resize(_tdcValue != 0 ? __N_TDC_VALUES : 0);
+  _tdcTriggerDistanceSnapshot.resize(_tdcTriggerDistance != 0 ? __N_TDC_TRG_DIST_VALUES : 0);
+  _relBcidSnapshot.resize(_relBcid != 0 ? __MAXBCID : 0);
+  _totSumSnapshot.resize(_totSum != 0 && _occupancy != 0 ? (size_t)RAW_DATA_MAX_COLUMN * (size_t)RAW_DATA_MAX_ROW * (size_t)_NparameterValues : 0);
+  _totSquareSumSnapshot.resize(_totSumSnapshot.size());
+  _totPixelSnapshot.resize(_totPixel != 0 ? (size_t)RAW_DATA_MAX_COLUMN * (size_t)RAW_DATA_MAX_ROW * ((size_t)__MAXHITTOT + 1) : 0);
+  _tdcPixelBinsSnapshot.resize(_tdcPixelBins.size());
+  if ((atomicLoad(_fillSequence) & 1) != 0 && isCurrentThread(_fillingThread)) {  // called by the filling thread between events (e.g. from the event callback), it would wait for itself
+    atomicStore(_snapshotState, __SNAPSHOT_REQUESTED);
+    copySnapshot(true);
+    return;
+  }
+  atomicStore(_snapshotState, __SNAPSHOT_REQUESTED);
+  while (!copySnapshot(false) && atomicLoad(_snapshotState) != __SNAPSHOT_IDLE)  // the histograms are filled, wait for the filling thread to copy them
+    sleepMilliSeconds(0);
+}
+
+bool Histogram::copySnapshot(bool rFromFillingThread)
+{
+  if (!atomicCompareExchange(_snapshotState, __SNAPSHOT_REQUESTED, __SNAPSHOT_COPYING))  // the snapshot is not requested or copied by the other thread
+    return false;
+  unsigned int tFillSequence = atomicLoad(_fillSequence);
+  if (!rFromFillingThread && (tFillSequence & 1) != 0) {  // a fill is ongoing, the filling thread takes the snapshot
+    atomicStore(_snapshotState, __SNAPSHOT_REQUESTED);
+    return false;
+  }
+  if (!_occupancySnapshot.empty())
+    std::copy(_occupancy, _occupancy + _occupancySnapshot.size(), _occupancySnapshot.begin());
+  if (!_totSnapshot.empty())
+    std::copy(_tot, _tot + _totSnapshot.size(), _totSnapshot.begin());
+  if (!_tdcValueSnapshot.empty())
+    std::copy(_tdcValue, _tdcValue + _tdcValueSnapshot.size(), _tdcValueSnapshot.begin());
+  if (!_tdcTriggerDistanceSnapshot.empty())
+    std::copy(_tdcTriggerDistance, _tdcTriggerDistance + _tdcTriggerDistanceSnapshot.size(), _tdcTriggerDistanceSnapshot.begin());
+  if (!_relBcidSnapshot.empty())
+    std::copy(_relBcid, _relBcid + _relBcidSnapshot.size(), _relBcidSnapshot.begin());
+  if (!_totSumSnapshot.empty()) {
+    std::copy(_totSum, _totSum + _totSumSnapshot.size(), _totSumSnapshot.begin());
+    std::copy(_totSquareSum, _totSquareSum + _totSquareSumSnapshot.size(), _totSquareSumSnapshot.begin());
+  }
+  if (!_totPixelSnapshot.empty())
+    std::copy(_totPixel, _totPixel + _totPixelSnapshot.size(), _totPixelSnapshot.begin());
+  for (size_t i = 0; i < _tdcPixelBinsSnapshot.size(); ++i)  // the filling thread does not change the bins while this thread copies, see beginFill()
+    _tdcPixelBinsSnapshot[i] = _tdcPixelBins[i];
+  _snapshotNtdcPixelBins = _nTdcPixelBins;
+  if (!rFromFillingThread) {
+    memoryFence();
+    if (atomicLoad(_fillSequence) != tFillSequence) {  // a fill started while copying, the copy can be torn
+      atomicStore(_snapshotState, __SNAPSHOT_REQUESTED);
+      return false;
+    }
+  }
+  atomicStore(_snapshotState, __SNAPSHOT_IDLE);
+  return true;
+}
+
+void Histogram::beginFill()
+{
+  if (_fillDepth++ != 0)  // nested fill
+    return;
+  _fillingThread = getCurrentThreadId();
+  atomicStore(_fillSequence, _fillSequence + 1);
+  memoryFence();  // the odd sequence is visible before the histograms change
+  while (atomicLoad(_snapshotState) == __SNAPSHOT_COPYING)  // the snapshot thread copies, the sparse TDC pixel histogram must not be reallocated during the copy
+    sleepMilliSeconds(0);
+}
+
+void Histogram::endFill()
+{
+  if (--_fillDepth != 0)
+    return;
+  if (_nTimeSlices > 0) {
+    try {
+      closeTimeSlice();
+    } catch(std::bad_alloc& exception) {  // called from the FillGuard destructor
+      error(std::string("endFill: ")+std::string(exception.what()));
+    }
+  }
+  atomicStore(_fillSequence, _fillSequence + 1);  // the histogram changes are visible before the even sequence
+  serveSnapshot();
+}
+
+void Histogram::getSnapshotOccupancy(unsigned int& rNparameterValues, unsigned int*& rOccupancy)
+{
+  rOccupancy = _occupancySnapshot.empty() ? 0 : &_occupancySnapshot[0];
+  rNparameterValues = _snapshotNparameterValues;
+}
+
+void Histogram::getSnapshotTotHist(unsigned int*& rTotHist)
+{
+  rTotHist = _totSnapshot.empty() ? 0 : &_totSnapshot[0];
+}
+
+void Histogram::getSnapshotTdcValuesHist(unsigned int*& rTdcValueHist)
+{
+  rTdcValueHist = _tdcValueSnapshot.empty() ? 0 : &_tdcValueSnapshot[0];
+}
+
+void Histogram::getSnapshotTdcTriggerDistancesHist(unsigned int*& rTdcTriggerDistanceHist)
+{
+  rTdcTriggerDistanceHist = _tdcTriggerDistanceSnapshot.empty() ? 0 : &_tdcTriggerDistanceSnapshot[0];
+}
+
+void Histogram::getSnapshotRelBcidHist(unsigned int*& rRelBcidHist)
+{
+  rRelBcidHist = _relBcidSnapshot.empty() ? 0 : &_relBcidSnapshot[0];
+}
+
+void Histogram::getSnapshotMeanTot(unsigned int& rNparameterValues, float*& rMeanTot)
+{
+  _meanTotSnapshot.resize(_totSumSnapshot.size());
+  if (!_meanTotSnapshot.empty())
+    calculateTotMoments(&_occupancySnapshot[0], &_totSumSnapshot[0], &_totSquareSumSnapshot[0], _meanTotSnapshot.size(), &_meanTotSnapshot[0], 0);
+  rMeanTot = _meanTotSnapshot.empty() ? 0 : &_meanTotSnapshot[0];
+  rNparameterValues = _snapshotNparameterValues;
+}
+
+void Histogram::getSnapshotRmsTot(unsigned int& rNparameterValues, float*& rRmsTot)
+{
+  _rmsTotSnapshot.resize(_totSumSnapshot.size());
+  if (!_rmsTotSnapshot.empty())
+    calculateTotMoments(&_occupancySnapshot[0], &_totSumSnapshot[0], &_totSquareSumSnapshot[0], _rmsTotSnapshot.size(), 0, &_rmsTotSnapshot[0]);
+  rRmsTot = _rmsTotSnapshot.empty() ? 0 : &_rmsTotSnapshot[0];
+  rNparameterValues = _snapshotNparameterValues;
+}
+
+void Histogram::getSnapshotTotPixelHist(unsigned short*& rTotPixelHist)
+{
+  rTotPixelHist = _totPixelSnapshot.empty() ? 0 : &_totPixelSnapshot[0];
+}
+
+void Histogram::getSnapshotTdcPixelHist(unsigned int& rNtdcBins, unsigned short*& rTdcPixelHist)
+{
+  _tdcPixelSnapshot.resize(_tdcPixelBinsSnapshot.size() * (size_t)_snapshotNtdcPixelBins);
+  if (!_tdcPixelSnapshot.empty())
+    fillTdcPixelArray(_tdcPixelBinsSnapshot, _snapshotNtdcPixelBins, &_tdcPixelSnapshot[0]);
+  rTdcPixelHist = _tdcPixelSnapshot.empty() ? 0 : &_tdcPixelSnapshot[0];
+  rNtdcBins = _snapshotNtdcPixelBins;
+}
+
 void Histogram::reset()
 {
   info("reset()");
@@ -728,5 +1593,431 @@ void Histogram::reset()
   resetTotPixelArray();
   resetTdcPixelArray();
   resetRelBcidArray();
+  resetTimeSlices();
   _parInfo = 0;
 }
+
+void Histogram::setTimeSlices(const unsigned int& rNslices, const double& rSliceLength)
+{
+  info("setTimeSlices(...)");
+  if (!(rSliceLength >= 0))
+    throw std::invalid_argument("The time slice length has to be >= 0.");
+  _nTimeSlices = rNslices;
+  _timeSliceLength = rSliceLength;
+  try {
+    _actualTimeSliceHits.resize(rNslices > 0 ? (size_t)RAW_DATA_MAX_COLUMN * (size_t)RAW_DATA_MAX_ROW : 0);
+    _actualTimeSliceTotSums.resize(_actualTimeSliceHits.size());
+  } catch(std::bad_alloc& exception) {
+    _nTimeSlices = 0;
+    error(std::string("setTimeSlices: ")+std::string(exception.what()));
+  }
+  resetTimeSlices();
+}
+
+void Histogram::setMetaTimeStamps(MetaInfoV2*& rMetaInfo, const unsigned int& rNmetaInfoLength)
+{
+  debug("setMetaTimeStamps()");
+  _metaInfoV2 = rMetaInfo;
+  _nMetaInfoV2Length = rNmetaInfoLength;
+}
+
+void Histogram::getTimeSlices(int64_t* pSliceIndex, double* pStartTimeStamp, unsigned int* pNhits)
+{
+  debug("getTimeSlices(...)");
+  for (size_t i = 0; i < _timeSlices.size(); ++i) {
+    pSliceIndex[i] = _timeSlices[i].index;
+    pStartTimeStamp[i] = _timeSlices[i].startTimeStamp;
+    pNhits[i] = _timeSlices[i].nHits;
+  }
+}
+
+void Histogram::getTimeSliceOccupancy(const unsigned int& rFirstSlice, const unsigned int& rLastSlice, unsigned int* pOccupancy, uint64_t* pTotSum)
+{
+  debug("getTimeSliceOccupancy(...)");
+  if (rFirstSlice > rLastSlice || rLastSlice > _timeSlices.size())
+    throw std::out_of_range("Time slice range out of range.");
+  std::fill(pOccupancy, pOccupancy + (size_t)RAW_DATA_MAX_COLUMN * (size_t)RAW_DATA_MAX_ROW, 0);
+  if (pTotSum != 0)
+    std::fill(pTotSum, pTotSum + (size_t)RAW_DATA_MAX_COLUMN * (size_t)RAW_DATA_MAX_ROW, 0);
+  for (unsigned int i = rFirstSlice; i < rLastSlice; ++i) {  // only the hit pixels of each slice are added
+    const std::vector<TimeSliceBin>& rBins = _timeSlices[i].bins;
+    for (std::vector<TimeSliceBin>::const_iterator j = rBins.begin(); j != rBins.end(); ++j) {
+      pOccupancy[j->pixel] += j->hits;
+      if (pTotSum != 0)
+        pTotSum[j->pixel] += j->totSum;
+    }
+  }
+}
+
+void Histogram::resetTimeSlices()
+{
+  info("resetTimeSlices()");
+  _timeSlices.clear();
+  for (size_t i = 0; i < _actualTimeSlicePixels.size(); ++i) {
+    _actualTimeSliceHits[_actualTimeSlicePixels[i]] = 0;
+    _actualTimeSliceTotSums[_actualTimeSlicePixels[i]] = 0;
+  }
+  _actualTimeSlicePixels.clear();
+  _actualTimeSlice.nHits = 0;
+}
+
+int64_t Histogram::getTimeSliceIndex(const unsigned int& rReadOut, double& rStartTimeStamp)
+{
+  if (_timeSliceLength == 0) {
+    rStartTimeStamp = rReadOut < _nMetaInfoV2Length ? _metaInfoV2[rReadOut].startTimeStamp : 0;
+    return rReadOut;
+  }
+  if (rReadOut >= _nMetaInfoV2Length) {
+    error("getTimeSliceIndex: no time stamp for read out "+IntToStr(rReadOut));
+    throw std::out_of_range("Read out time stamp index out of range.");
+  }
+  int64_t tIndex = (int64_t) std::floor((_metaInfoV2[rReadOut].startTimeStamp - _metaInfoV2[0].startTimeStamp) / _timeSliceLength);
+  rStartTimeStamp = _metaInfoV2[0].startTimeStamp + (double) tIndex * _timeSliceLength;
+  return tIndex;
+}
+
+void Histogram::addTimeSliceHit(const unsigned int& rPixel, const unsigned int& rTot, const unsigned int& rReadOut)
+{
+  if (_actualTimeSlice.nHits == 0 || rReadOut != _actualTimeSliceReadOut) {  // the slice is only calculated for a new read out
+    double tStartTimeStamp = 0;
+    int64_t tIndex = getTimeSliceIndex(rReadOut, tStartTimeStamp);
+    if (_actualTimeSlice.nHits != 0 && tIndex != _actualTimeSlice.index)
+      closeTimeSlice();
+    if (_actualTimeSlice.nHits == 0) {
+      _actualTimeSlice.index = tIndex;
+      _actualTimeSlice.startTimeStamp = tStartTimeStamp;
+    }
+    _actualTimeSliceReadOut = rReadOut;
+  }
+  if (_actualTimeSliceHits[rPixel]++ == 0)
+    _actualTimeSlicePixels.push_back(rPixel);
+  _actualTimeSliceTotSums[rPixel] += rTot;
+  ++_actualTimeSlice.nHits;
+}
+
+void Histogram::closeTimeSlice()
+{
+  if (_actualTimeSlice.nHits == 0)
+    return;
+  std::sort(_actualTimeSlicePixels.begin(), _actualTimeSlicePixels.end());
+  _actualTimeSlice.bins.resize(_actualTimeSlicePixels.size());
+  for (size_t i = 0; i < _actualTimeSlicePixels.size(); ++i) {
+    unsigned int tPixel = _actualTimeSlicePixels[i];
+    _actualTimeSlice.bins[i].pixel = tPixel;
+    _actualTimeSlice.bins[i].hits = _actualTimeSliceHits[tPixel];
+    _actualTimeSlice.bins[i].totSum = _actualTimeSliceTotSums[tPixel];
+    _actualTimeSliceHits[tPixel] = 0;
+    _actualTimeSliceTotSums[tPixel] = 0;
+  }
+  _actualTimeSlicePixels.clear();
+  addTimeSlice(_actualTimeSlice);
+  _actualTimeSlice.nHits = 0;
+}
+
+void Histogram::addTimeSlice(const TimeSlice& rTimeSlice)
+{
+  std::deque<TimeSlice>::iterator tSlice = _timeSlices.end();
+  while (tSlice != _timeSlices.begin() && (tSlice - 1)->index >= rTimeSlice.index)  // the slice is usually the newest
+    --tSlice;
+  if (tSlice == _timeSlices.end() || tSlice->index != rTimeSlice.index) {
+    tSlice = _timeSlices.insert(tSlice, TimeSlice());
+    tSlice->index = rTimeSlice.index;
+    tSlice->startTimeStamp = rTimeSlice.startTimeStamp;
+    tSlice->nHits = 0;
+  }
+  std::vector<TimeSliceBin> tBins;  // sorted merge of the hit pixels
+  tBins.reserve(tSlice->bins.size() + rTimeSlice.bins.size());
+  std::vector<TimeSliceBin>::const_iterator i = tSlice->bins.begin(), j = rTimeSlice.bins.begin();
+  while (i != tSlice->bins.end() || j != rTimeSlice.bins.end()) {
+    if (j == rTimeSlice.bins.end() || (i != tSlice->bins.end() && i->pixel < j->pixel))
+      tBins.push_back(*i++);
+    else if (i == tSlice->bins.end() || j->pixel < i->pixel)
+      tBins.push_back(*j++);
+    else {
+      TimeSliceBin tBin = {i->pixel, i->hits + j->hits, i->totSum + j->totSum};
+      tBins.push_back(tBin);
+      ++i;
+      ++j;
+    }
+  }
+  tSlice->bins.swap(tBins);
+  tSlice->nHits += rTimeSlice.nHits;
+  while (_timeSlices.size() > _nTimeSlices)  // ring, the oldest slices are dropped
+    _timeSlices.pop_front();
+}
+
+void Histogram::merge(const Histogram& rHistogram)
+{
+  info("merge(...)");
+  if (&rHistogram == this)
+    throw std::invalid_argument("A histogram cannot be merged with itself.");
+  if (_NparameterValues != rHistogram._NparameterValues)
+    throw std::invalid_argument("The histograms to merge have different numbers of scan parameters.");
+  if ((_occupancy == 0) != (rHistogram._occupancy == 0) || (_totSum == 0) != (rHistogram._totSum == 0) || (_relBcid == 0) != (rHistogram._relBcid == 0) || (_tot == 0) != (rHistogram._tot == 0) || (_tdcValue == 0) != (rHistogram._tdcValue == 0)
+      || (_tdcTriggerDistance == 0) != (rHistogram._tdcTriggerDistance == 0) || (_totPixel == 0) != (rHistogram._totPixel == 0) || _tdcPixelBins.empty() != rHistogram._tdcPixelBins.empty())
+    throw std::invalid_argument("The histograms to merge have to be created in both.");
+  if ((_nTimeSlices == 0) != (rHistogram._nTimeSlices == 0) || (_nTimeSlices > 0 && _timeSliceLength != rHistogram._timeSliceLength))
+    throw std::invalid_argument("The time slices to merge have different settings.");
+  if (!_tdcPixelBins.empty() && (_tdcPixelMinTdc != rHistogram._tdcPixelMinTdc || _tdcPixelBinWidth != rHistogram._tdcPixelBinWidth || _nTdcPixelBins != rHistogram._nTdcPixelBins))
+    throw std::invalid_argument("The TDC pixel histograms to merge have different ranges.");
+
+  FillGuard tFillGuard(*this);
+  if (_sparseReset && !rHistogram._sparseReset) {  // the filled blocks of rHistogram are not marked, all blocks are added and marked
+    setSparseReset(false);
+    addChunkHistograms(rHistogram);
+    setSparseReset(true);
+  }
+  else
+    addChunkHistograms(rHistogram);
+  unsigned int tNsteps = std::min(_nThresholdScanSteps, rHistogram._nThresholdScanSteps);  // the running sums are added for the steps completed in both
+  for (size_t i = 0; i < (size_t)RAW_DATA_MAX_COLUMN * (size_t)RAW_DATA_MAX_ROW * (size_t)tNsteps; ++i)
+    _cumulatedOccupancy[i] += rHistogram._cumulatedOccupancy[i];
+  _nThresholdScanSteps = tNsteps;
+}
+
+std::string Histogram::serialize()
+{
+  info("serialize()");
+  // the mean ToT and RMS are calculated from the ToT sums and the dense TDC pixel histogram from the sparse one,
+  // the threshold scan sums from the occupancy; only the number of completed steps is stored
+  std::string tData("PBH");
+  writeNumber(tData, __HISTOGRAM_FORMAT_VERSION);
+  writeNumber(tData, (_createOccHist ? 1 : 0) | (_createRelBCIDhist ? 2 : 0) | (_createTotHist ? 4 : 0) | (_createMeanTotHist ? 8 : 0) | (_createTdcValueHist ? 16 : 0) | (_createTdcTriggerDistanceHist ? 32 : 0)
+      | (_createTdcPixelHist ? 64 : 0) | (_createTotPixelHist ? 128 : 0) | (_sparseReset ? 256 : 0) | (_occupancy != 0 ? 512 : 0) | (_totSum != 0 ? 1024 : 0));
+  writeNumber(tData, _maxTot);
+  writeNumber(tData, _tdcPixelMinTdc);
+  writeNumber(tData, _tdcPixelBinWidth);
+  writeNumber(tData, _nTdcPixelBins);
+  writeNumber(tData, _NparameterValues);
+  writeNumber(tData, _parameterValues.size());
+  for (std::map<int, unsigned int>::const_iterator it = _parameterValues.begin(); it != _parameterValues.end(); ++it) {
+    writeNumber(tData, (unsigned int) it->first);
+    writeNumber(tData, it->second);
+  }
+  writeNumber(tData, _nThresholdScanSteps);
+  uint64_t tTimeSliceLength = 0;
+  std::memcpy(&tTimeSliceLength, &_timeSliceLength, sizeof(double));
+  writeNumber(tData, _nTimeSlices);
+  writeNumber(tData, tTimeSliceLength);
+
+  size_t tNbins = (size_t)RAW_DATA_MAX_COLUMN * (size_t)RAW_DATA_MAX_ROW * (size_t)_NparameterValues;
+  if (_occupancy != 0)
+    writeArray(tData, _occupancy, tNbins);
+  if (_totSum != 0) {
+    writeArray(tData, _totSum, tNbins);
+    writeArray(tData, _totSquareSum, tNbins);
+  }
+  if (_relBcid != 0)
+    writeArray(tData, _relBcid, __MAXBCID);
+  if (_tot != 0)
+    writeArray(tData, _tot, __MAXHITTOT + 1);
+  if (_tdcValue != 0)
+    writeArray(tData, _tdcValue, __N_TDC_VALUES);
+  if (_tdcTriggerDistance != 0)
+    writeArray(tData, _tdcTriggerDistance, __N_TDC_TRG_DIST_VALUES);
+  if (_totPixel != 0)
+    writeArray(tData, _totPixel, (size_t)RAW_DATA_MAX_COLUMN * (size_t)RAW_DATA_MAX_ROW * ((size_t)__MAXHITTOT + 1));
+  for (size_t i = 0; i < _tdcPixelBins.size(); ++i) {  // the filled bins of each pixel with the distance to the bin in front
+    writeNumber(tData, _tdcPixelBins[i].size());
+    unsigned int tLastBin = 0;
+    for (TdcPixelBins::const_iterator j = _tdcPixelBins[i].begin(); j != _tdcPixelBins[i].end(); ++j) {
+      writeNumber(tData, j->bin - tLastBin);
+      writeNumber(tData, j->count);
+      tLastBin = j->bin;
+    }
+  }
+  writeNumber(tData, _timeSlices.size());  // the actual slice is moved into the history at the end of each fill
+  for (std::deque<TimeSlice>::const_iterator it = _timeSlices.begin(); it != _timeSlices.end(); ++it) {
+    uint64_t tStartTimeStamp = 0;
+    std::memcpy(&tStartTimeStamp, &it->startTimeStamp, sizeof(double));
+    writeNumber(tData, (uint64_t) it->index);
+    writeNumber(tData, tStartTimeStamp);
+    writeNumber(tData, it->bins.size());
+    unsigned int tLastPixel = 0;
+    for (std::vector<TimeSliceBin>::const_iterator j = it->bins.begin(); j != it->bins.end(); ++j) {
+      writeNumber(tData, j->pixel - tLastPixel);
+      writeNumber(tData, j->hits);
+      writeNumber(tData, j->totSum);
+      tLastPixel = j->pixel;
+    }
+  }
+  return tData;
+}
+
+void Histogram::deserialize(const std::string& rData)
+{
+  info("deserialize(...)");
+  size_t tPosition = 3;
+  if (rData.compare(0, 3, "PBH") != 0 || readNumber(rData, tPosition) != __HISTOGRAM_FORMAT_VERSION)
+    throw std::invalid_argument("The data is no serialized histogram of format version " + IntToStr(__HISTOGRAM_FORMAT_VERSION) + ".");
+  uint64_t tFlags = readNumber(rData, tPosition);
+  uint64_t tMaxTot = readNumber(rData, tPosition);
+  uint64_t tTdcPixelMinTdc = readNumber(rData, tPosition);
+  uint64_t tTdcPixelBinWidth = readNumber(rData, tPosition);
+  uint64_t tNtdcPixelBins = readNumber(rData, tPosition);
+  uint64_t tNparameterValues = readNumber(rData, tPosition);
+  uint64_t tNparameterValuesMap = readNumber(rData, tPosition);
+  std::map<int, unsigned int> tParameterValues;
+  for (uint64_t i = 0; i < tNparameterValuesMap; ++i) {
+    int tParameterValue = (int) (unsigned int) readNumber(rData, tPosition);
+    tParameterValues[tParameterValue] = (unsigned int) readNumber(rData, tPosition);
+  }
+  uint64_t tNthresholdScanSteps = readNumber(rData, tPosition);
+  uint64_t tNtimeSlices = readNumber(rData, tPosition);
+  uint64_t tTimeSliceLengthBits = readNumber(rData, tPosition);
+  double tTimeSliceLength = 0;
+  std::memcpy(&tTimeSliceLength, &tTimeSliceLengthBits, sizeof(double));
+  if (tNtimeSlices > std::numeric_limits<unsigned int>::max() || !(tTimeSliceLength >= 0))
+    throw std::invalid_argument("The serialized time slice settings are out of range.");
+  if (tMaxTot > __MAXHITTOT || tTdcPixelBinWidth == 0 || tTdcPixelMinTdc + tNtdcPixelBins > __N_TDC_VALUES || tNtdcPixelBins == 0 || tNparameterValues == 0 || tNparameterValues > std::numeric_limits<unsigned int>::max() || tNthresholdScanSteps > tNparameterValues)
+    throw std::invalid_argument("The serialized histogram settings are out of range.");
+
+  FillGuard tFillGuard(*this);
+  _maxTot = (unsigned int) tMaxTot;
+  _sparseReset = (tFlags & 256) != 0;  // all blocks are marked by the allocation
+  _NparameterValues = (unsigned int) tNparameterValues;
+  _parameterValues.swap(tParameterValues);
+  _createOccHist = (tFlags & 1) != 0;
+  _createMeanTotHist = (tFlags & 8) != 0;
+  if ((tFlags & 512) != 0)
+    allocateOccupancyArray();
+  else
+    deleteOccupancyArray();
+  if ((tFlags & 1024) != 0)
+    allocateMeanTotArray();
+  else
+    deleteMeanTotArray();
+  createRelBCIDHist((tFlags & 2) != 0);
+  createTotHist((tFlags & 4) != 0);
+  createTdcValueHist((tFlags & 16) != 0);
+  createTdcTriggerDistanceHist((tFlags & 32) != 0);
+  createTotPixelHist((tFlags & 128) != 0);
+  _tdcPixelMinTdc = (unsigned int) tTdcPixelMinTdc;
+  _tdcPixelBinWidth = (unsigned int) tTdcPixelBinWidth;
+  _nTdcPixelBins = (unsigned int) tNtdcPixelBins;
+  createTdcPixelHist(false);  // the dense histogram can have another number of bins
+  createTdcPixelHist((tFlags & 64) != 0);
+  setTimeSlices((unsigned int) tNtimeSlices, tTimeSliceLength);
+
+  try {
+    size_t tNbins = (size_t)RAW_DATA_MAX_COLUMN * (size_t)RAW_DATA_MAX_ROW * (size_t)_NparameterValues;
+    if (_occupancy != 0)
+      readArray(rData, tPosition, _occupancy, tNbins);
+    if (_totSum != 0) {
+      readArray(rData, tPosition, _totSum, tNbins);
+      readArray(rData, tPosition, _totSquareSum, tNbins);
+    }
+    if (_relBcid != 0)
+      readArray(rData, tPosition, _relBcid, __MAXBCID);
+    if (_tot != 0)
+      readArray(rData, tPosition, _tot, __MAXHITTOT + 1);
+    if (_tdcValue != 0)
+      readArray(rData, tPosition, _tdcValue, __N_TDC_VALUES);
+    if (_tdcTriggerDistance != 0)
+      readArray(rData, tPosition, _tdcTriggerDistance, __N_TDC_TRG_DIST_VALUES);
+    if (_totPixel != 0)
+      readArray(rData, tPosition, _totPixel, (size_t)RAW_DATA_MAX_COLUMN * (size_t)RAW_DATA_MAX_ROW * ((size_t)__MAXHITTOT + 1));
+    for (size_t i = 0; i < _tdcPixelBins.size(); ++i) {
+      uint64_t tNfilledBins = readNumber(rData, tPosition);
+      uint64_t tBin = 0;
+      for (uint64_t j = 0; j < tNfilledBins; ++j) {
+        tBin += readNumber(rData, tPosition);
+        if ((j > 0 && tBin == _tdcPixelBins[i].back().bin) || tBin >= _nTdcPixelBins)
+          throw std::invalid_argument("The serialized TDC pixel histogram bins are not sorted or out of range.");
+        TdcPixelBin tTdcPixelBin = {(unsigned short) tBin, (unsigned int) readNumber(rData, tPosition)};
+        _tdcPixelBins[i].push_back(tTdcPixelBin);
+      }
+    }
+    uint64_t tNhistorySlices = readNumber(rData, tPosition);
+    for (uint64_t i = 0; i < tNhistorySlices; ++i) {
+      TimeSlice tTimeSlice;
+      tTimeSlice.index = (int64_t) readNumber(rData, tPosition);
+      uint64_t tStartTimeStamp = readNumber(rData, tPosition);
+      std::memcpy(&tTimeSlice.startTimeStamp, &tStartTimeStamp, sizeof(double));
+      if ((i > 0 && tTimeSlice.index <= _timeSlices.back().index) || i >= _nTimeSlices)
+        throw std::invalid_argument("The serialized time slices are not sorted or too many.");
+      uint64_t tNbins = readNumber(rData, tPosition);
+      if (tNbins > (uint64_t)RAW_DATA_MAX_COLUMN * (uint64_t)RAW_DATA_MAX_ROW)
+        throw std::invalid_argument("The serialized time slice has too many pixels.");
+      tTimeSlice.nHits = 0;
+      tTimeSlice.bins.resize((size_t) tNbins);
+      uint64_t tPixel = 0;
+      for (uint64_t j = 0; j < tNbins; ++j) {
+        tPixel += readNumber(rData, tPosition);
+        if ((j > 0 && tPixel == tTimeSlice.bins[j - 1].pixel) || tPixel >= (uint64_t)RAW_DATA_MAX_COLUMN * (uint64_t)RAW_DATA_MAX_ROW)
+          throw std::invalid_argument("The serialized time slice pixels are not sorted or out of range.");
+        tTimeSlice.bins[j].pixel = (unsigned int) tPixel;
+        tTimeSlice.bins[j].hits = (unsigned int) readNumber(rData, tPosition);
+        tTimeSlice.bins[j].totSum = readNumber(rData, tPosition);
+        tTimeSlice.nHits += tTimeSlice.bins[j].hits;
+      }
+      _timeSlices.push_back(tTimeSlice);
+    }
+    if (tPosition != rData.size())
+      throw std::invalid_argument("The serialized histogram has more data than expected.");
+    if (tNthresholdScanSteps > 0)
+      setThresholdScanSteps((unsigned int) tNthresholdScanSteps);
+  }
+  catch (...) {  // the histograms are empty if the data is corrupt, the scan parameter array is kept
+    int* tParInfo = _parInfo;
+    reset();
+    _parInfo = tParInfo;
+    throw;
+  }
+}
+
+void Histogram::writeNumber(std::string& rData, uint64_t pNumber)
+{
+  while (pNumber >= 128) {
+    rData.push_back((char) ((pNumber & 127) | 128));
+    pNumber >>= 7;
+  }
+  rData.push_back((char) pNumber);
+}
+
+uint64_t Histogram::readNumber(const std::string& rData, size_t& rPosition)
+{
+  uint64_t tNumber = 0;
+  for (unsigned int tShift = 0; tShift < 64; tShift += 7) {
+    if (rPosition >= rData.size())
+      throw std::invalid_argument("The serialized histogram data ends unexpectedly.");
+    unsigned char tByte = (unsigned char) rData[rPosition++];
+    tNumber |= (uint64_t) (tByte & 127) << tShift;
+    if (tByte < 128)
+      return tNumber;
+  }
+  throw std::invalid_argument("The serialized histogram data has a number out of range.");
+}
+
+template<typename T> void Histogram::writeArray(std::string& rData, const T* pArray, const size_t& rNbins)
+{
+  // each filled bin is stored with the number of empty bins in front, the empty bins at the end close the array
+  size_t tNemptyBins = 0;
+  for (size_t i = 0; i < rNbins; ++i) {
+    if (pArray[i] == 0) {
+      ++tNemptyBins;
+      continue;
+    }
+    writeNumber(rData, tNemptyBins);
+    writeNumber(rData, (uint64_t) pArray[i]);
+    tNemptyBins = 0;
+  }
+  writeNumber(rData, tNemptyBins);
+}
+
+template<typename T> void Histogram::readArray(const std::string& rData, size_t& rPosition, T* pArray, const size_t& rNbins)
+{
+  if (pArray == 0)
+    throw std::runtime_error("Histogram array not allocated.");
+  size_t tBin = 0;
+  while (true) {
+    uint64_t tNemptyBins = readNumber(rData, rPosition);
+    if (tNemptyBins > rNbins - tBin)
+      throw std::invalid_argument("The serialized histogram array has too many bins.");
+    std::fill(pArray + tBin, pArray + tBin + tNemptyBins, (T) 0);
+    tBin += tNemptyBins;
+    if (tBin == rNbins)
+      return;
+    pArray[tBin++] = (T) readNumber(rData, rPosition);
+  }
+}
@@ -5,9 +5,14 @@
 #include <algorithm>
 #include <iterator>
 #include <set>
+#include <deque>
+#include <cstring>
+#include <cstddef>
 
 #include "defines.h"
 #include "Basis.h"
+#include "CpuDispatch.h"
+#include "Threads.h"
 
 class Histogram: public Basis
 {
@@ -18,12 +23,43 @@ public:
   // get histograms
   void getOccupancy(unsigned int& rNparameterValues, unsigned int*& rOccupancy, bool copy = false);  // returns the occupancy histogram for all hits
   void getTotHist(unsigned int*& rTotHist, bool copy = false);  // returns the tot histogram for all hits
-  void getMeanTot(unsigned int& rNparameterValues, float*& rMeanTot, bool copy = false);  // returns mean ToT per scan parameter for each pixel
+  void getMeanTot(unsigned int& rNparameterValues, float*& rMeanTot, bool copy = false);  // returns mean ToT per scan parameter for each pixel, calculated from the ToT sums, NAN without hits
+  void getRmsTot(unsigned int& rNparameterValues, float*& rRmsTot, bool copy = false);  // returns the ToT RMS per scan parameter for each pixel, calculated from the ToT sums, NAN without hits
   void getTdcValuesHist(unsigned int*& rTdcValueHist, bool copy = false);  // returns the tdc histogram for all hits
   void getTdcTriggerDistancesHist(unsigned int*& rTdcTriggerDistanceHist, bool copy = false);  // returns the tdc trigger distance histogram for all hits
   void getRelBcidHist(unsigned int*& rRelBcidHist, bool copy = false);  // returns the relative BCID histogram for all hits
   void getTotPixelHist(unsigned short*& rTotPixelHist, bool copy = false);  // returns the tot pixel histogram
-  void getTdcPixelHist(unsigned short*& rTdcPixelHist, bool copy = false);  // returns the tdc pixel histogram
+  void getTdcPixelHist(unsigned short*& rTdcPixelHist, bool copy = false);  // returns the tdc pixel histogram (linearly sorted via col, row, tdc bin) with getNtdcPixelHistBins() bins, filled from the sparse histogram on request, the counts saturate at 65535
+  unsigned int getNtdcPixelHistEntries();  // returns the number of filled bins of the tdc pixel histogram
+  void getTdcPixelHistEntries(unsigned short* pColumnIndex, unsigned short* pRowIndex, unsigned short* pTdcBin, unsigned int* pCount);  // copies the filled bins of the tdc pixel histogram with the full counts, the arrays need getNtdcPixelHistEntries() elements
+
+  // consistent snapshots of the histograms while another thread fills them, the snapshot is taken at a point where
+  // all hits of the fill calls (or events if filled by the interpreter) before are histogrammed and none of the following;
+  // only one thread may take snapshots, the snapshot arrays are valid until its next takeSnapshot() call;
+  // the filling thread itself may take snapshots between events, e.g. from the event callback of the interpreter
+  void takeSnapshot();  // copies all created histograms into the snapshot arrays without stalling the filling thread
+  void getSnapshotOccupancy(unsigned int& rNparameterValues, unsigned int*& rOccupancy);  // returns the occupancy histogram of the last snapshot, 0 if not created
+  void getSnapshotTotHist(unsigned int*& rTotHist);
+  void getSnapshotTdcValuesHist(unsigned int*& rTdcValueHist);
+  void getSnapshotTdcTriggerDistancesHist(unsigned int*& rTdcTriggerDistanceHist);
+  void getSnapshotRelBcidHist(unsigned int*& rRelBcidHist);
+  void getSnapshotMeanTot(unsigned int& rNparameterValues, float*& rMeanTot);
+  void getSnapshotRmsTot(unsigned int& rNparameterValues, float*& rRmsTot);
+  void getSnapshotTotPixelHist(unsigned short*& rTotPixelHist);
+  void getSnapshotTdcPixelHist(unsigned int& rNtdcBins, unsigned short*& rTdcPixelHist);  // the snapshot keeps the sparse TDC pixel histogram, the dense histogram is filled on request
+
+  // marks the filling of the histograms for the snapshots, only needed if the histograms are filled from outside
+  void beginFill();  // the histograms are not consistent until endFill() is called, fills can be nested
+  void endFill();  // the histograms are consistent, a requested snapshot is taken
+  void serveSnapshot() {if (_snapshotState == __SNAPSHOT_REQUESTED) copySnapshot(true);};  // takes a requested snapshot, has to be called by the filling thread at points where the histograms are consistent
+  class FillGuard  // calls beginFill() and endFill() for a scope
+  {
+  public:
+    FillGuard(Histogram& rHistogram): _histogram(rHistogram) {_histogram.beginFill();}
+    ~FillGuard() {_histogram.endFill();}
+  private:
+    Histogram& _histogram;
+  };
 
   // options set/get
   void createOccupancyHist(bool createOccHist = true);
@@ -35,16 +71,31 @@ public:
   void createTdcPixelHist(bool createTdcPixelHist = true);
   void createTotPixelHist(bool createTotPixelHist = true);
   void setMaxTot(const unsigned int& rMaxTot);
+  void setTdcPixelHistRange(const unsigned int& rMinTdc, const unsigned int& rMaxTdc, const unsigned int& rTdcBinWidth = 1);  // the tdc pixel histogram has bins of rTdcBinWidth TDC values from rMinTdc to rMaxTdc (exclusive), other TDC values are not histogrammed; resets the tdc pixel histogram
+  unsigned int getNtdcPixelHistBins() {return _nTdcPixelBins;};
+  unsigned int getMaxTot() {return _maxTot;};
+  void setSparseReset(bool rSparseReset = true);  // the resets only clear the blocks of the pixel histograms that were filled since the last reset, for histograms with few hit pixels that are reset often
+  bool getSparseReset() {return _sparseReset;};
+  void setNthreads(const unsigned int& rNthreads, const unsigned int& rMinHitsPerThread = __PARALLEL_MIN_HITS);  // histograms hit arrays with at least rMinHitsPerThread hits per thread in parallel, 0 uses all cores; the result is the same as for the serial histogramming
+  unsigned int getNthreads() {return _nThreads;};
 
   void addHits(HitInfo*& rHitInfo, const unsigned int& rNhits);
   void addClusterSeedHits(ClusterInfo*& rClusterInfo, const unsigned int& rNcluster);
+  void addEventHits(const HitInfo* pHits, const unsigned int& rNhits, const EventInfo& rEventInfo, const unsigned int& rReadOutIndex);  // histograms the hits of one event directly from the interpreter, the column and row are checked like in addHits and the scan parameter is the one of the read out rReadOutIndex
   void addScanParameter(int*& rParInfo, const unsigned int& rNparInfoLength);
   void setNoScanParameter();
   void addMetaEventIndex(uint64_t*& rMetaEventIndex, const unsigned int& rNmetaEventIndexLength);
 
-  void calculateThresholdScanArrays(double rMuArray[], double rSigmaArray[], const unsigned int& rMaxInjections, const unsigned int& min_parameter, const unsigned int& max_parameter);  // takes the occupancy histograms for different parameters for the threshold arrays
+  void calculateThresholdScanArrays(double rMuArray[], double rSigmaArray[], const unsigned int& rMaxInjections, const unsigned int& min_parameter, const unsigned int& max_parameter, const bool& rFitSCurves = false);  // takes the occupancy histograms for different parameters for the threshold arrays, with rFitSCurves the S-curve of each pixel is fitted starting at the fast algorithm values; uses getNthreads() threads
+
+  void setThresholdScanSteps(const unsigned int& rNsteps);  // the first rNsteps parameters of a threshold scan are completely histogrammed, adds their occupancies to the running sums
+  unsigned int getThresholdScanSteps() {return _nThresholdScanSteps;};
+  void calculateThresholdScanEstimates(double rMuArray[], double rSigmaArray[], const unsigned int& rMaxInjections, const unsigned int& min_parameter, const unsigned int& max_parameter);  // thresholds and noise of the fast algorithm from the running sums of the completed steps, the following steps are taken as fully occupied; after the last step the same as calculateThresholdScanArrays
 
   unsigned int getNparameters();  // returns the parameter range from _parInfo
+  unsigned int* getReadOutOccupancy(const unsigned int& rReadOutIndex);  // returns the occupancy histogram of the scan parameter of the read out rReadOutIndex, to be filled directly by the interpreter
+  void getReadOutTotSums(const unsigned int& rReadOutIndex, uint64_t*& rTotSum, uint64_t*& rTotSquareSum);  // returns the ToT sums of the scan parameter of the read out rReadOutIndex for the hits filled into getReadOutOccupancy, 0 if the mean ToT is not histogrammed
+  std::string getSimdVersion() {return getSimdLevelName(_simdLevel);};  // returns the instruction set of the addHits version in use
 
   void resetOccupancyArray();
   void resetTotArray();
@@ -57,6 +108,20 @@ public:
 
   void reset();  // resets the histograms and keeps the settings
 
+  // time sliced history of the occupancy and ToT sums of all scan parameters, a slice is a read out or an interval of the MetaInfoV2 start time stamps;
+  // a slice only keeps the pixels hit in it (the delta to the slice in front), the history is a ring of the newest slices
+  void setTimeSlices(const unsigned int& rNslices, const double& rSliceLength = 0);  // keeps the rNslices newest slices of rSliceLength seconds, 0 seconds for one slice per read out, 0 slices disables the history; clears the history
+  void setMetaTimeStamps(MetaInfoV2*& rMetaInfo, const unsigned int& rNmetaInfoLength);  // the meta data of the read outs of the meta event index array, needed for slices of rSliceLength seconds
+  unsigned int getNtimeSlices() {return (unsigned int) _timeSlices.size();};
+  void getTimeSlices(int64_t* pSliceIndex, double* pStartTimeStamp, unsigned int* pNhits);  // slice index, start time stamp and number of hits of the slices in the history, oldest first; the arrays need getNtimeSlices() elements
+  void getTimeSliceOccupancy(const unsigned int& rFirstSlice, const unsigned int& rLastSlice, unsigned int* pOccupancy, uint64_t* pTotSum);  // sums the history slices rFirstSlice to rLastSlice (exclusive) into the occupancy and ToT sum of each pixel (col + row * 80), pTotSum can be 0
+  void resetTimeSlices();
+
+  // combining the partial histograms of several processes, e.g. in a tree reduction of the worker results
+  void merge(const Histogram& rHistogram);  // adds the histograms, ToT sums and threshold scan sums of rHistogram, the same histograms have to be created for the same number of scan parameters and TDC pixel histogram range
+  std::string serialize();  // compact binary copy of the settings, the scan parameter values and all created histograms including the ToT sums, the completed threshold scan steps and the time slices
+  void deserialize(const std::string& rData);  // replaces the settings, the scan parameter values and the histograms with the serialized ones, the scan parameter and meta event index arrays are kept to fill more hits
+
 private:
   void setStandardSettings();
   void allocateOccupancyArray();
@@ -76,21 +141,161 @@ private:
   void deleteTotPixelArray();
   void deleteTdcPixelArray();
 
+  // sparse reset, the pixel histograms are divided into blocks of __RESET_BLOCK_SIZE bins that are marked if they were filled;
+  // the marks are only set with _sparseReset, all blocks are marked if it is enabled
+  bool _sparseReset;
+  std::vector<unsigned char> _occupancyFilledBlocks;
+  std::vector<unsigned char> _totSumFilledBlocks;
+  std::vector<unsigned char> _totPixelFilledBlocks;
+  static void markFilledBlocks(std::vector<unsigned char>& rFilledBlocks, const size_t& rFirstBin, const size_t& rNbins);
+  template<typename T> static void resetArray(T* pArray, const size_t& rNbins, const std::vector<unsigned char>& rFilledBlocks, const bool& rSparseReset);  // clears the array or only its filled blocks
+  template<typename T> static void addArray(T* pArray, const T* pOtherArray, const size_t& rNbins, std::vector<unsigned char>& rFilledBlocks, const std::vector<unsigned char>& rOtherFilledBlocks, const bool& rSparseReset);  // adds the array or only its filled blocks
+
+  // sparse TDC pixel histogram, most pixels have hits in few TDC bins
+  struct TdcPixelBin
+  {
+    unsigned short bin;
+    unsigned int count;
+  };
+  typedef std::vector<TdcPixelBin> TdcPixelBins;  // the filled bins of one pixel sorted by the bin
+  static bool tdcPixelBinLess(const TdcPixelBin& rTdcPixelBin, const unsigned short& rBin) {return rTdcPixelBin.bin < rBin;};
+  static void addTdcPixelBin(TdcPixelBins& rTdcPixelBins, const unsigned short& rBin, const unsigned int& rCount);
+  static void addTdcPixelBins(TdcPixelBins& rTdcPixelBins, const TdcPixelBins& rOtherTdcPixelBins);  // adds the bins of rOtherTdcPixelBins with a sorted merge
+  static void fillTdcPixelArray(const std::vector<TdcPixelBins>& rTdcPixelBins, const unsigned int& rNtdcBins, unsigned short* pTdcPixel);  // fills the dense histogram, the counts saturate at 65535
+
+  // time slices, the hits of the actual slice are counted in dense arrays and moved into the history at the end of each fill
+  struct TimeSliceBin
+  {
+    unsigned int pixel;
+    unsigned int hits;
+    uint64_t totSum;
+  };
+  struct TimeSlice
+  {
+    int64_t index;  // read out index or number of rSliceLength intervals since the first read out
+    double startTimeStamp;
+    unsigned int nHits;
+    std::vector<TimeSliceBin> bins;  // the hit pixels sorted by the pixel index
+  };
+  int64_t getTimeSliceIndex(const unsigned int& rReadOut, double& rStartTimeStamp);
+  void addTimeSliceHit(const unsigned int& rPixel, const unsigned int& rTot, const unsigned int& rReadOut);
+  void closeTimeSlice();  // moves the hits of the actual slice into the history
+  void addTimeSlice(const TimeSlice& rTimeSlice);  // adds the slice to the history slice with the same index or inserts it, the oldest slices beyond the ring size are dropped
+  unsigned int _nTimeSlices;  // size of the history ring, 0 if no history is kept
+  double _timeSliceLength;  // 0 for one slice per read out
+  MetaInfoV2* _metaInfoV2;  // time stamps of the read outs
+  unsigned int _nMetaInfoV2Length;
+  std::deque<TimeSlice> _timeSlices;  // the history, oldest first
+  TimeSlice _actualTimeSlice;  // the slice that is filled, the bins are the hits of the pixels in _actualTimeSlicePixels
+  unsigned int _actualTimeSliceReadOut;  // read out of the last hit, it belongs to the actual slice
+  std::vector<unsigned int> _actualTimeSliceHits;  // hits of each pixel of the actual slice
+  std::vector<uint64_t> _actualTimeSliceTotSums;
+  std::vector<unsigned int> _actualTimeSlicePixels;  // the pixels hit in the actual slice
+
+  // serialization, the numbers are stored with 7 bits per byte and the empty bins of the arrays as run lengths
+  static void writeNumber(std::string& rData, uint64_t pNumber);
+  static uint64_t readNumber(const std::string& rData, size_t& rPosition);  // throws std::invalid_argument at the end of the data
+  template<typename T> static void writeArray(std::string& rData, const T* pArray, const size_t& rNbins);
+  template<typename T> static void readArray(const std::string& rData, size_t& rPosition, T* pArray, const size_t& rNbins);
+
+  void addHitsSerial(HitInfo*& rHitInfo, const unsigned int& rNhits);  // calls the addHits version of the instruction set in use
+  void addHitsBaseline(HitInfo*& rHitInfo, const unsigned int& rNhits);  // addHits compiled for the baseline instruction set
+#ifdef __SIMD_HAVE_AVX2
+  __SIMD_TARGET_AVX2 void addHitsAvx2(HitInfo*& rHitInfo, const unsigned int& rNhits);  // addHits with the hit values of 8 hits checked at once, only called if the CPU supports AVX2
+#endif
+  __SIMD_FORCE_INLINE void addHitsKernel(HitInfo*& rHitInfo, const unsigned int& rNhits);  // addHits implementation shared by the instruction set versions
+  __SIMD_FORCE_INLINE void addCheckedHit(HitInfo& rHit, const unsigned int& rColumnIndex, const unsigned int& rRowIndex, const unsigned int& rTot, const unsigned int& rRelBcid, const unsigned int& rTdc, const unsigned int& rTdcTriggerDistance);  // adds one hit with checked values to the histograms of its scan parameter and to the time slices
+  __SIMD_FORCE_INLINE void fillHit(const unsigned int& rColumnIndex, const unsigned int& rRowIndex, const unsigned int& rTot, const unsigned int& rRelBcid, const unsigned short& rEventStatus, const unsigned int& rTdc, const unsigned int& rTdcTriggerDistance, const unsigned int& rParIndex);  // adds one hit with checked values to the histograms
+  unsigned int _simdLevel;  // instruction set level of the CPU, selects the addHits version
+
+  // parallel histogramming, the hits are split into chunks that are histogrammed into separate histograms and added
+  struct ParallelChunk
+  {
+    Histogram* histogram;  // this histogram for the first chunk
+    HitInfo* hits;
+    unsigned int nHits;
+    std::string error;  // the exception message if the chunk could not be histogrammed, the histograms hold the hits in front of the failing hit
+    bool outOfRange;  // the exception was a std::out_of_range
+  };
+  void addHitsParallel(HitInfo*& rHitInfo, const unsigned int& rNhits, const unsigned int& rNchunks);
+  static void addHitsParallelChunk(ParallelChunk& rChunk);  // histograms the hits of the chunk, does not throw
+  void copySettings(const Histogram& rHistogram);  // takes the settings and the scan parameters of rHistogram for a chunk histogram, the histograms are empty afterwards
+  void addChunkHistograms(const Histogram& rHistogram);  // adds the histograms of a chunk histogram
+  std::vector<Histogram*> _chunkHistograms;  // histograms for the parallel chunks, kept for the next call
+  unsigned int _nThreads;  // number of threads for the parallel histogramming, 1 for serial histogramming
+  unsigned int _minHitsPerThread;  // minimum number of hits per thread for the parallel histogramming
+
+  // threshold scan analysis, the pixels are processed in blocks of __THRESHOLD_BLOCK_SIZE pixels that read contiguous parameter slices
+  struct ThresholdScanTask
+  {
+    const unsigned int* occupancy;
+    unsigned int nParameters;
+    unsigned int firstPixel;
+    unsigned int lastPixel;  // exclusive
+    unsigned int maxInjections;
+    double minParameter;
+    double maxParameter;
+    double parameterStep;
+    bool fitSCurves;
+    double* mu;
+    double* sigma;
+  };
+  static void calculateThresholdScanTask(ThresholdScanTask& rTask);  // calculates the thresholds and noise of the pixels of the task, does not throw
+  static void fitSCurve(const double* pOccupancy, const unsigned int& rNparameters, const double& rMaxInjections, const double& rMinParameter, const double& rParameterStep, double& rMu, double& rSigma);  // error function least squares fit (Levenberg-Marquardt) starting at rMu, rSigma, they are kept if the fit does not converge
+  unsigned int* _cumulatedOccupancy;  // running sums of the threshold scan, occupancy of each pixel summed up to the parameter (linearly sorted via col, row, parameter), 0 if not used
+  unsigned int _nThresholdScanSteps;  // number of completed threshold scan steps in _cumulatedOccupancy
+  static double getSCurveChi2(const double* pOccupancy, const unsigned int& rNparameters, const double& rMaxInjections, const double& rMinParameter, const double& rParameterStep, const double& rMu, const double& rSigma);
+
+  // snapshots, seqlock like: _fillSequence is odd while the histograms are filled; the snapshot is copied by the
+  // snapshot thread if no fill is ongoing or by the filling thread at the next consistent point otherwise
+  enum {__SNAPSHOT_IDLE, __SNAPSHOT_REQUESTED, __SNAPSHOT_COPYING};
+  bool copySnapshot(bool rFromFillingThread);  // copies the histograms into the snapshot arrays if it can claim the requested snapshot, returns true if copied
+  volatile unsigned int _fillSequence;
+  unsigned int _fillDepth;  // number of nested fills, only used by the filling thread
+  ThreadId _fillingThread;  // set before _fillSequence becomes odd, valid while it is odd
+  volatile unsigned int _snapshotState;
+  unsigned int _snapshotNparameterValues;
+  std::vector<unsigned int> _occupancySnapshot;
+  std::vector<unsigned int> _totSnapshot;
+  std::vector<unsigned int> _tdcValueSnapshot;
+  std::vector<unsigned int> _tdcTriggerDistanceSnapshot;
+  std::vector<unsigned int> _relBcidSnapshot;
+  std::vector<uint64_t> _totSumSnapshot;
+  std::vector<uint64_t> _totSquareSumSnapshot;
+  std::vector<float> _meanTotSnapshot;  // calculated from the snapshot ToT sums on request
+  std::vector<float> _rmsTotSnapshot;
+  std::vector<unsigned short> _totPixelSnapshot;
+  std::vector<TdcPixelBins> _tdcPixelBinsSnapshot;
+  unsigned int _snapshotNtdcPixelBins;
+  std::vector<unsigned short> _tdcPixelSnapshot;  // filled from the snapshot bins on request
+
   unsigned int* _occupancy;  // 2d hit histogram for each parameter (in total 3d, linearly sorted via col, row, parameter)
   unsigned int* _tot;  // ToT histogram
-  float* _meanTot;  // 2d hit mean ToT histogram for each parameter
+  uint64_t* _totSum;  // 2d hit ToT sum for each parameter, the mean ToT is the sum divided by the occupancy
+  uint64_t* _totSquareSum;  // 2d hit ToT square sum for each parameter for the ToT RMS
+  float* _meanTot;  // 2d hit mean ToT histogram for each parameter, calculated from the sums in getMeanTot
+  float* _rmsTot;  // 2d hit ToT RMS histogram for each parameter, calculated from the sums in getRmsTot
+  static void calculateTotMoments(const unsigned int* pOccupancy, const uint64_t* pTotSum, const uint64_t* pTotSquareSum, const size_t& rNbins, float* pMeanTot, float* pRmsTot);  // mean and RMS ToT from the sums, an output can be 0
   unsigned int* _tdcValue;  // TDC histogram
   unsigned int* _tdcTriggerDistance;  // TDC trigger distance histogram
-  unsigned short* _tdcPixel;  // 3d pixel TDC histogram (in total 3d, linearly sorted via col, row, tdc value)
+  std::vector<TdcPixelBins> _tdcPixelBins;  // sparse pixel TDC histogram, the filled TDC bins of each pixel (col + row * 80), empty if not created
+  unsigned short* _tdcPixel;  // 3d pixel TDC histogram (in total 3d, linearly sorted via col, row, tdc bin), filled from _tdcPixelBins in getTdcPixelHist
+  unsigned int _tdcPixelMinTdc;  // TDC value of the first bin of the pixel TDC histogram
+  unsigned int _tdcPixelBinWidth;  // TDC values per bin of the pixel TDC histogram
+  unsigned int _nTdcPixelBins;  // number of bins of the pixel TDC histogram
   unsigned short* _totPixel;  // 3d pixel ToT histogram (in total 3d, linearly sorted via col, row, tot value)
   unsigned int* _relBcid;  // relative BCID histogram
 
-  unsigned int getParIndex(int64_t& rEventNumber);  // returns the parameter index for the given event number
+  unsigned int getParIndex(int64_t& rEventNumber);  // returns the parameter index for the given event number, the events can be in any order
+  unsigned int getEventReadOut(int64_t& rEventNumber);  // returns the read out of the given event number from the meta event index, the events can be in any order
+  void updateMetaEventIndex();  // extends the set read outs of the meta event index array, the interpreter sets them between the fill calls
+  unsigned int getReadOutParIndex(const unsigned int& rReadOutIndex);  // returns the parameter index for the given read out
 
   unsigned int _nMetaEventIndexLength;  // length of the meta data event index array
   uint64_t* _metaEventIndex;  // event index of meta data array
+  unsigned int _nMetaEventIndexSet;  // the read outs in front are set, their start event numbers increase and are searched binary
   unsigned int _nParInfoLength;  // length of the parInfo array
-  uint64_t _lastMetaEventIndex;  // for loop speed up
+  uint64_t _lastMetaEventIndex;  // read out of the last event, checked before the binary search
 
   unsigned int _NparameterValues;  // needed for _occupancy histogram allocation
 
@@ -3,14 +3,15 @@
 Interpret::Interpret(void)
 {
   setSourceFileName("Interpret()");
+  _simdLevel = getSimdLevel();
   setStandardSettings();
-  allocateHitArray();
-  allocateHitBufferArray();
+  createWordTypeTable();
   allocateTriggerStatusCounterArray();
   allocateEventStatusCounterArray();
   allocateTdcValueArray();
   allocateTdcTriggerDistanceArray();
   allocateServiceRecordCounterArray();
+  allocateDiagnosticRecordsArray();
   reset();
 }
 
@@ -18,12 +19,16 @@ Interpret::~Interpret(void)
 {
   debug("~Interpret()");
   deleteHitArray();
+  deleteEventTableArrays();
   deleteHitBufferArray();
   deleteTriggerStatusCounterArray();
   deleteEventStatusCounterArray();
   deleteTdcValueArray();
   deleteTdcTriggerDistanceArray();
   deleteServiceRecordCounterArray();
+  deleteDiagnosticRecordsArray();
+  for (unsigned int i = 0; i < _chunkInterpreters.size(); ++i)
+    delete _chunkInterpreters[i];
 }
 
 void Interpret::setStandardSettings()
@@ -32,6 +37,20 @@ void Interpret::setStandardSettings()
   _hitInfoSize = 1000000;
   _hitInfo = 0;
   _hitIndex = 0;
+  _hitBuffer = 0;
+  _hitBufferSize = 0;
+  _maxHitBufferSize = __MAXHITBUFFERSIZE;
+  _slimHitInfo = 0;
+  _eventInfoSize = 1000000;
+  _eventInfo = 0;
+  _eventIndex = 0;
+  _createEventTable = false;
+  _eventCallback = 0;
+  _eventCallbackData = 0;
+  _storeEventHits = true;
+  _histogram = 0;
+  _externalHitArray = false;
+  _externalEventTableArrays = false;
   _startDebugEvent = 0;
   _stopDebugEvent = 0;
   _NbCID = 16;
@@ -55,6 +74,11 @@ void Interpret::setStandardSettings()
   _alignAtTdcWord = false;
   _dataWordIndex = 0;
   _maxTriggerNumber = (2 ^ 31) - 1;
+  _diagnosticRecords = 0;
+  _diagnosticRecordsSize = 0;
+  _nThreads = 1;
+  _minWordsPerThread = __PARALLEL_MIN_WORDS;
+  selectInterpretRawDataKernel();
 }
 
 bool Interpret::interpretRawData(unsigned int* pDataWords, const unsigned int& pNdataWords)
@@ -65,8 +89,35 @@ bool Interpret::interpretRawData(unsigned int* pDataWords, const unsigned int& p
     debug(tDebug.str());
   }
   _hitIndex = 0;
+  _eventIndex = 0;
   _actualMetaWordIndex = 0;
+  if (_createEventTable) {  // the output arrays are allocated when needed
+    if (_eventInfo == 0 || _slimHitInfo == 0)
+      allocateEventTableArrays();
+  } else if (_hitInfo == 0)
+    allocateHitArray();
+
+  _outputFull = false;
+  _nInterpretedWords = 0;
+  if (!_pendingEvents.empty() && !storePendingEvents()) {  // the events kept from the last call fill the output arrays already
+    _outputFull = true;
+    return false;
+  }
+  unsigned int tNchunks = std::min(_nThreads, pNdataWords / _minWordsPerThread);
+  bool tExternalOutputArrays = _createEventTable ? _externalEventTableArrays : _externalHitArray;  // caller owned output arrays can stop the interpretation at every event
+  if (tNchunks > 1 && !tExternalOutputArrays && _eventCallback == 0 && _histogram == 0 && !_debugEvents && !Basis::debugSet())  // the event callback and the histogram are called in event order by the calling thread
+    interpretRawDataParallel(pDataWords, pNdataWords, tNchunks);
+  else if (_histogram != 0) {
+    Histogram::FillGuard tFillGuard(*_histogram);  // histogram snapshots are taken between events
+    (this->*_interpretRawDataKernel)(pDataWords, pNdataWords);
+  } else
+    (this->*_interpretRawDataKernel)(pDataWords, pNdataWords);  // call the interpretation kernel for the actual option combination
+  return !_outputFull;
+}
 
+template <bool TFEI4B, bool TAlignAtTriggerNumber, bool TAlignAtTdcWord, unsigned int TTriggerDataFormat, bool THaveTdcTriggerTimeStamp, bool THaveTdcTriggerDistance, bool TDebugEvents>
+void Interpret::interpretRawDataKernel(unsigned int* pDataWords, const unsigned int& pNdataWords)
+{
   int tActualCol1 = 0;  // column position of the first hit in the actual data record
   int tActualRow1 = 0;  // row position of the first hit in the actual data record
   int tActualTot1 = -1;  // tot value of the first hit in the actual data record
@@ -74,25 +125,39 @@ bool Interpret::interpretRawData(unsigned int* pDataWords, const unsigned int& p
   int tActualRow2 = 0;  // row position of the second hit in the actual data record
   int tActualTot2 = -1;  // tot value of the second hit in the actual data record
 
-  for (unsigned int iWord = 0; iWord < pNdataWords; ++iWord) {  // loop over the SRAM words
-    if (_debugEvents) {
-      if (_nEvents >= _startDebugEvent && _nEvents <= _stopDebugEvent)
-        setDebugOutput();
-      else
-        setDebugOutput(false);
-      setInfoOutput(false);
-      setWarningOutput(false);  // TODO: do not always set to false
+  unsigned int tReadOutStop = getReadOutStop(0, pNdataWords);  // the words are looped read out by read out, the meta data is correlated once per read out
+  for (unsigned int iWord = 0; iWord < tReadOutStop || startNextReadOut(iWord, tReadOutStop, pNdataWords); ++iWord) {  // loop over the SRAM words
+    if (TDebugEvents) {
+      bool tDebugEvent = _nEvents >= _startDebugEvent && _nEvents <= _stopDebugEvent;
+      if (Basis::debugSet() != tDebugEvent || Basis::infoSet() || Basis::warningSet()) {  // only change the output settings if needed, the settings do not change for most of the words
+        if (tDebugEvent)
+          setDebugOutput();
+        else
+          setDebugOutput(false);
+        setInfoOutput(false);
+        setWarningOutput(false);  // TODO: do not always set to false
+      }
     }
 
     _nDataWords++;
     unsigned int tActualWord = pDataWords[iWord];  // take the actual SRAM word
     tActualTot1 = -1;  // TOT1 value stays negative if it can not be set properly in getHitsfromDataRecord()
     tActualTot2 = -1;  // TOT2 value stays negative if it can not be set properly in getHitsfromDataRecord()
-    if (getTimefromDataHeader(tActualWord, tActualLVL1ID, tActualBCID)) {  // data word is data header if true is returned
+    switch (getWordType(tActualWord)) {  // look up the word type from the word header bits and jump to the word handling
+    case __DATA_HEADER_WORD_TYPE:  // data word is data header
+      if (TFEI4B) {
+        tActualLVL1ID = DATA_HEADER_LV1ID_MACRO_FEI4B(tActualWord);
+        tActualBCID = DATA_HEADER_BCID_MACRO_FEI4B(tActualWord);
+      }
+      else {
+        tActualLVL1ID = DATA_HEADER_LV1ID_MACRO(tActualWord);
+        tActualBCID = DATA_HEADER_BCID_MACRO(tActualWord);
+      }
       _nDataHeaders++;  // increase global data header counter
       if (tNdataHeader >= _NbCID) {  // maximum event window is reached (tNdataHeader > BCIDs, mostly tNdataHeader > 15)
-        if (_alignAtTriggerNumber) {  // do not create new event
+        if (TAlignAtTriggerNumber) {  // do not create new event
           addEventStatus(__TRUNC_EVENT);
+          addDiagnosticRecord(__DIAG_TOO_MANY_DATA_HEADERS, tActualWord);
           if (Basis::warningSet())
             warning("interpretRawData: " + IntToStr(_nDataWords) + " DH WORD " + IntToStr(tActualWord) + " - " + IntToStr(tNdataHeader) + ">" + IntToStr(_NbCID - 1) + " at event " + LongIntToStr(_nEvents) + " aligning at trigger number, too many data headers (set __TRUNC_EVENT)");
         }
@@ -106,7 +171,7 @@ bool Interpret::interpretRawData(unsigned int* pDataWords, const unsigned int& p
       }
       else {
         tDbCID++;  // increase relative BCID counter [0:15]
-        if (_fEI4B) {
+        if (TFEI4B) {
           if (tStartBCID + tDbCID > __BCIDCOUNTERSIZE_FEI4B - 1)  // BCID counter overflow for FEI4B (10 bit BCID counter)
             tStartBCID = tStartBCID - __BCIDCOUNTERSIZE_FEI4B;
         }
@@ -118,10 +183,12 @@ bool Interpret::interpretRawData(unsigned int* pDataWords, const unsigned int& p
         if (tStartBCID + tDbCID != tActualBCID) {  // check if BCID is increasing by 1 in the event window, if not close actual event and create new event with actual data header
           if (tActualLVL1ID == tStartLVL1ID) {  // happens sometimes, non inc. BCID, FE feature, only abort if the LVL1ID is not constant (if no external trigger is used or)
             addEventStatus(__BCID_JUMP);
+            addDiagnosticRecord(__DIAG_BCID_JUMP, tActualWord);
             if (Basis::infoSet())
               info("interpretRawData: " + IntToStr(_nDataWords) + " DH WORD " + IntToStr(tActualWord) + " - " + IntToStr(tStartBCID + tDbCID) + "!=" + IntToStr(tActualBCID) + " at event " + LongIntToStr(_nEvents) + " BCID jumping");
-          } else if (_alignAtTriggerNumber || _alignAtTdcWord) {  // rely here on the trigger number or TDC word and do not start a new event
+          } else if (TAlignAtTriggerNumber || TAlignAtTdcWord) {  // rely here on the trigger number or TDC word and do not start a new event
             addEventStatus(__BCID_JUMP);
+            addDiagnosticRecord(__DIAG_BCID_JUMP, tActualWord);
             if (Basis::infoSet())
               info("interpretRawData: " + IntToStr(_nDataWords) + " DH WORD " + IntToStr(tActualWord) + " - " + IntToStr(tStartBCID + tDbCID) + "!=" + IntToStr(tActualBCID) + " at event " + LongIntToStr(_nEvents) + " BCID jumping");
           } else {
@@ -133,6 +200,7 @@ bool Interpret::interpretRawData(unsigned int* pDataWords, const unsigned int& p
         }
         if (!tBCIDerror && tActualLVL1ID != tStartLVL1ID) {  // LVL1ID not constant, is expected for CMOS pulse trigger/HitOR self-trigger, but not for trigger word triggering
           addEventStatus(__NON_CONST_LVL1ID);
+          addDiagnosticRecord(__DIAG_NON_CONST_LVL1ID, tActualWord);
           if (Basis::infoSet())
             info("interpretRawData: " + IntToStr(_nDataWords) + " DH WORD " + IntToStr(tActualWord) + " - " + IntToStr(tActualLVL1ID) + "!=" + IntToStr(tStartLVL1ID) + " at event " + LongIntToStr(_nEvents) + " LVL1 is not constant");
         }
@@ -140,21 +208,23 @@ bool Interpret::interpretRawData(unsigned int* pDataWords, const unsigned int& p
       tNdataHeader++;  // increase event data header counter
       if (Basis::debugSet())
         debug(std::string(" ") + IntToStr(_nDataWords) + " DH WORD " + IntToStr(tActualWord) + " - " + "LVL1ID/BCID " + IntToStr(tActualLVL1ID) + "/" + IntToStr(tActualBCID) + " at event " + LongIntToStr(_nEvents));
-    }
-    else if (isTriggerWord(tActualWord)) {  // data word is trigger word, is first word of the event data if external trigger is present
+      break;
+    case __TRIGGER_WORD_TYPE:  // data word is trigger word, is first word of the event data if external trigger is present
       _nTriggers++;  // increase global trigger word counter
-      if (_alignAtTriggerNumber) {  // use trigger number for event building, first word is trigger word in event data stream
+      if (TAlignAtTriggerNumber) {  // use trigger number for event building, first word is trigger word in event data stream
         // check for _firstTriggerNrSet, prevent building new event for the very first trigger word
         if (!_firstTriggerNrSet && tNdataHeader >= _NbCID) {  // for old data where trigger word (first raw data word) might be missing
           if (Basis::infoSet())
             info("interpretRawData: " + IntToStr(_nDataWords) + " TW WORD " + IntToStr(tActualWord) + " - " + IntToStr(tNdataHeader) + ">" + IntToStr(_NbCID) + " at event " + LongIntToStr(_nEvents) +  " missing trigger (adding new event)");
           addEventStatus(__NO_TRG_WORD);
+          addDiagnosticRecord(__DIAG_NO_TRG_WORD, tActualWord);
           addEvent();
         }
         else if (_firstTriggerNrSet && tNdataHeader < _NbCID) {  // when data headers are missing
           if (Basis::infoSet())
             info("interpretRawData: " + IntToStr(_nDataWords) + " TW WORD " + IntToStr(tActualWord) + " - " + IntToStr(tNdataHeader) + "<" + IntToStr(_NbCID) + " at event " + LongIntToStr(_nEvents) + " event incomplete (adding new event)");
           addEventStatus(__EVENT_INCOMPLETE);
+          addDiagnosticRecord(__DIAG_MISSING_DATA_HEADER, tActualWord);
           addEvent();
         }
         else if (_firstTriggerNrSet) {  // usually the case
@@ -165,16 +235,16 @@ bool Interpret::interpretRawData(unsigned int* pDataWords, const unsigned int& p
       }
 
       tTriggerWord++;  // increase event trigger word counter
-      if (_TriggerDataFormat == TRIGGER_FROMAT_TRIGGER_NUMBER) {  // trigger number
+      if (TTriggerDataFormat == TRIGGER_FROMAT_TRIGGER_NUMBER) {  // trigger number
         tTriggerNumber = TRIGGER_DATA_MACRO(tActualWord);  // 31bit trigger number
         tTriggerTimeStamp = 0;  // 31bit time stamp
       }
-      else if (_TriggerDataFormat == TRIGGER_FROMAT_TIME_STAMP) {  // time stamp
+      else if (TTriggerDataFormat == TRIGGER_FROMAT_TIME_STAMP) {  // time stamp
         // for compatibility assign to tTriggerNumber
         tTriggerNumber = 0;  // 31bit trigger number
         tTriggerTimeStamp = TRIGGER_DATA_MACRO(tActualWord);  // 31bit time stamp
       }
-      else if (_TriggerDataFormat == TRIGGER_FROMAT_COMBINED) {  // combined
+      else if (TTriggerDataFormat == TRIGGER_FROMAT_COMBINED) {  // combined
         tTriggerNumber = TRIGGER_NUMBER_COMBINED_MACRO(tActualWord);  // 16bit trigger number
         tTriggerTimeStamp = TRIGGER_TIME_STAMP_COMBINED_MACRO(tActualWord);  // 15bit time stamp
       }
@@ -182,21 +252,22 @@ bool Interpret::interpretRawData(unsigned int* pDataWords, const unsigned int& p
         throw std::out_of_range("Invalid mode for trigger data format.");
       }
       if (Basis::debugSet()) {
-        if (_TriggerDataFormat == TRIGGER_FROMAT_TRIGGER_NUMBER) {  // trigger number
+        if (TTriggerDataFormat == TRIGGER_FROMAT_TRIGGER_NUMBER) {  // trigger number
           debug(std::string(" ") + IntToStr(_nDataWords) + " TW NUMBER " + IntToStr(tTriggerNumber) + " WORD " + IntToStr(tActualWord) + " at event " + LongIntToStr(_nEvents));
         }
-        else if (_TriggerDataFormat == TRIGGER_FROMAT_TIME_STAMP) {  // time stamp
+        else if (TTriggerDataFormat == TRIGGER_FROMAT_TIME_STAMP) {  // time stamp
           debug(std::string(" ") + IntToStr(_nDataWords) + " TW TIME STAMP " + IntToStr(tTriggerTimeStamp) + " WORD " + IntToStr(tActualWord) + " at event " + LongIntToStr(_nEvents));
         }
-        else if (_TriggerDataFormat == TRIGGER_FROMAT_COMBINED) {  // combined
+        else if (TTriggerDataFormat == TRIGGER_FROMAT_COMBINED) {  // combined
           debug(std::string(" ") + IntToStr(_nDataWords) + " TW TIME STAMP " + IntToStr(tTriggerTimeStamp) + " TW NUMBER " + IntToStr(tTriggerNumber) + " WORD " + IntToStr(tActualWord) + " at event " + LongIntToStr(_nEvents));
           }
       }
       // TLU error handling
       if (!_firstTriggerNrSet) {
         _firstTriggerNrSet = true;
-      } else if ((_TriggerDataFormat != TRIGGER_FROMAT_TIME_STAMP) && (_lastTriggerNumber + 1 != tTriggerNumber) && !(_lastTriggerNumber == _maxTriggerNumber && tTriggerNumber == 0)) {
+      } else if ((TTriggerDataFormat != TRIGGER_FROMAT_TIME_STAMP) && (_lastTriggerNumber + 1 != tTriggerNumber) && !(_lastTriggerNumber == _maxTriggerNumber && tTriggerNumber == 0)) {
         addTriggerStatus(__TRG_NUMBER_INC_ERROR);
+        addDiagnosticRecord(__DIAG_TRG_NUMBER_INC_ERROR, tActualWord);
         if (Basis::warningSet())
           warning("interpretRawData: Trigger Number not increasing by 1 (old/new): " + IntToStr(_lastTriggerNumber) + "/" + IntToStr(tTriggerNumber) + " at event " + LongIntToStr(_nEvents));
       }
@@ -208,83 +279,108 @@ bool Interpret::interpretRawData(unsigned int* pDataWords, const unsigned int& p
       // store for next event in case of missing trigger word
       _lastTriggerNumber = tTriggerNumber;
       _lastTriggerTimeStamp = tTriggerTimeStamp;
-    } else if (getInfoFromServiceRecord(tActualWord, tActualSRcode, tActualSRcounter)) {  // data word is service record
+      break;
+    case __SERVICE_RECORD_WORD_TYPE:  // data word is service record
+      getInfoFromServiceRecord(tActualWord, tActualSRcode, tActualSRcounter);
       if (Basis::debugSet())
         debug(std::string(" ") + IntToStr(_nDataWords) + " SR " + IntToStr(tActualSRcode) + " (" + IntToStr(tActualSRcounter) + ") at event " + LongIntToStr(_nEvents));
       addServiceRecord(tActualSRcode, tActualSRcounter);
       addEventStatus(__HAS_SR);
       _nServiceRecords++;
-    } else if (isTdcWord(tActualWord)) {  // data word is a TDC word
+      break;
+    case __TDC_WORD_TYPE:  // data word is a TDC word
       addTdcValue(TDC_VALUE_MACRO(tActualWord));
       // TDC trigger distance
-      if (_haveTdcTriggerDistance) {
+      if (THaveTdcTriggerDistance) {
         addTdcTriggerDistanceValue(TDC_TRIG_DIST_MACRO(tActualWord));
       }
       _nTDCWords++;
-      if (_haveTdcTriggerDistance && (TDC_TRIG_DIST_MACRO(tActualWord) > _maxTdcDelay)) {  // if TDC trigger distance > _maxTdcDelay, ignore TDC word
+      if (THaveTdcTriggerDistance && (TDC_TRIG_DIST_MACRO(tActualWord) > _maxTdcDelay)) {  // if TDC trigger distance > _maxTdcDelay, ignore TDC word
         if (Basis::debugSet())
           debug(std::string(" ") + IntToStr(_nDataWords) + " TDC WORD " + IntToStr(tActualWord) + " at event " + LongIntToStr(_nEvents) + " TDC TRIGGER DISTANCE " + IntToStr(TDC_TRIG_DIST_MACRO(tActualWord)) + " MAX DELAY REJECTED");
+        if (tReadOutStop < pNdataWords)  // the word is not counted, the next read out starts one word later
+          tReadOutStop++;
         continue;
       }
 
       // create new event if the option to align at TDC words is active AND the previous event has seen already all data headers OR the previous event had no TDC word
-      if (_alignAtTdcWord && _firstTdcSet && ((tNdataHeader > _NbCID - 1) || ((tEventStatus & __TDC_WORD) != __TDC_WORD))) {
+      if (TAlignAtTdcWord && _firstTdcSet && ((tNdataHeader > _NbCID - 1) || ((tEventStatus & __TDC_WORD) != __TDC_WORD))) {
         addEvent();
       }
       _firstTdcSet = true;
       // if the event has already a valid TDC word
-      if (((tEventStatus & __TDC_WORD) == __TDC_WORD) && (tTdcValue != 0) && (_haveTdcTriggerDistance && (tTdcTriggerDistance != 255))) {
+      if (((tEventStatus & __TDC_WORD) == __TDC_WORD) && (tTdcValue != 0) && (THaveTdcTriggerDistance && (tTdcTriggerDistance != 255))) {
         // already got valid TDC word, set correponding flag if current TDC word is also valid; set proper event status code and keep values of first TDC word
-        if ((TDC_VALUE_MACRO(tActualWord) != 0) && (_haveTdcTriggerDistance && (TDC_TRIG_DIST_MACRO(tActualWord) != 255))) {
+        if ((TDC_VALUE_MACRO(tActualWord) != 0) && (THaveTdcTriggerDistance && (TDC_TRIG_DIST_MACRO(tActualWord) != 255))) {
           addEventStatus(__MORE_THAN_ONE_TDC_WORD);
         }
       } else {  // first TDC word in event or the event has already an invalid TDC word, update values
         addEventStatus(__TDC_WORD);
         tTdcValue = TDC_VALUE_MACRO(tActualWord);
-        if (_haveTdcTriggerTimeStamp && _haveTdcTriggerDistance) {
+        if (THaveTdcTriggerTimeStamp && THaveTdcTriggerDistance) {
           tTdcTimeStamp = TDC_SHORT_TIME_STAMP_MACRO(tActualWord);
           tTdcTriggerDistance = TDC_TRIG_DIST_MACRO(tActualWord);
-        } else if (_haveTdcTriggerTimeStamp && !_haveTdcTriggerDistance) {
+        } else if (THaveTdcTriggerTimeStamp && !THaveTdcTriggerDistance) {
           tTdcTimeStamp = TDC_TIME_STAMP_MACRO(tActualWord);
-        } else if (!_haveTdcTriggerTimeStamp && _haveTdcTriggerDistance) {
+        } else if (!THaveTdcTriggerTimeStamp && THaveTdcTriggerDistance) {
           tTdcTriggerDistance = TDC_TRIG_DIST_MACRO(tActualWord);
         }
         if (Basis::debugSet()) {
-          if (_haveTdcTriggerTimeStamp && _haveTdcTriggerDistance) {
+          if (THaveTdcTriggerTimeStamp && THaveTdcTriggerDistance) {
             debug(std::string(" ") + IntToStr(_nDataWords) + " TDC WORD " + IntToStr(tActualWord) + " at event " + LongIntToStr(_nEvents) + " TDC VALUE " + IntToStr(tTdcValue) + " TDC TRIGGER DISTANCE " + IntToStr(tTdcTriggerDistance) + " TDC TIME STAMP " + IntToStr(tTdcTimeStamp));
-          } else if (_haveTdcTriggerTimeStamp && !_haveTdcTriggerDistance) {
+          } else if (THaveTdcTriggerTimeStamp && !THaveTdcTriggerDistance) {
             debug(std::string(" ") + IntToStr(_nDataWords) + " TDC WORD " + IntToStr(tActualWord) + " at event " + LongIntToStr(_nEvents) + " TDC VALUE " + IntToStr(tTdcValue) + " TDC TIME STAMP " + IntToStr(TDC_TIME_STAMP_MACRO(tActualWord)));
-          } else if (!_haveTdcTriggerTimeStamp && _haveTdcTriggerDistance) {
+          } else if (!THaveTdcTriggerTimeStamp && THaveTdcTriggerDistance) {
             debug(std::string(" ") + IntToStr(_nDataWords) + " TDC WORD " + IntToStr(tActualWord) + " at event " + LongIntToStr(_nEvents) + " TDC VALUE " + IntToStr(tTdcValue) + " TDC TRIGGER DISTANCE " + IntToStr(tTdcTriggerDistance) + " TDC WORD COUNTER " + IntToStr(TDC_SHORT_TIME_STAMP_MACRO(tActualWord)));
           } else {
             debug(std::string(" ") + IntToStr(_nDataWords) + " TDC WORD " + IntToStr(tActualWord) + " at event " + LongIntToStr(_nEvents) + " TDC VALUE " + IntToStr(tTdcValue) + " TDC WORD COUNTER " + IntToStr(TDC_TIME_STAMP_MACRO(tActualWord)));
           }
         }
       }
-    } else if (isDataRecord(tActualWord)) {  // data word is data record if true is returned
+      break;
+    case __DATA_RECORD_WORD_TYPE:  // data word is data record
+      if (!Basis::debugSet()) {  // interpret the following data records at once, no debug output needed for every data record
+        unsigned int tNdataRecords = getDataRecordRunLength(pDataWords + iWord, tReadOutStop - iWord);  // the data records of one read out
+        if (tNdataRecords > 1 && reserveHitBuffer(tHitBufferIndex + 2 * tNdataRecords)) {
+          addDataRecordHits(pDataWords + iWord, tNdataRecords);
+          tNdataRecord += tNdataRecords;  // increase data record counter for this event
+          _nDataRecords += tNdataRecords;  // increase total data record counter
+          _dataWordIndex += tNdataRecords - 1;  // word index book keeping for all but the last data record, the last one is handled below
+          tNdataWords += tNdataRecords - 1;
+          _nDataWords += tNdataRecords - 1;
+          iWord += tNdataRecords - 1;
+          break;
+        }
+      }
       if (getHitsfromDataRecord(tActualWord, tActualCol1, tActualRow1, tActualTot1, tActualCol2, tActualRow2, tActualTot2)) {
         tNdataRecord++;  // increase data record counter for this event
         _nDataRecords++;  // increase total data record counter
         if (tActualTot1 >= 0)               // add hit if hit info is reasonable (TOT1 >= 0)
-          if (!(addHit(tDbCID, tActualLVL1ID, tActualCol1, tActualRow1, tActualTot1, tActualBCID)))
+          if (!(addHit(tDbCID, tActualLVL1ID, tActualCol1, tActualRow1, tActualTot1, tActualBCID))) {
+            addDiagnosticRecord(__DIAG_HIT_BUFFER_FULL, tActualWord);
             if (Basis::warningSet())
               warning("interpretRawData: " + IntToStr(_nDataWords) + " DR " + IntToStr(tActualWord) + " at event " + LongIntToStr(_nEvents) + " too many data records");
+          }
         if (tActualTot2 >= 0)               // add hit if hit info is reasonable and set (TOT2 >= 0)
-          if (!(addHit(tDbCID, tActualLVL1ID, tActualCol2, tActualRow2, tActualTot2, tActualBCID)))
+          if (!(addHit(tDbCID, tActualLVL1ID, tActualCol2, tActualRow2, tActualTot2, tActualBCID))) {
+            addDiagnosticRecord(__DIAG_HIT_BUFFER_FULL, tActualWord);
             if (Basis::warningSet())
               warning("interpretRawData: " + IntToStr(_nDataWords) + " DR " + IntToStr(tActualWord) + " at event " + LongIntToStr(_nEvents) + " too many data records");
+          }
         if (Basis::debugSet()) {
           std::stringstream tDebug;
           tDebug << " " << _nDataWords << " DR COL1/ROW1/TOT1  COL2/ROW2/TOT2 " << tActualCol1 << "/" << tActualRow1 << "/" << tActualTot1 << "  " << tActualCol2 << "/" << tActualRow2 << "/" << tActualTot2 << " rBCID " << tDbCID << " at event " << _nEvents;
           debug(tDebug.str());
         }
       } else {
+        addDiagnosticRecord(__DIAG_DATA_RECORD_OUT_OF_BOUNDS, tActualWord);
         if (Basis::warningSet())
           warning("interpretRawData: " + IntToStr(_nDataWords) + " UNKNOWN WORD " + IntToStr(tActualWord) + " at event " + LongIntToStr(_nEvents));
         if (Basis::debugSet())
           debug(std::string(" ") + IntToStr(_nDataWords) + " UNKNOWN WORD " + IntToStr(tActualWord) + " at event " + LongIntToStr(_nEvents));
       }
-    } else if (isAddressRecord(tActualWord)) {  // data word is address record if true is returned
+      break;
+    case __ADDRESS_RECORD_WORD_TYPE:  // data word is address record
       _nAddressRecords++;
       if (Basis::debugSet()) {
         unsigned int tAddress = 0;
@@ -296,7 +392,8 @@ bool Interpret::interpretRawData(unsigned int* pDataWords, const unsigned int& p
             debug(std::string(" ") + IntToStr(_nDataWords) + " ADDRESS RECORD GLOBAL REG. " + IntToStr(tAddress) + " WORD " + IntToStr(tActualWord) + " at event " + LongIntToStr(_nEvents));
         }
       }
-    } else if (isValueRecord(tActualWord)) {  // data word is value record if true is returned
+      break;
+    case __VALUE_RECORD_WORD_TYPE:  // data word is value record
       _nValueRecords++;
       if (Basis::debugSet()) {
         unsigned int tValue = 0;
@@ -304,23 +401,25 @@ bool Interpret::interpretRawData(unsigned int* pDataWords, const unsigned int& p
           debug(std::string(" ") + IntToStr(_nDataWords) + " VALUE RECORD " + IntToStr(tValue) + " at event " + LongIntToStr(_nEvents));
         }
       }
-    } else {
-      if (isOtherWord(tActualWord)) {  // other data words
-        addEventStatus(__OTHER_WORD);
-        _nOtherWords++;
-        if (Basis::debugSet()) {
-          debug(std::string(" ") + IntToStr(_nDataWords) + " OTHER WORD " + IntToStr(tActualWord) + " at event " + LongIntToStr(_nEvents));
-        }
-      } else {  // remaining data words, unknown words
-        addEventStatus(__UNKNOWN_WORD);
-        _nUnknownWords++;
-        if (Basis::warningSet())
-          warning("interpretRawData: " + IntToStr(_nDataWords) + " UNKNOWN WORD " + IntToStr(tActualWord) + " at event " + LongIntToStr(_nEvents));
-        if (Basis::debugSet())
-          debug(std::string(" ") + IntToStr(_nDataWords) + " UNKNOWN WORD " + IntToStr(tActualWord) + " at event " + LongIntToStr(_nEvents));
+      break;
+    case __OTHER_WORD_TYPE:  // other data words
+      addEventStatus(__OTHER_WORD);
+      _nOtherWords++;
+      if (Basis::debugSet()) {
+        debug(std::string(" ") + IntToStr(_nDataWords) + " OTHER WORD " + IntToStr(tActualWord) + " at event " + LongIntToStr(_nEvents));
       }
+      break;
+    default:  // remaining data words, unknown words
+      addEventStatus(__UNKNOWN_WORD);
+      addDiagnosticRecord(__DIAG_UNKNOWN_WORD, tActualWord);
+      _nUnknownWords++;
+      if (Basis::warningSet())
+        warning("interpretRawData: " + IntToStr(_nDataWords) + " UNKNOWN WORD " + IntToStr(tActualWord) + " at event " + LongIntToStr(_nEvents));
+      if (Basis::debugSet())
+        debug(std::string(" ") + IntToStr(_nDataWords) + " UNKNOWN WORD " + IntToStr(tActualWord) + " at event " + LongIntToStr(_nEvents));
     }
     if (tBCIDerror) {  // tBCIDerror is raised if BCID is not increasing by 1, most likely due to incomplete data transmission, so start new event, actual word is data header here
+      addDiagnosticRecord(__DIAG_BCID_ERROR, tActualWord);
       if (Basis::warningSet())
         warning("interpretRawData " + IntToStr(_nDataWords) + " BCID ERROR at event " + LongIntToStr(_nEvents));
       addEvent();
@@ -330,9 +429,573 @@ bool Interpret::interpretRawData(unsigned int* pDataWords, const unsigned int& p
       tStartBCID = tActualBCID;
       tStartLVL1ID = tActualLVL1ID;
     }
-    correlateMetaWordIndex(_nEvents, _dataWordIndex);
     _dataWordIndex++;
     tNdataWords++;
+    if (_outputFull) {  // the caller owned output arrays are full, the following words are interpreted with the next call
+      correlateMetaWordIndex(_nEvents, _dataWordIndex - 1);
+      _nInterpretedWords = iWord + 1;
+      return;
+    }
+  }
+  _nInterpretedWords = pNdataWords;
+}
+
+void Interpret::histogramOccupancy(unsigned int* pDataWords, const unsigned int& pNdataWords)
+{
+  if (Basis::debugSet())
+    debug("histogramOccupancy(...,"+IntToStr(pNdataWords)+")");
+  if (_histogram == 0)
+    throw std::runtime_error("Histogram not set.");
+  unsigned int tHistogramMaxTot = _histogram->getMaxTot();
+  Histogram::FillGuard tFillGuard(*_histogram);  // histogram snapshots are taken between read outs
+  unsigned int* tOccupancy = 0;  // occupancy histogram of the scan parameter of the actual read out
+  uint64_t* tTotSum = 0;  // ToT sums of the scan parameter of the actual read out, 0 if the mean ToT is not histogrammed
+  uint64_t* tTotSquareSum = 0;
+  unsigned int tNhits = 0;
+  for (unsigned int iWord = 0; iWord < pNdataWords; ++iWord) {
+    if (tOccupancy == 0 || (_metaDataSet && _dataWordIndex == _lastWordIndexSet)) {  // the word starts the next read out
+      _histogram->serveSnapshot();
+      advanceMetaWordIndex(_dataWordIndex, _dataWordIndex + 1);
+      tOccupancy = _histogram->getReadOutOccupancy(_lastMetaIndexNotSet > 0 ? _lastMetaIndexNotSet - 1 : 0);
+      _histogram->getReadOutTotSums(_lastMetaIndexNotSet > 0 ? _lastMetaIndexNotSet - 1 : 0, tTotSum, tTotSquareSum);
+    }
+    _nDataWords++;
+    unsigned int tActualWord = pDataWords[iWord];
+    switch (getWordType(tActualWord)) {
+    case __DATA_RECORD_WORD_TYPE: {
+      unsigned int tNwords = pNdataWords - iWord;
+      if (_metaDataSet && _lastWordIndexSet > _dataWordIndex && _lastWordIndexSet - _dataWordIndex < tNwords)
+        tNwords = _lastWordIndexSet - _dataWordIndex;  // the data records of one read out
+      unsigned int tNdataRecords = getDataRecordRunLength(pDataWords + iWord, tNwords);
+      if (tNdataRecords == 0) {
+        addDiagnosticRecord(__DIAG_DATA_RECORD_OUT_OF_BOUNDS, tActualWord);
+        break;
+      }
+      for (unsigned int i = iWord; i < iWord + tNdataRecords; ++i) {  // same hit selection as addDataRecordHits
+        unsigned int tWord = pDataWords[i];
+        size_t tIndex = (size_t)(DATA_RECORD_COLUMN1_MACRO(tWord) - 1) + (size_t)(DATA_RECORD_ROW1_MACRO(tWord) - 1) * (size_t)RAW_DATA_MAX_COLUMN;
+        if (DATA_RECORD_TOT1_MACRO(tWord) <= _maxTot) {
+          tNhits++;
+          if (DATA_RECORD_TOT1_MACRO(tWord) <= tHistogramMaxTot) {
+            tOccupancy[tIndex] += 1;
+            if (tTotSum != 0) {
+              tTotSum[tIndex] += DATA_RECORD_TOT1_MACRO(tWord);
+              tTotSquareSum[tIndex] += DATA_RECORD_TOT1_MACRO(tWord) * DATA_RECORD_TOT1_MACRO(tWord);
+            }
+          }
+        }
+        if (DATA_RECORD_TOT2_MACRO(tWord) <= _maxTot) {  // the second hit is in the next row
+          tNhits++;
+          if (DATA_RECORD_TOT2_MACRO(tWord) <= tHistogramMaxTot && DATA_RECORD_ROW1_MACRO(tWord) < RAW_DATA_MAX_ROW) {  // with maximum ToT 15 the second hit of a data record in the last row is in row 337, it is not histogrammed
+            tOccupancy[tIndex + RAW_DATA_MAX_COLUMN] += 1;
+            if (tTotSum != 0) {
+              tTotSum[tIndex + RAW_DATA_MAX_COLUMN] += DATA_RECORD_TOT2_MACRO(tWord);
+              tTotSquareSum[tIndex + RAW_DATA_MAX_COLUMN] += DATA_RECORD_TOT2_MACRO(tWord) * DATA_RECORD_TOT2_MACRO(tWord);
+            }
+          }
+        }
+        if (DATA_RECORD_TOT1_MACRO(tWord) == 14)
+          _nSmallHits++;
+        if (DATA_RECORD_TOT2_MACRO(tWord) == 14)
+          _nSmallHits++;
+      }
+      _nDataRecords += tNdataRecords;
+      _dataWordIndex += tNdataRecords - 1;  // word index book keeping for all but the last data record, the last one is handled below
+      _nDataWords += tNdataRecords - 1;
+      iWord += tNdataRecords - 1;
+      break;
+    }
+    case __DATA_HEADER_WORD_TYPE:
+      _nDataHeaders++;
+      break;
+    case __TRIGGER_WORD_TYPE:
+      _nTriggers++;
+      break;
+    case __SERVICE_RECORD_WORD_TYPE:
+      getInfoFromServiceRecord(tActualWord, tActualSRcode, tActualSRcounter);
+      if (tActualSRcode < __NSERVICERECORDS)
+        _serviceRecordCounter[tActualSRcode] += tActualSRcounter;
+      _nServiceRecords++;
+      break;
+    case __TDC_WORD_TYPE:
+      addTdcValue(TDC_VALUE_MACRO(tActualWord));
+      if (_haveTdcTriggerDistance)
+        addTdcTriggerDistanceValue(TDC_TRIG_DIST_MACRO(tActualWord));
+      _nTDCWords++;
+      if (_haveTdcTriggerDistance && (TDC_TRIG_DIST_MACRO(tActualWord) > _maxTdcDelay))  // ignored TDC words are not counted as in interpretRawData
+        continue;
+      break;
+    case __ADDRESS_RECORD_WORD_TYPE:
+      _nAddressRecords++;
+      break;
+    case __VALUE_RECORD_WORD_TYPE:
+      _nValueRecords++;
+      break;
+    case __OTHER_WORD_TYPE:
+      _nOtherWords++;
+      break;
+    default:
+      addDiagnosticRecord(__DIAG_UNKNOWN_WORD, tActualWord);
+      _nUnknownWords++;
+    }
+    _dataWordIndex++;
+  }
+  _nHits += tNhits;
+  _nInterpretedWords = pNdataWords;
+}
+
+void Interpret::selectInterpretRawDataKernel()
+{
+  if (_fEI4B)
+    selectInterpretRawDataKernel<true>();
+  else
+    selectInterpretRawDataKernel<false>();
+}
+
+template <bool TFEI4B>
+void Interpret::selectInterpretRawDataKernel()
+{
+  if (_alignAtTriggerNumber)
+    selectInterpretRawDataKernel<TFEI4B, true>();
+  else
+    selectInterpretRawDataKernel<TFEI4B, false>();
+}
+
+template <bool TFEI4B, bool TAlignAtTriggerNumber>
+void Interpret::selectInterpretRawDataKernel()
+{
+  if (_alignAtTdcWord)
+    selectInterpretRawDataKernel<TFEI4B, TAlignAtTriggerNumber, true>();
+  else
+    selectInterpretRawDataKernel<TFEI4B, TAlignAtTriggerNumber, false>();
+}
+
+template <bool TFEI4B, bool TAlignAtTriggerNumber, bool TAlignAtTdcWord>
+void Interpret::selectInterpretRawDataKernel()
+{
+  switch (_TriggerDataFormat) {
+  case TRIGGER_FROMAT_TRIGGER_NUMBER:
+    selectInterpretRawDataKernel<TFEI4B, TAlignAtTriggerNumber, TAlignAtTdcWord, TRIGGER_FROMAT_TRIGGER_NUMBER>();
+    break;
+  case TRIGGER_FROMAT_TIME_STAMP:
+    selectInterpretRawDataKernel<TFEI4B, TAlignAtTriggerNumber, TAlignAtTdcWord, TRIGGER_FROMAT_TIME_STAMP>();
+    break;
+  case TRIGGER_FROMAT_COMBINED:
+    selectInterpretRawDataKernel<TFEI4B, TAlignAtTriggerNumber, TAlignAtTdcWord, TRIGGER_FROMAT_COMBINED>();
+    break;
+  default:  // the kernel throws if a trigger word has to be interpreted
+    selectInterpretRawDataKernel<TFEI4B, TAlignAtTriggerNumber, TAlignAtTdcWord, TRIGGER_FROMAT_INVALID>();
+  }
+}
+
+template <bool TFEI4B, bool TAlignAtTriggerNumber, bool TAlignAtTdcWord, unsigned int TTriggerDataFormat>
+void Interpret::selectInterpretRawDataKernel()
+{
+  if (_haveTdcTriggerTimeStamp)
+    selectInterpretRawDataKernel<TFEI4B, TAlignAtTriggerNumber, TAlignAtTdcWord, TTriggerDataFormat, true>();
+  else
+    selectInterpretRawDataKernel<TFEI4B, TAlignAtTriggerNumber, TAlignAtTdcWord, TTriggerDataFormat, false>();
+}
+
+template <bool TFEI4B, bool TAlignAtTriggerNumber, bool TAlignAtTdcWord, unsigned int TTriggerDataFormat, bool THaveTdcTriggerTimeStamp>
+void Interpret::selectInterpretRawDataKernel()
+{
+  if (_haveTdcTriggerDistance)
+    selectInterpretRawDataKernel<TFEI4B, TAlignAtTriggerNumber, TAlignAtTdcWord, TTriggerDataFormat, THaveTdcTriggerTimeStamp, true>();
+  else
+    selectInterpretRawDataKernel<TFEI4B, TAlignAtTriggerNumber, TAlignAtTdcWord, TTriggerDataFormat, THaveTdcTriggerTimeStamp, false>();
+}
+
+template <bool TFEI4B, bool TAlignAtTriggerNumber, bool TAlignAtTdcWord, unsigned int TTriggerDataFormat, bool THaveTdcTriggerTimeStamp, bool THaveTdcTriggerDistance>
+void Interpret::selectInterpretRawDataKernel()
+{
+  if (_debugEvents)
+    _interpretRawDataKernel = &Interpret::interpretRawDataKernel<TFEI4B, TAlignAtTriggerNumber, TAlignAtTdcWord, TTriggerDataFormat, THaveTdcTriggerTimeStamp, THaveTdcTriggerDistance, true>;
+  else
+    _interpretRawDataKernel = &Interpret::interpretRawDataKernel<TFEI4B, TAlignAtTriggerNumber, TAlignAtTdcWord, TTriggerDataFormat, THaveTdcTriggerTimeStamp, THaveTdcTriggerDistance, false>;
+}
+
+void Interpret::interpretRawDataParallel(unsigned int* pDataWords, const unsigned int& pNdataWords, const unsigned int& rNchunks)
+{
+  std::vector<unsigned int> tChunkStarts(1, 0);
+  std::vector<unsigned int> tWarmUpStarts(1, 0);
+  for (unsigned int i = 1; i < rNchunks; ++i) {
+    unsigned int tChunkStart = getParallelChunkStart(pDataWords, pNdataWords, (unsigned int) ((uint64_t) pNdataWords * i / rNchunks));
+    unsigned int tWarmUpStart = 0;
+    if (tChunkStart <= tChunkStarts.back() || tChunkStart >= pNdataWords)
+      continue;
+    if (!getParallelWarmUpStart(pDataWords, tChunkStart, tWarmUpStart)) {  // the chunk would be interpreted again
+      if (Basis::infoSet())
+        info("interpretRawDataParallel: no event start in front of word " + IntToStr(tChunkStart) + ", chunks are merged");
+      continue;
+    }
+    tChunkStarts.push_back(tChunkStart);
+    tWarmUpStarts.push_back(tWarmUpStart);
+  }
+  if (tChunkStarts.size() == 1) {
+    (this->*_interpretRawDataKernel)(pDataWords, pNdataWords);
+    return;
+  }
+  while (_chunkInterpreters.size() < tChunkStarts.size() - 1)
+    _chunkInterpreters.push_back(new Interpret());
+
+  std::vector<ParallelChunk> tChunks(tChunkStarts.size());
+  for (unsigned int i = 0; i < tChunks.size(); ++i) {
+    ParallelChunk& rChunk = tChunks[i];
+    rChunk.interpreter = i == 0 ? this : _chunkInterpreters[i - 1];
+    rChunk.dataWords = pDataWords;
+    rChunk.nDataWords = _nDataWords;
+    rChunk.dataWordIndex = _dataWordIndex;
+    rChunk.lastMetaIndexNotSet = _lastMetaIndexNotSet;
+    rChunk.lastWordIndexSet = _lastWordIndexSet;
+    rChunk.startWordIndex = _startWordIndex;
+    rChunk.start = tChunkStarts[i];
+    rChunk.stop = i + 1 < tChunks.size() ? tChunkStarts[i + 1] : pNdataWords;
+    rChunk.warmUpStart = tWarmUpStarts[i];
+    rChunk.metaIndexStart = 0;
+    rChunk.outOfRange = false;
+    if (i > 0) {
+      rChunk.interpreter->copySettings(*this, rChunk.stop - rChunk.warmUpStart);
+      if (_createMetaDataWordIndex)
+        rChunk.metaWordIndex.resize(_metaWordIndexLength);
+    }
+  }
+  if (Basis::infoSet())
+    info("interpretRawDataParallel: " + IntToStr(pNdataWords) + " words in " + IntToStr((unsigned int) tChunks.size()) + " chunks");
+
+  runParallel(&Interpret::interpretParallelChunk, tChunks);  // the first chunk is interpreted by this interpreter in the calling thread
+
+  if (!tChunks[0].error.empty()) {
+    if (tChunks[0].outOfRange)
+      throw std::out_of_range(tChunks[0].error);
+    throw std::runtime_error(tChunks[0].error);
+  }
+  for (unsigned int i = 1; i < tChunks.size(); ++i) {  // add the chunk results in order, if the event state at the chunk start was not found correctly or the results do not fit interpret the chunk again
+    InterpretState tState;
+    saveState(tState);
+    if (tChunks[i].error.empty() && isSameState(tState, tChunks[i].startState) && addChunkResults(*tChunks[i].interpreter, tChunks[i]))
+      continue;
+    _nParallelReruns++;
+    if (Basis::infoSet())
+      info("interpretRawDataParallel: chunk " + IntToStr(i) + " is interpreted again");
+    (this->*_interpretRawDataKernel)(pDataWords + tChunks[i].start, tChunks[i].stop - tChunks[i].start);  // raises the errors at the same word as the serial interpretation
+  }
+  _nInterpretedWords = pNdataWords;
+}
+
+unsigned int Interpret::getParallelChunkStart(unsigned int* pDataWords, const unsigned int& pNdataWords, const unsigned int& rIndex)
+{
+  unsigned int tIndex = rIndex;
+  if (_metaDataSet) {  // start of the next read out
+    for (unsigned int i = _lastMetaIndexNotSet; i < _metaEventIndexLength; ++i) {
+      unsigned int tStartIndex = _isMetaTableV2 ? _metaInfoV2[i].startIndex : _metaInfo[i].startIndex;
+      if (tStartIndex >= _dataWordIndex + rIndex) {
+        if (tStartIndex < _dataWordIndex + pNdataWords)
+          tIndex = tStartIndex - _dataWordIndex;
+        break;
+      }
+    }
+  }
+  for (unsigned int i = tIndex; i < pNdataWords && i < tIndex + __PARALLEL_WARM_UP_WORDS; ++i) {  // events start with the trigger word
+    if (isTriggerWord(pDataWords[i]))
+      return i;
+  }
+  return tIndex;
+}
+
+bool Interpret::getParallelWarmUpStart(unsigned int* pDataWords, const unsigned int& rChunkStart, unsigned int& rWarmUpStart)
+{
+  // the event building depends on the data header counter of the pending event, the counter is only known at the trigger word of an event;
+  // the trigger number check needs the trigger word of the event before, thus a second trigger word has to be in front of the chunk start
+  unsigned int tFirstWord = rChunkStart > __PARALLEL_WARM_UP_WORDS ? rChunkStart - (unsigned int) __PARALLEL_WARM_UP_WORDS : 0;
+  for (unsigned int i = tFirstWord; i < rChunkStart; ++i) {
+    if (isTriggerWord(pDataWords[i])) {
+      for (unsigned int j = i + 1; j < rChunkStart; ++j) {
+        if (isTriggerWord(pDataWords[j])) {
+          rWarmUpStart = i;
+          return true;
+        }
+      }
+      break;
+    }
+  }
+  if (_NbCID == 1 && !_alignAtTriggerNumber && !_alignAtTdcWord) {  // every data header starts a new event
+    rWarmUpStart = tFirstWord;
+    return true;
+  }
+  return false;
+}
+
+void Interpret::interpretParallelChunk(ParallelChunk& rChunk)
+{
+  try {
+    if (rChunk.start == 0)  // the first chunk continues the interpretation of the main interpreter
+      (rChunk.interpreter->*rChunk.interpreter->_interpretRawDataKernel)(rChunk.dataWords, rChunk.stop);
+    else
+      rChunk.interpreter->interpretChunk(rChunk);
+  } catch (std::out_of_range& exception) {
+    rChunk.error = exception.what();
+    rChunk.outOfRange = true;
+  } catch (std::exception& exception) {
+    rChunk.error = exception.what();
+  }
+}
+
+void Interpret::interpretChunk(ParallelChunk& rChunk)
+{
+  // find the event state at the chunk start by interpreting the words in front of the chunk
+  resetCounters();
+  resetEventVariables();
+  tActualLVL1ID = 0;
+  tActualBCID = 0;
+  _nDataWords = rChunk.nDataWords + rChunk.warmUpStart;
+  _dataWordIndex = rChunk.dataWordIndex + rChunk.warmUpStart;
+  _startWordIndex = rChunk.startWordIndex;
+  _hitIndex = 0;
+  _eventIndex = 0;
+  _actualMetaWordIndex = 0;
+  _metaWordIndex = rChunk.metaWordIndex.empty() ? 0 : &rChunk.metaWordIndex[0];
+  _metaWordIndexLength = (unsigned int) rChunk.metaWordIndex.size();
+  bool tMetaDataSet = _metaDataSet;
+  _metaDataSet = false;  // the event numbers of the read outs in front of the chunk are set by the other chunks
+  (this->*_interpretRawDataKernel)(rChunk.dataWords + rChunk.warmUpStart, rChunk.start - rChunk.warmUpStart);
+  _metaDataSet = tMetaDataSet;
+  saveState(rChunk.startState);
+
+  // interpret the chunk with event numbers starting at 0, they are shifted when the results are added
+  resetCounters();
+  resetDiagnosticRecords();
+  loadState(rChunk.startState);
+  _nDataWords = rChunk.nDataWords + rChunk.start;
+  _dataWordIndex = rChunk.dataWordIndex + rChunk.start;
+  _lastMetaIndexNotSet = rChunk.lastMetaIndexNotSet;
+  _lastWordIndexSet = rChunk.lastWordIndexSet;
+  advanceMetaWordIndex(rChunk.dataWordIndex, _dataWordIndex);
+  rChunk.metaIndexStart = _lastMetaIndexNotSet;
+  _hitIndex = 0;
+  _eventIndex = 0;
+  _actualMetaWordIndex = 0;
+  (this->*_interpretRawDataKernel)(rChunk.dataWords + rChunk.start, rChunk.stop - rChunk.start);
+  saveState(rChunk.stopState);
+}
+
+void Interpret::copySettings(const Interpret& rInterpret, const unsigned int& rNdataWords)
+{
+  setErrorOutput(false);  // chunk interpreters are silent, the conditions can be kept as diagnostic records
+  setWarningOutput(false);
+  setInfoOutput(false);
+  setDebugOutput(false);
+  _NbCID = rInterpret._NbCID;
+  _maxTot = rInterpret._maxTot;
+  _maxTdcDelay = rInterpret._maxTdcDelay;
+  _fEI4B = rInterpret._fEI4B;
+  _alignAtTriggerNumber = rInterpret._alignAtTriggerNumber;
+  _alignAtTdcWord = rInterpret._alignAtTdcWord;
+  _haveTdcTriggerTimeStamp = rInterpret._haveTdcTriggerTimeStamp;
+  _haveTdcTriggerDistance = rInterpret._haveTdcTriggerDistance;
+  _TriggerDataFormat = rInterpret._TriggerDataFormat;
+  _maxTriggerNumber = rInterpret._maxTriggerNumber;
+  _maxHitBufferSize = rInterpret._maxHitBufferSize;
+  _createEmptyEventHits = rInterpret._createEmptyEventHits;
+  _createMetaDataWordIndex = rInterpret._createMetaDataWordIndex;
+  // the chunk arrays only have to hold the output of the chunk words: a word gives at most two hits or closes one event (with at most one empty event hit);
+  // they are only reallocated if they are too small or larger than the arrays of the main interpreter
+  unsigned int tHitInfoSize = (unsigned int) std::min((uint64_t) rInterpret._hitInfoSize, 2 * (uint64_t) rNdataWords);
+  unsigned int tEventInfoSize = std::min(rInterpret._eventInfoSize, rNdataWords);
+  if (_createEventTable != rInterpret._createEventTable || _hitInfoSize < tHitInfoSize || _hitInfoSize > rInterpret._hitInfoSize || (_createEventTable && (_eventInfoSize < tEventInfoSize || _eventInfoSize > rInterpret._eventInfoSize))) {
+    deleteHitArray();
+    deleteEventTableArrays();
+    _createEventTable = rInterpret._createEventTable;
+    _hitInfoSize = tHitInfoSize;
+    _eventInfoSize = tEventInfoSize;
+  }
+  if (_createEventTable) {
+    if (_eventInfo == 0 || _slimHitInfo == 0)
+      allocateEventTableArrays();
+  } else if (_hitInfo == 0)
+    allocateHitArray();
+  _metaDataSet = rInterpret._metaDataSet;
+  _isMetaTableV2 = rInterpret._isMetaTableV2;
+  _metaInfo = rInterpret._metaInfo;
+  _metaInfoV2 = rInterpret._metaInfoV2;
+  _metaEventIndex = rInterpret._metaEventIndex;  // every chunk sets the meta event index of its read outs
+  _metaEventIndexLength = rInterpret._metaEventIndexLength;
+  if (_diagnosticRecordsSize != rInterpret._diagnosticRecordsSize)
+    setDiagnosticRecordsSize(rInterpret._diagnosticRecordsSize);
+  selectInterpretRawDataKernel();
+}
+
+bool Interpret::addChunkResults(Interpret& rInterpret, const ParallelChunk& rChunk)
+{
+  uint64_t tEventOffset = _nEvents;
+  if (_createEventTable && _eventIndex + rInterpret._eventIndex > _eventInfoSize)  // nothing is added, the chunk is interpreted again and fails where the serial interpretation fails
+    return false;
+  if (_hitIndex + rInterpret._hitIndex > _hitInfoSize)
+    return false;
+  if (_createMetaDataWordIndex && _actualMetaWordIndex + rInterpret._actualMetaWordIndex > _metaWordIndexLength)
+    return false;
+  if (_createEventTable) {
+    for (unsigned int i = 0; i < rInterpret._eventIndex; ++i, ++_eventIndex) {
+      _eventInfo[_eventIndex] = rInterpret._eventInfo[i];
+      _eventInfo[_eventIndex].event_number += tEventOffset;
+      _eventInfo[_eventIndex].hit_index += _nSlimHits;
+    }
+    for (unsigned int i = 0; i < rInterpret._hitIndex; ++i, ++_hitIndex) {
+      _slimHitInfo[_hitIndex] = rInterpret._slimHitInfo[i];
+      _slimHitInfo[_hitIndex].event_number += tEventOffset;
+    }
+  } else {
+    for (unsigned int i = 0; i < rInterpret._hitIndex; ++i, ++_hitIndex) {
+      _hitInfo[_hitIndex] = rInterpret._hitInfo[i];
+      _hitInfo[_hitIndex].event_number += tEventOffset;
+    }
+  }
+  if (_metaDataSet) {  // the chunk interpreter sets the meta event index of its read outs relative to the chunk start
+    for (unsigned int i = rChunk.metaIndexStart; i < rInterpret._lastMetaIndexNotSet && i < _metaEventIndexLength; ++i)
+      _metaEventIndex[i] += tEventOffset;
+  }
+  if (_createMetaDataWordIndex) {
+    for (unsigned int i = 0; i < rInterpret._actualMetaWordIndex; ++i, ++_actualMetaWordIndex) {
+      _metaWordIndex[_actualMetaWordIndex] = rInterpret._metaWordIndex[i];
+      _metaWordIndex[_actualMetaWordIndex].eventIndex += tEventOffset;
+    }
+  }
+  if (_diagnosticRecordsSize > 0) {
+    DiagnosticRecord* tDiagnosticRecords = 0;
+    unsigned int tNdiagnosticRecords = 0;
+    rInterpret.getDiagnosticRecords(tDiagnosticRecords, tNdiagnosticRecords);
+    for (unsigned int i = 0; i < tNdiagnosticRecords; ++i) {
+      _diagnosticRecords[_diagnosticRecordIndex] = tDiagnosticRecords[i];
+      _diagnosticRecords[_diagnosticRecordIndex].event_number += tEventOffset;
+      _diagnosticRecordIndex++;
+      if (_diagnosticRecordIndex == _diagnosticRecordsSize)
+        _diagnosticRecordIndex = 0;
+    }
+    _nDiagnosticRecords += rInterpret._nDiagnosticRecords;
+  }
+
+  // counters and histograms
+  _nEvents += rInterpret._nEvents;
+  _nHits += rInterpret._nHits;
+  _nSlimHits += rInterpret._nSlimHits;
+  _nTriggers += rInterpret._nTriggers;
+  _nEmptyEvents += rInterpret._nEmptyEvents;
+  _nIncompleteEvents += rInterpret._nIncompleteEvents;
+  _nDataHeaders += rInterpret._nDataHeaders;
+  _nDataRecords += rInterpret._nDataRecords;
+  _nAddressRecords += rInterpret._nAddressRecords;
+  _nValueRecords += rInterpret._nValueRecords;
+  _nServiceRecords += rInterpret._nServiceRecords;
+  _nTDCWords += rInterpret._nTDCWords;
+  _nOtherWords += rInterpret._nOtherWords;
+  _nUnknownWords += rInterpret._nUnknownWords;
+  _nSmallHits += rInterpret._nSmallHits;
+  _nMaxHitsPerEvent = std::max(_nMaxHitsPerEvent, rInterpret._nMaxHitsPerEvent);
+  for (unsigned int i = 0; i < __N_TRIGGER_STATUS_BITS; ++i)
+    _triggerStatusCounter[i] += rInterpret._triggerStatusCounter[i];
+  for (unsigned int i = 0; i < __N_EVENT_STATUS_BITS; ++i)
+    _eventStatusCounter[i] += rInterpret._eventStatusCounter[i];
+  for (unsigned int i = 0; i < __N_TDC_VALUES; ++i)
+    _tdcValue[i] += rInterpret._tdcValue[i];
+  for (unsigned int i = 0; i < __N_TDC_TRG_DIST_VALUES; ++i)
+    _tdcTriggerDistance[i] += rInterpret._tdcTriggerDistance[i];
+  for (unsigned int i = 0; i < __NSERVICERECORDS; ++i)
+    _serviceRecordCounter[i] += rInterpret._serviceRecordCounter[i];
+
+  // continue with the state at the chunk stop
+  _nDataWords = rInterpret._nDataWords;
+  _dataWordIndex = rInterpret._dataWordIndex;
+  _lastMetaIndexNotSet = rInterpret._lastMetaIndexNotSet;
+  _lastWordIndexSet = rInterpret._lastWordIndexSet;
+  loadState(rChunk.stopState);
+  return true;
+}
+
+void Interpret::saveState(InterpretState& rState)
+{
+  rState.nDataWords = tNdataWords;
+  rState.nDataHeader = tNdataHeader;
+  rState.nDataRecord = tNdataRecord;
+  rState.startBCID = tStartBCID;
+  rState.startLVL1ID = tStartLVL1ID;
+  rState.dbCID = tDbCID;
+  rState.triggerStatus = tTriggerStatus;
+  rState.eventStatus = tEventStatus;
+  rState.serviceRecord = tServiceRecord;
+  rState.eventTriggerNumber = tEventTriggerNumber;
+  rState.eventTriggerTimeStamp = tEventTriggerTimeStamp;
+  rState.totalHits = tTotalHits;
+  rState.triggerWord = tTriggerWord;
+  rState.triggerNumber = tTriggerNumber;
+  rState.triggerTimeStamp = tTriggerTimeStamp;
+  rState.lastTriggerNumber = _lastTriggerNumber;
+  rState.lastTriggerTimeStamp = _lastTriggerTimeStamp;
+  rState.startWordIndex = _startWordIndex;
+  rState.actualLVL1ID = tActualLVL1ID;
+  rState.actualBCID = tActualBCID;
+  rState.tdcValue = tTdcValue;
+  rState.tdcTimeStamp = tTdcTimeStamp;
+  rState.tdcTriggerDistance = tTdcTriggerDistance;
+  rState.firstTriggerNrSet = _firstTriggerNrSet;
+  rState.firstTdcSet = _firstTdcSet;
+  rState.hitBuffer.assign(_hitBuffer, _hitBuffer + tHitBufferIndex);
+}
+
+void Interpret::loadState(const InterpretState& rState)
+{
+  tNdataWords = rState.nDataWords;
+  tNdataHeader = rState.nDataHeader;
+  tNdataRecord = rState.nDataRecord;
+  tStartBCID = rState.startBCID;
+  tStartLVL1ID = rState.startLVL1ID;
+  tDbCID = rState.dbCID;
+  tTriggerStatus = rState.triggerStatus;
+  tEventStatus = rState.eventStatus;
+  tServiceRecord = rState.serviceRecord;
+  tEventTriggerNumber = rState.eventTriggerNumber;
+  tEventTriggerTimeStamp = rState.eventTriggerTimeStamp;
+  tTotalHits = rState.totalHits;
+  tTriggerWord = rState.triggerWord;
+  tTriggerNumber = rState.triggerNumber;
+  tTriggerTimeStamp = rState.triggerTimeStamp;
+  _lastTriggerNumber = rState.lastTriggerNumber;
+  _lastTriggerTimeStamp = rState.lastTriggerTimeStamp;
+  _startWordIndex = rState.startWordIndex;
+  tActualLVL1ID = rState.actualLVL1ID;
+  tActualBCID = rState.actualBCID;
+  tTdcValue = rState.tdcValue;
+  tTdcTimeStamp = rState.tdcTimeStamp;
+  tTdcTriggerDistance = rState.tdcTriggerDistance;
+  _firstTriggerNrSet = rState.firstTriggerNrSet;
+  _firstTdcSet = rState.firstTdcSet;
+  tBCIDerror = false;
+  tHitBufferIndex = 0;
+  reserveHitBuffer((unsigned int) rState.hitBuffer.size());
+  for (unsigned int i = 0; i < rState.hitBuffer.size(); ++i, ++tHitBufferIndex) {
+    _hitBuffer[tHitBufferIndex] = rState.hitBuffer[i];
+    _hitBuffer[tHitBufferIndex].event_number = _nEvents;
+  }
+}
+
+bool Interpret::isSameState(const InterpretState& rState, const InterpretState& rOtherState)
+{
+  if (rState.nDataWords != rOtherState.nDataWords || rState.nDataHeader != rOtherState.nDataHeader || rState.nDataRecord != rOtherState.nDataRecord || rState.startBCID != rOtherState.startBCID || rState.startLVL1ID != rOtherState.startLVL1ID || rState.dbCID != rOtherState.dbCID)
+    return false;
+  if (rState.triggerStatus != rOtherState.triggerStatus || rState.eventStatus != rOtherState.eventStatus || rState.serviceRecord != rOtherState.serviceRecord || rState.eventTriggerNumber != rOtherState.eventTriggerNumber || rState.eventTriggerTimeStamp != rOtherState.eventTriggerTimeStamp)
+    return false;
+  if (rState.totalHits != rOtherState.totalHits || rState.triggerWord != rOtherState.triggerWord || rState.triggerNumber != rOtherState.triggerNumber || rState.triggerTimeStamp != rOtherState.triggerTimeStamp)
+    return false;
+  if (rState.lastTriggerNumber != rOtherState.lastTriggerNumber || rState.lastTriggerTimeStamp != rOtherState.lastTriggerTimeStamp || rState.startWordIndex != rOtherState.startWordIndex || rState.actualLVL1ID != rOtherState.actualLVL1ID || rState.actualBCID != rOtherState.actualBCID)
+    return false;
+  if (rState.tdcValue != rOtherState.tdcValue || rState.tdcTimeStamp != rOtherState.tdcTimeStamp || rState.tdcTriggerDistance != rOtherState.tdcTriggerDistance || rState.firstTriggerNrSet != rOtherState.firstTriggerNrSet || rState.firstTdcSet != rOtherState.firstTdcSet)
+    return false;
+  if (rState.hitBuffer.size() != rOtherState.hitBuffer.size())
+    return false;
+  for (unsigned int i = 0; i < rState.hitBuffer.size(); ++i) {  // the other hit infos are set when the event is stored, the event number is relative to the chunk start
+    const HitInfo& rHit = rState.hitBuffer[i];
+    const HitInfo& rOtherHit = rOtherState.hitBuffer[i];
+    if (rHit.relative_BCID != rOtherHit.relative_BCID || rHit.LVL1ID != rOtherHit.LVL1ID || rHit.column != rOtherHit.column || rHit.row != rOtherHit.row || rHit.tot != rOtherHit.tot || rHit.BCID != rOtherHit.BCID)
+      return false;
   }
   return true;
 }
@@ -394,19 +1057,114 @@ bool Interpret::setMetaDataV2(MetaInfoV2* &rMetaInfo, const unsigned int& tLengt
 void Interpret::getHits(HitInfo*& rHitInfo, unsigned int& rSize, bool copy)
 {
   debug("getHits(...)");
+  if (_hitInfo == 0 && !_createEventTable)
+    allocateHitArray();
   if (copy)
     std::copy(_hitInfo, _hitInfo + _hitInfoSize, rHitInfo);
   else
     rHitInfo = _hitInfo;
-  rSize = _hitIndex;
+  rSize = _createEventTable ? 0 : _hitIndex;
+}
+
+void Interpret::getEvents(EventInfo*& rEventInfo, unsigned int& rSize, bool copy)
+{
+  debug("getEvents(...)");
+  if (_eventInfo == 0 && _createEventTable)
+    allocateEventTableArrays();
+  if (copy)
+    std::copy(_eventInfo, _eventInfo + _eventInfoSize, rEventInfo);
+  else
+    rEventInfo = _eventInfo;
+  rSize = _eventIndex;
+}
+
+void Interpret::getSlimHits(SlimHitInfo*& rSlimHitInfo, unsigned int& rSize, bool copy)
+{
+  debug("getSlimHits(...)");
+  if (_slimHitInfo == 0 && _createEventTable)
+    allocateEventTableArrays();
+  if (copy)
+    std::copy(_slimHitInfo, _slimHitInfo + _hitInfoSize, rSlimHitInfo);
+  else
+    rSlimHitInfo = _slimHitInfo;
+  rSize = _createEventTable ? _hitIndex : 0;
 }
 
 void Interpret::setHitsArraySize(const unsigned int &rSize)
 {
   info("setHitsArraySize(...) with size " + IntToStr(rSize));
   deleteHitArray();
+  deleteEventTableArrays();
+  _hitInfoSize = rSize;  // the hit arrays are allocated when needed
+}
+
+void Interpret::setHitsArray(HitInfo*& rHitInfo, const unsigned int& rSize)
+{
+  info("setHitsArray(...) with size " + IntToStr(rSize));
+  deleteHitArray();
+  deleteEventTableArrays();  // the slim hit array has to have the same size
+  _hitInfo = rHitInfo;
   _hitInfoSize = rSize;
-  allocateHitArray();
+  _externalHitArray = true;
+}
+
+void Interpret::setEventTableArrays(EventInfo*& rEventInfo, const unsigned int& rNevents, SlimHitInfo*& rSlimHitInfo, const unsigned int& rNslimHits)
+{
+  info("setEventTableArrays(...) with size " + IntToStr(rNevents) + "/" + IntToStr(rNslimHits));
+  deleteHitArray();  // the hit array has to have the same size
+  deleteEventTableArrays();
+  _eventInfo = rEventInfo;
+  _eventInfoSize = rNevents;
+  _slimHitInfo = rSlimHitInfo;
+  _hitInfoSize = rNslimHits;
+  _externalEventTableArrays = true;
+}
+
+void Interpret::setEventsArraySize(const unsigned int& rSize)
+{
+  info("setEventsArraySize(...) with size " + IntToStr(rSize));
+  deleteEventTableArrays();
+  _eventInfoSize = rSize;  // the event table arrays are allocated when needed
+}
+
+void Interpret::createEventTable(bool CreateEventTable)
+{
+  debug("createEventTable");
+  _createEventTable = CreateEventTable;
+  if (_createEventTable)
+    deleteHitArray();
+  else
+    deleteEventTableArrays();
+}
+
+void Interpret::setMaxHitBufferSize(const unsigned int& rSize)
+{
+  info("setMaxHitBufferSize(...) with size " + IntToStr(rSize));
+  _maxHitBufferSize = rSize;
+  if (_hitBufferSize > _maxHitBufferSize && tHitBufferIndex <= _maxHitBufferSize)  // give back memory that cannot be used anymore
+    resizeHitBufferArray(_maxHitBufferSize);
+}
+
+void Interpret::setEventCallback(EventCallback pEventCallback, void* pUserData, bool storeEventHits)
+{
+  info("setEventCallback(...)");
+  _eventCallback = pEventCallback;
+  _eventCallbackData = pUserData;
+  _storeEventHits = (pEventCallback == 0 && _histogram == 0) || storeEventHits;  // without callback and histogram the hits are always stored
+}
+
+void Interpret::setHistogram(Histogram* pHistogram, bool storeEventHits)
+{
+  info("setHistogram(...)");
+  _histogram = pHistogram;
+  _storeEventHits = (pHistogram == 0 && _eventCallback == 0) || storeEventHits;  // without callback and histogram the hits are always stored
+}
+
+void Interpret::setNthreads(const unsigned int& rNthreads, const unsigned int& rMinWordsPerThread)
+{
+  info("setNthreads(...) with " + IntToStr(rNthreads) + " threads");
+  _nThreads = rNthreads > 0 ? rNthreads : getNumberOfCores();
+  _minWordsPerThread = std::max(rMinWordsPerThread, 1u);
 }
 
 void Interpret::setMetaDataEventIndex(uint64_t*& rEventNumber, const unsigned int& rSize)
@@ -429,6 +1187,7 @@ void Interpret::resetCounters()
   _nDataWords = 0;
   _nTriggers = 0;
   _nEvents = 0;
+  _nSlimHits = 0;
   _nIncompleteEvents = 0;
   _nDataRecords = 0;
   _nDataHeaders = 0;
@@ -518,6 +1277,7 @@ void Interpret::alignAtTriggerNumber(bool alignAtTriggerNumber)
 {
   info("alignAtTriggerNumber()");
   _alignAtTriggerNumber = alignAtTriggerNumber;
+  selectInterpretRawDataKernel();
 }
 
 void Interpret::setMaxTriggerNumber(const unsigned int& rMaxTriggerNumber)
@@ -529,24 +1289,28 @@ void Interpret::alignAtTdcWord(bool alignAtTdcWord)
 {
   info("alignAtTdcWord()");
   _alignAtTdcWord = alignAtTdcWord;
+  selectInterpretRawDataKernel();
 }
 
 void Interpret::setTriggerDataFormat(const unsigned int& rTriggerDataFormat)
 {
   info("setTriggerDataFormat()");
   _TriggerDataFormat = rTriggerDataFormat;
+  selectInterpretRawDataKernel();
 }
 
 void Interpret::setTdcTriggerTimeStamp(bool haveTdcTriggerTimeStamp)
 {
   info("setTdcTriggerTimeStamp()");
   _haveTdcTriggerTimeStamp = haveTdcTriggerTimeStamp;
+  selectInterpretRawDataKernel();
 }
 
 void Interpret::setTdcTriggerDistance(bool haveTdcTriggerDistance)
 {
   info("setTdcTriggerDistance()");
   _haveTdcTriggerDistance = haveTdcTriggerDistance;
+  selectInterpretRawDataKernel();
 }
 
 void Interpret::getServiceRecordsCounters(unsigned int*& rServiceRecordsCounter, unsigned int& rNserviceRecords, bool copy)
@@ -729,6 +1493,13 @@ void Interpret::debugEvents(const unsigned int& rStartEvent, const unsigned int&
   _debugEvents = debugEvents;
   _startDebugEvent = rStartEvent;
   _stopDebugEvent = rStopEvent;
+  selectInterpretRawDataKernel();
+}
+
+void Interpret::setFEI4B(bool pIsFEI4B)
+{
+  _fEI4B = pIsFEI4B;
+  selectInterpretRawDataKernel();
 }
 
 unsigned int Interpret::getHitSize()
@@ -746,6 +1517,11 @@ void Interpret::reset()
   _metaEventIndexLength = 0;
   _metaEventIndex = 0;
   _startWordIndex = 0;
+  _outputFull = false;
+  _nInterpretedWords = 0;
+  _nParallelReruns = 0;
+  _pendingEvents.clear();
+  _pendingHits.clear();
   // initialize SRAM variables to 0
   tTriggerNumber = 0;
   tTriggerTimeStamp = 0;
@@ -753,6 +1529,36 @@ void Interpret::reset()
   tActualBCID = 0;
   tActualSRcode= 0;
   tActualSRcounter = 0;
+  resetDiagnosticRecords();
+}
+
+void Interpret::setDiagnosticRecordsSize(const unsigned int& rSize)
+{
+  info("setDiagnosticRecordsSize(...) with size " + IntToStr(rSize));
+  deleteDiagnosticRecordsArray();
+  _diagnosticRecordsSize = rSize;
+  allocateDiagnosticRecordsArray();
+  resetDiagnosticRecords();
+}
+
+void Interpret::getDiagnosticRecords(DiagnosticRecord*& rDiagnosticRecords, unsigned int& rSize, bool copy)
+{
+  debug("getDiagnosticRecords(...)");
+  if (_nDiagnosticRecords > _diagnosticRecordsSize && _diagnosticRecordIndex != 0) {  // ring buffer wrapped around, move the oldest record to the front
+    std::rotate(_diagnosticRecords, _diagnosticRecords + _diagnosticRecordIndex, _diagnosticRecords + _diagnosticRecordsSize);
+    _diagnosticRecordIndex = 0;
+  }
+  rSize = std::min(_nDiagnosticRecords, _diagnosticRecordsSize);
+  if (copy)
+    std::copy(_diagnosticRecords, _diagnosticRecords + rSize, rDiagnosticRecords);
+  else
+    rDiagnosticRecords = _diagnosticRecords;
+}
+
+void Interpret::resetDiagnosticRecords()
+{
+  _diagnosticRecordIndex = 0;
+  _nDiagnosticRecords = 0;
 }
 
 void Interpret::resetMetaDataCounter()
@@ -765,7 +1571,7 @@ void Interpret::resetMetaDataCounter()
 
 bool Interpret::addHit(const unsigned char& pRelBCID, const unsigned short int& pLVL1ID, const unsigned char& pColumn, const unsigned short int& pRow, const unsigned char& pTot, const unsigned short int& pBCID)  // add hit with event number, column, row, relative BCID [0:15], tot, trigger ID
 {
-  if (tHitBufferIndex < __MAXHITBUFFERSIZE) {
+  if (reserveHitBuffer(tHitBufferIndex + 1)) {
     _hitBuffer[tHitBufferIndex].event_number = _nEvents;
     _hitBuffer[tHitBufferIndex].trigger_number = tEventTriggerNumber;
     _hitBuffer[tHitBufferIndex].trigger_time_stamp = tEventTriggerTimeStamp;
@@ -805,12 +1611,70 @@ void Interpret::storeHit(HitInfo& rHit)
       throw std::runtime_error("Output hit array not set.");
     }
   } else {
+    addDiagnosticRecord(__DIAG_HIT_ARRAY_FULL);
     if (Basis::errorSet())
       error("storeHit: _hitIndex = " + IntToStr(_hitIndex), __LINE__);
     throw std::out_of_range("Hit index out of range.");
   }
 }
 
+void Interpret::setEventInfo(EventInfo& rEventInfo)
+{
+  rEventInfo.event_number = _nEvents;
+  rEventInfo.trigger_number = tEventTriggerNumber;
+  rEventInfo.trigger_time_stamp = tEventTriggerTimeStamp;
+  rEventInfo.TDC = tTdcValue;
+  rEventInfo.TDC_time_stamp = tTdcTimeStamp;
+  rEventInfo.TDC_trigger_distance = tTdcTriggerDistance;
+  rEventInfo.trigger_status = tTriggerStatus;
+  rEventInfo.service_record = tServiceRecord;
+  rEventInfo.event_status = tEventStatus;
+  rEventInfo.n_hits = tHitBufferIndex;
+  rEventInfo.hit_index = 0;
+}
+
+void Interpret::storeEventInfo(const EventInfo& rEventInfo)
+{
+  if (_eventIndex < _eventInfoSize) {
+    if (_eventInfo != 0) {
+      _eventInfo[_eventIndex] = rEventInfo;
+      _eventInfo[_eventIndex].hit_index = _nSlimHits;
+      _eventIndex++;
+    } else {
+      throw std::runtime_error("Output event array not set.");
+    }
+  } else {
+    if (Basis::errorSet())
+      error("storeEventInfo: _eventIndex = " + IntToStr(_eventIndex), __LINE__);
+    throw std::out_of_range("Event index out of range.");
+  }
+}
+
+void Interpret::storeSlimHit(HitInfo& rHit)
+{
+  _nHits++;
+  if (_hitIndex < _hitInfoSize) {
+    if (_slimHitInfo != 0) {
+      _slimHitInfo[_hitIndex].event_number = rHit.event_number;
+      _slimHitInfo[_hitIndex].relative_BCID = rHit.relative_BCID;
+      _slimHitInfo[_hitIndex].LVL1ID = rHit.LVL1ID;
+      _slimHitInfo[_hitIndex].column = rHit.column;
+      _slimHitInfo[_hitIndex].row = rHit.row;
+      _slimHitInfo[_hitIndex].tot = rHit.tot;
+      _slimHitInfo[_hitIndex].BCID = rHit.BCID;
+      _hitIndex++;
+      _nSlimHits++;
+    } else {
+      throw std::runtime_error("Output slim hit array not set.");
+    }
+  } else {
+    addDiagnosticRecord(__DIAG_HIT_ARRAY_FULL);
+    if (Basis::errorSet())
+      error("storeSlimHit: _hitIndex = " + IntToStr(_hitIndex), __LINE__);
+    throw std::out_of_range("Hit index out of range.");
+  }
+}
+
 void Interpret::addEvent()
 {
   if (Basis::debugSet()) {
@@ -836,6 +1700,7 @@ void Interpret::addEvent()
   }
   if (tTriggerWord > 1) {
     addTriggerStatus(__TRG_NUMBER_MORE_ONE);
+    addDiagnosticRecord(__DIAG_TRG_NUMBER_MORE_ONE);
     if (Basis::warningSet())
       warning(std::string("addEvent: # trigger words > 1 at event " + LongIntToStr(_nEvents)));
   }
@@ -848,7 +1713,23 @@ void Interpret::addEvent()
     addEventStatus(__TDC_INVALID);
   }
 
-  storeEventHits();
+  if (_eventCallback != 0 || _histogram != 0) {
+    EventInfo tEventInfo;
+    setEventInfo(tEventInfo);
+    if (_eventCallback != 0)
+      _eventCallback(tEventInfo, _hitBuffer, tHitBufferIndex, _eventCallbackData);
+    if (_histogram != 0) {  // the event belongs to the last correlated read out, read out 0 without meta data
+      {
+        Histogram::FillGuard tFillGuard(*_histogram);  // nested in the fill of interpretRawData
+        _histogram->addEventHits(_hitBuffer, tHitBufferIndex, tEventInfo, _lastMetaIndexNotSet > 0 ? _lastMetaIndexNotSet - 1 : 0);
+      }
+      _histogram->serveSnapshot();  // the histograms are consistent after every event
+    }
+  }
+  if (_storeEventHits)
+    storeEventHits();
+  else
+    _nHits += tHitBufferIndex;
   if (tTotalHits > _nMaxHitsPerEvent)
     _nMaxHitsPerEvent = tTotalHits;
   histogramTriggerStatusCode();
@@ -872,6 +1753,21 @@ void Interpret::addEvent()
 
 void Interpret::storeEventHits()
 {
+  if (_createEventTable ? _externalEventTableArrays : _externalHitArray) {  // caller owned output arrays are filled until the next event does not fit
+    if (_outputFull || !outputHasSpace(tHitBufferIndex)) {
+      storePendingEvent();
+      _outputFull = true;
+      return;
+    }
+  }
+  if (_createEventTable) {  // the event infos are stored once in the event table
+    EventInfo tEventInfo;
+    setEventInfo(tEventInfo);
+    storeEventInfo(tEventInfo);
+    for (unsigned int i = 0; i < tHitBufferIndex; ++i)
+      storeSlimHit(_hitBuffer[i]);
+    return;
+  }
   for (unsigned int i = 0; i < tHitBufferIndex; ++i) {
     // duplicate certain values for all hits in an event
     _hitBuffer[i].trigger_number = tEventTriggerNumber;
@@ -887,16 +1783,88 @@ void Interpret::storeEventHits()
   }
 }
 
+bool Interpret::outputHasSpace(const unsigned int& rNhits)
+{
+  if (_createEventTable && _eventIndex >= _eventInfoSize)
+    return false;
+  return _hitIndex + rNhits <= _hitInfoSize;
+}
+
+void Interpret::storePendingEvent()
+{
+  EventInfo tEventInfo;
+  setEventInfo(tEventInfo);
+  _pendingEvents.push_back(tEventInfo);
+  for (unsigned int i = 0; i < tHitBufferIndex; ++i) {
+    HitInfo tHit = _hitBuffer[i];
+    tHit.trigger_number = tEventTriggerNumber;
+    tHit.trigger_time_stamp = tEventTriggerTimeStamp;
+    tHit.TDC = tTdcValue;
+    tHit.TDC_time_stamp = tTdcTimeStamp;
+    tHit.TDC_trigger_distance = tTdcTriggerDistance;
+    tHit.service_record = tServiceRecord;
+    tHit.trigger_status = tTriggerStatus;
+    tHit.event_status = tEventStatus;
+    _pendingHits.push_back(tHit);
+  }
+}
+
+bool Interpret::storePendingEvents()
+{
+  unsigned int tNstoredEvents = 0;
+  unsigned int tNstoredHits = 0;
+  for (; tNstoredEvents < _pendingEvents.size(); ++tNstoredEvents) {
+    const EventInfo& rEventInfo = _pendingEvents[tNstoredEvents];
+    if (!outputHasSpace(rEventInfo.n_hits)) {
+      if (_hitIndex == 0 && _eventIndex == 0) {  // the event does not even fit into the empty output arrays
+        addDiagnosticRecord(__DIAG_HIT_ARRAY_FULL);
+        if (Basis::errorSet())
+          error("storePendingEvents: event with " + IntToStr(rEventInfo.n_hits) + " hits does not fit into the output arrays", __LINE__);
+        throw std::out_of_range("Hit index out of range.");
+      }
+      break;
+    }
+    if (_createEventTable)
+      storeEventInfo(rEventInfo);
+    for (unsigned int i = 0; i < rEventInfo.n_hits; ++i, ++tNstoredHits) {
+      if (_createEventTable)
+        storeSlimHit(_pendingHits[tNstoredHits]);
+      else
+        storeHit(_pendingHits[tNstoredHits]);
+    }
+  }
+  _pendingEvents.erase(_pendingEvents.begin(), _pendingEvents.begin() + tNstoredEvents);
+  _pendingHits.erase(_pendingHits.begin(), _pendingHits.begin() + tNstoredHits);
+  return _pendingEvents.empty();
+}
+
+unsigned int Interpret::getReadOutStop(const unsigned int& rWordIndex, const unsigned int& rNdataWords)
+{
+  if (!_metaDataSet || _lastMetaIndexNotSet >= _metaEventIndexLength || _lastWordIndexSet < _dataWordIndex || _lastWordIndexSet - _dataWordIndex >= rNdataWords - rWordIndex)
+    return rNdataWords;  // the next read out does not start within the words
+  return rWordIndex + _lastWordIndexSet - _dataWordIndex + 1;  // the first word of the next read out is the last word of the actual one in the interpretation loop
+}
+
+bool Interpret::startNextReadOut(const unsigned int& rWordIndex, unsigned int& rReadOutStop, const unsigned int& rNdataWords)
+{
+  correlateMetaWordIndex(_nEvents, _dataWordIndex - 1);  // the last interpreted word starts the next read out
+  if (rWordIndex >= rNdataWords)
+    return false;
+  rReadOutStop = getReadOutStop(rWordIndex, rNdataWords);
+  return true;
+}
+
 void Interpret::correlateMetaWordIndex(const uint64_t& pEventNumber, const unsigned int& pDataWordIndex)
 {
-  if (_metaDataSet && pDataWordIndex == _lastWordIndexSet) {  // this check is to speed up the _metaEventIndex access by using the fact that the index has to increase for consecutive events
+  if (_metaDataSet && pDataWordIndex == _lastWordIndexSet && _lastMetaIndexNotSet < _metaEventIndexLength) {  // this check is to speed up the _metaEventIndex access by using the fact that the index has to increase for consecutive events
 //    std::cout<<"_lastMetaIndexNotSet "<<_lastMetaIndexNotSet<<"\n";
     _metaEventIndex[_lastMetaIndexNotSet] = pEventNumber;
     if (_isMetaTableV2 == true) {
       _lastWordIndexSet = _metaInfoV2[_lastMetaIndexNotSet].stopIndex;
       _lastMetaIndexNotSet++;
       while (_metaInfoV2[_lastMetaIndexNotSet - 1].length == 0 && _lastMetaIndexNotSet < _metaEventIndexLength) {
-        info("correlateMetaWordIndex: more than one readout during one event, correcting meta info");
+        if (Basis::infoSet())
+          info("correlateMetaWordIndex: more than one readout during one event, correcting meta info");
 //        std::cout<<"correlateMetaWordIndex: pEventNumber "<<pEventNumber<<" _lastWordIndexSet "<<_lastWordIndexSet<<" _lastMetaIndexNotSet "<<_lastMetaIndexNotSet<<"\n";
         _metaEventIndex[_lastMetaIndexNotSet] = pEventNumber;
         _lastWordIndexSet = _metaInfoV2[_lastMetaIndexNotSet].stopIndex;
@@ -909,7 +1877,8 @@ void Interpret::correlateMetaWordIndex(const uint64_t& pEventNumber, const unsig
       _lastWordIndexSet = _metaInfo[_lastMetaIndexNotSet].stopIndex;
       _lastMetaIndexNotSet++;
       while (_metaInfo[_lastMetaIndexNotSet - 1].length == 0 && _lastMetaIndexNotSet < _metaEventIndexLength) {
-        info("correlateMetaWordIndex: more than one readout during one event, correcting meta info");
+        if (Basis::infoSet())
+          info("correlateMetaWordIndex: more than one readout during one event, correcting meta info");
 //        std::cout<<"correlateMetaWordIndex: pEventNumber "<<pEventNumber<<" _lastWordIndexSet "<<_lastWordIndexSet<<" _lastMetaIndexNotSet "<<_lastMetaIndexNotSet<<"\n";
         _metaEventIndex[_lastMetaIndexNotSet] = pEventNumber;
         _lastWordIndexSet = _metaInfo[_lastMetaIndexNotSet].stopIndex;
@@ -921,6 +1890,64 @@ void Interpret::correlateMetaWordIndex(const uint64_t& pEventNumber, const unsig
   }
 }
 
+void Interpret::advanceMetaWordIndex(const unsigned int& rStartWordIndex, const unsigned int& rStopWordIndex)
+{
+  unsigned int tWordIndex = rStartWordIndex;
+  while (_metaDataSet && _lastWordIndexSet >= tWordIndex && _lastWordIndexSet < rStopWordIndex && _lastMetaIndexNotSet < _metaEventIndexLength) {  // the same steps as correlateMetaWordIndex() for the words [rStartWordIndex, rStopWordIndex)
+    tWordIndex = _lastWordIndexSet + 1;
+    if (_isMetaTableV2) {
+      _lastWordIndexSet = _metaInfoV2[_lastMetaIndexNotSet].stopIndex;
+      _lastMetaIndexNotSet++;
+      while (_metaInfoV2[_lastMetaIndexNotSet - 1].length == 0 && _lastMetaIndexNotSet < _metaEventIndexLength) {
+        _lastWordIndexSet = _metaInfoV2[_lastMetaIndexNotSet].stopIndex;
+        _lastMetaIndexNotSet++;
+      }
+    }
+    else {
+      _lastWordIndexSet = _metaInfo[_lastMetaIndexNotSet].stopIndex;
+      _lastMetaIndexNotSet++;
+      while (_metaInfo[_lastMetaIndexNotSet - 1].length == 0 && _lastMetaIndexNotSet < _metaEventIndexLength) {
+        _lastWordIndexSet = _metaInfo[_lastMetaIndexNotSet].stopIndex;
+        _lastMetaIndexNotSet++;
+      }
+    }
+  }
+}
+
+void Interpret::createWordTypeTable()
+{
+  debug(std::string("createWordTypeTable()"));
+  for (unsigned int i = 0; i < __N_WORD_TYPE_INDICES; ++i) {
+    unsigned int tWord = ((i & 0xF00) << 20) | ((i & 0x0FF) << 16) | DATA_RECORD_MIN_ROW;  // word with the header bits of the table index, the row is set to a valid value
+    if (DATA_HEADER_MACRO(tWord))
+      _wordTypeTable[i] = __DATA_HEADER_WORD_TYPE;
+    else if (isTriggerWord(tWord))
+      _wordTypeTable[i] = __TRIGGER_WORD_TYPE;
+    else if (SERVICE_RECORD_MACRO(tWord))
+      _wordTypeTable[i] = __SERVICE_RECORD_WORD_TYPE;
+    else if (isTdcWord(tWord))
+      _wordTypeTable[i] = __TDC_WORD_TYPE;
+    else if (isDataRecord(tWord))
+      _wordTypeTable[i] = __DATA_RECORD_WORD_TYPE;
+    else if (isAddressRecord(tWord))
+      _wordTypeTable[i] = __ADDRESS_RECORD_WORD_TYPE;
+    else if (isValueRecord(tWord))
+      _wordTypeTable[i] = __VALUE_RECORD_WORD_TYPE;
+    else if (isOtherWord(tWord))
+      _wordTypeTable[i] = __OTHER_WORD_TYPE;
+    else
+      _wordTypeTable[i] = __UNKNOWN_WORD_TYPE;
+  }
+}
+
+unsigned char Interpret::getWordType(const unsigned int& pSRAMWORD)
+{
+  unsigned char tWordType = _wordTypeTable[WORD_TYPE_INDEX_MACRO(pSRAMWORD)];
+  if (tWordType == __DATA_RECORD_WORD_TYPE && !DATA_RECORD_ROW_RANGE_MACRO(pSRAMWORD))  // the row is not encoded in the table index
+    return __UNKNOWN_WORD_TYPE;
+  return tWordType;
+}
+
 bool Interpret::getTimefromDataHeader(const unsigned int& pSRAMWORD, unsigned int& pLVL1ID, unsigned int& pBCID)
 {
   if (DATA_HEADER_MACRO(pSRAMWORD)) {
@@ -956,11 +1983,13 @@ bool Interpret::getHitsfromDataRecord(const unsigned int& pSRAMWORD, int& pColHi
 {
   // check if the hit values are reasonable
   if ((DATA_RECORD_TOT1_MACRO(pSRAMWORD) == 0xF) || (DATA_RECORD_COLUMN1_MACRO(pSRAMWORD) < RAW_DATA_MIN_COLUMN) || (DATA_RECORD_COLUMN1_MACRO(pSRAMWORD) > RAW_DATA_MAX_COLUMN) || (DATA_RECORD_ROW1_MACRO(pSRAMWORD) < RAW_DATA_MIN_ROW) || (DATA_RECORD_ROW1_MACRO(pSRAMWORD) > RAW_DATA_MAX_ROW)) {
-    warning(std::string("getHitsfromDataRecord: data record values (1. Hit) out of bounds at event " + LongIntToStr(_nEvents)));
+    if (Basis::warningSet())
+      warning(std::string("getHitsfromDataRecord: data record values (1. Hit) out of bounds at event " + LongIntToStr(_nEvents)));
     return false;
   }
   if ((DATA_RECORD_TOT2_MACRO(pSRAMWORD) != 0xF) && ((DATA_RECORD_COLUMN2_MACRO(pSRAMWORD) < RAW_DATA_MIN_COLUMN) || (DATA_RECORD_COLUMN2_MACRO(pSRAMWORD) > RAW_DATA_MAX_COLUMN) || (DATA_RECORD_ROW2_MACRO(pSRAMWORD) < RAW_DATA_MIN_ROW) || (DATA_RECORD_ROW2_MACRO(pSRAMWORD) > RAW_DATA_MAX_ROW))) {
-    warning(std::string("getHitsfromDataRecord: data record values (2. Hit) out of bounds at event " + LongIntToStr(_nEvents)));
+    if (Basis::warningSet())
+      warning(std::string("getHitsfromDataRecord: data record values (2. Hit) out of bounds at event " + LongIntToStr(_nEvents)));
     return false;
   }
 
@@ -986,6 +2015,191 @@ bool Interpret::getHitsfromDataRecord(const unsigned int& pSRAMWORD, int& pColHi
   return true;
 }
 
+#ifdef __SIMD_HAVE_AVX2
+// data record pre-scan for 8 words at once, returns the number of leading data records with reasonable hit infos of the checked words
+__SIMD_TARGET_AVX2 static unsigned int getDataRecordRunLengthAvx2(const unsigned int* pDataWords, const unsigned int& pNdataWords)
+{
+  unsigned int tNdataRecords = 0;
+  const __m256i tRowMask = _mm256_set1_epi32(DATA_RECORD_ROW_MASK);
+  const __m256i tColumnMask = _mm256_set1_epi32(DATA_RECORD_COLUMN_MASK);
+  for (; tNdataRecords + 8 <= pNdataWords; tNdataRecords += 8) {  // check 8 words at once
+    __m256i tWords = _mm256_loadu_si256((const __m256i*) (pDataWords + tNdataRecords));
+    __m256i tColumn = _mm256_and_si256(tWords, tColumnMask);
+    __m256i tRow = _mm256_and_si256(tWords, tRowMask);
+    __m256i tValid = _mm256_cmpeq_epi32(_mm256_and_si256(tWords, _mm256_set1_epi32(DATA_RECORD_MASK)), _mm256_setzero_si256());  // data record header
+    tValid = _mm256_and_si256(tValid, _mm256_cmpgt_epi32(tColumn, _mm256_set1_epi32(DATA_RECORD_MIN_COLUMN - 1)));
+    tValid = _mm256_and_si256(tValid, _mm256_cmpgt_epi32(_mm256_set1_epi32(DATA_RECORD_MAX_COLUMN + 1), tColumn));
+    tValid = _mm256_and_si256(tValid, _mm256_cmpgt_epi32(tRow, _mm256_set1_epi32(DATA_RECORD_MIN_ROW - 1)));
+    tValid = _mm256_and_si256(tValid, _mm256_cmpgt_epi32(_mm256_set1_epi32(DATA_RECORD_MAX_ROW + 1), tRow));
+    tValid = _mm256_andnot_si256(_mm256_cmpeq_epi32(_mm256_and_si256(tWords, _mm256_set1_epi32(DATA_RECORD_TOT1_MASK)), _mm256_set1_epi32(DATA_RECORD_TOT1_MASK)), tValid);  // TOT1 has to be set
+    tValid = _mm256_andnot_si256(_mm256_andnot_si256(_mm256_cmpeq_epi32(_mm256_and_si256(tWords, _mm256_set1_epi32(DATA_RECORD_TOT2_MASK)), _mm256_set1_epi32(DATA_RECORD_TOT2_MASK)), _mm256_cmpeq_epi32(tRow, _mm256_set1_epi32(DATA_RECORD_MAX_ROW))), tValid);  // second hit row has to be in range if TOT2 is set
+    int tValidMask = _mm256_movemask_ps(_mm256_castsi256_ps(tValid));
+    if (tValidMask != 0xFF) {  // not all words are data records, count the leading ones
+      while ((tValidMask & 1) != 0) {
+        tNdataRecords++;
+        tValidMask >>= 1;
+      }
+      return tNdataRecords;
+    }
+  }
+  return tNdataRecords;
+}
+#endif
+
+#ifdef __SIMD_HAVE_SSE2
+// data record pre-scan for 4 words at once, returns the number of leading data records with reasonable hit infos of the checked words
+static unsigned int getDataRecordRunLengthSse2(const unsigned int* pDataWords, const unsigned int& pNdataWords)
+{
+  unsigned int tNdataRecords = 0;
+  const __m128i tRowMask = _mm_set1_epi32(DATA_RECORD_ROW_MASK);
+  const __m128i tColumnMask = _mm_set1_epi32(DATA_RECORD_COLUMN_MASK);
+  for (; tNdataRecords + 4 <= pNdataWords; tNdataRecords += 4) {  // check 4 words at once
+    __m128i tWords = _mm_loadu_si128((const __m128i*) (pDataWords + tNdataRecords));
+    __m128i tColumn = _mm_and_si128(tWords, tColumnMask);
+    __m128i tRow = _mm_and_si128(tWords, tRowMask);
+    __m128i tValid = _mm_cmpeq_epi32(_mm_and_si128(tWords, _mm_set1_epi32(DATA_RECORD_MASK)), _mm_setzero_si128());  // data record header
+    tValid = _mm_and_si128(tValid, _mm_cmpgt_epi32(tColumn, _mm_set1_epi32(DATA_RECORD_MIN_COLUMN - 1)));
+    tValid = _mm_and_si128(tValid, _mm_cmplt_epi32(tColumn, _mm_set1_epi32(DATA_RECORD_MAX_COLUMN + 1)));
+    tValid = _mm_and_si128(tValid, _mm_cmpgt_epi32(tRow, _mm_set1_epi32(DATA_RECORD_MIN_ROW - 1)));
+    tValid = _mm_and_si128(tValid, _mm_cmplt_epi32(tRow, _mm_set1_epi32(DATA_RECORD_MAX_ROW + 1)));
+    tValid = _mm_andnot_si128(_mm_cmpeq_epi32(_mm_and_si128(tWords, _mm_set1_epi32(DATA_RECORD_TOT1_MASK)), _mm_set1_epi32(DATA_RECORD_TOT1_MASK)), tValid);  // TOT1 has to be set
+    tValid = _mm_andnot_si128(_mm_andnot_si128(_mm_cmpeq_epi32(_mm_and_si128(tWords, _mm_set1_epi32(DATA_RECORD_TOT2_MASK)), _mm_set1_epi32(DATA_RECORD_TOT2_MASK)), _mm_cmpeq_epi32(tRow, _mm_set1_epi32(DATA_RECORD_MAX_ROW))), tValid);  // second hit row has to be in range if TOT2 is set
+    int tValidMask = _mm_movemask_ps(_mm_castsi128_ps(tValid));
+    if (tValidMask != 0xF) {  // not all words are data records, count the leading ones
+      while ((tValidMask & 1) != 0) {
+        tNdataRecords++;
+        tValidMask >>= 1;
+      }
+      return tNdataRecords;
+    }
+  }
+  return tNdataRecords;
+}
+#endif
+
+unsigned int Interpret::getDataRecordRunLength(const unsigned int* pDataWords, const unsigned int& pNdataWords)
+{
+  unsigned int tNdataRecords = 0;  // the SIMD versions stop at the first invalid word or before the last incomplete block of words
+#ifdef __SIMD_HAVE_AVX2
+  if (_simdLevel >= __SIMD_AVX2)
+    tNdataRecords = getDataRecordRunLengthAvx2(pDataWords, pNdataWords);
+  else
+#endif
+#ifdef __SIMD_HAVE_SSE2
+  if (_simdLevel >= __SIMD_SSE2)
+    tNdataRecords = getDataRecordRunLengthSse2(pDataWords, pNdataWords);
+#endif
+  while (tNdataRecords < pNdataWords && DATA_RECORD_HITS_VALID_MACRO(pDataWords[tNdataRecords]))  // remaining words
+    tNdataRecords++;
+  return tNdataRecords;
+}
+
+#ifdef __SIMD_HAVE_AVX2
+// data record decoding for 8 words at once, returns the number of decoded words
+__SIMD_TARGET_AVX2 static unsigned int decodeDataRecordsAvx2(const unsigned int* pDataWords, const unsigned int& pNdataRecords, unsigned int* pHit1Pixels, unsigned int* pHit2Pixels)
+{
+  unsigned int tNdecoded = 0;
+  const __m256i tRowMask = _mm256_set1_epi32(DATA_RECORD_ROW_MASK);
+  const __m256i tColumnMask = _mm256_set1_epi32(DATA_RECORD_COLUMN_MASK);
+  for (; tNdecoded + 8 <= pNdataRecords; tNdecoded += 8) {  // decode 8 words at once
+    __m256i tWords = _mm256_loadu_si256((const __m256i*) (pDataWords + tNdecoded));
+    __m256i tColumnRow = _mm256_or_si256(_mm256_srli_epi32(_mm256_and_si256(tWords, tColumnMask), 17), _mm256_and_si256(tWords, tRowMask));
+    __m256i tHit1 = _mm256_or_si256(tColumnRow, _mm256_slli_epi32(_mm256_and_si256(tWords, _mm256_set1_epi32(DATA_RECORD_TOT1_MASK)), 20));
+    __m256i tHit2 = _mm256_or_si256(_mm256_add_epi32(tColumnRow, _mm256_set1_epi32(1 << 8)), _mm256_slli_epi32(_mm256_and_si256(tWords, _mm256_set1_epi32(DATA_RECORD_TOT2_MASK)), 24));  // the second hit is in the next row
+    _mm256_storeu_si256((__m256i*) (pHit1Pixels + tNdecoded), tHit1);
+    _mm256_storeu_si256((__m256i*) (pHit2Pixels + tNdecoded), tHit2);
+  }
+  return tNdecoded;
+}
+#endif
+
+#ifdef __SIMD_HAVE_SSE2
+// data record decoding for 4 words at once, returns the number of decoded words
+static unsigned int decodeDataRecordsSse2(const unsigned int* pDataWords, const unsigned int& pNdataRecords, unsigned int* pHit1Pixels, unsigned int* pHit2Pixels)
+{
+  unsigned int tNdecoded = 0;
+  const __m128i tRowMask = _mm_set1_epi32(DATA_RECORD_ROW_MASK);
+  const __m128i tColumnMask = _mm_set1_epi32(DATA_RECORD_COLUMN_MASK);
+  for (; tNdecoded + 4 <= pNdataRecords; tNdecoded += 4) {  // decode 4 words at once
+    __m128i tWords = _mm_loadu_si128((const __m128i*) (pDataWords + tNdecoded));
+    __m128i tColumnRow = _mm_or_si128(_mm_srli_epi32(_mm_and_si128(tWords, tColumnMask), 17), _mm_and_si128(tWords, tRowMask));
+    __m128i tHit1 = _mm_or_si128(tColumnRow, _mm_slli_epi32(_mm_and_si128(tWords, _mm_set1_epi32(DATA_RECORD_TOT1_MASK)), 20));
+    __m128i tHit2 = _mm_or_si128(_mm_add_epi32(tColumnRow, _mm_set1_epi32(1 << 8)), _mm_slli_epi32(_mm_and_si128(tWords, _mm_set1_epi32(DATA_RECORD_TOT2_MASK)), 24));  // the second hit is in the next row
+    _mm_storeu_si128((__m128i*) (pHit1Pixels + tNdecoded), tHit1);
+    _mm_storeu_si128((__m128i*) (pHit2Pixels + tNdecoded), tHit2);
+  }
+  return tNdecoded;
+}
+#endif
+
+void Interpret::decodeDataRecords(const unsigned int* pDataWords, const unsigned int& pNdataRecords, unsigned int* pHit1Pixels, unsigned int* pHit2Pixels)
+{
+  unsigned int tNdecoded = 0;  // the SIMD versions stop before the last incomplete block of words
+#ifdef __SIMD_HAVE_AVX2
+  if (_simdLevel >= __SIMD_AVX2)
+    tNdecoded = decodeDataRecordsAvx2(pDataWords, pNdataRecords, pHit1Pixels, pHit2Pixels);
+  else
+#endif
+#ifdef __SIMD_HAVE_SSE2
+  if (_simdLevel >= __SIMD_SSE2)
+    tNdecoded = decodeDataRecordsSse2(pDataWords, pNdataRecords, pHit1Pixels, pHit2Pixels);
+#endif
+  for (unsigned int i = tNdecoded; i < pNdataRecords; ++i) {  // remaining words
+    pHit1Pixels[i] = DATA_RECORD_HIT1_PIXEL_MACRO(pDataWords[i]);
+    pHit2Pixels[i] = DATA_RECORD_HIT2_PIXEL_MACRO(pDataWords[i]);
+  }
+}
+
+void Interpret::addDataRecordHits(const unsigned int* pDataWords, const unsigned int& pNdataRecords)
+{
+  HitInfo tHit;  // hit with the values that are the same for all hits of the data records
+  tHit.event_number = _nEvents;
+  tHit.trigger_number = tEventTriggerNumber;
+  tHit.trigger_time_stamp = tEventTriggerTimeStamp;
+  tHit.relative_BCID = tDbCID;
+  tHit.LVL1ID = tActualLVL1ID;
+  tHit.column = 0;
+  tHit.row = 0;
+  tHit.tot = 0;
+  tHit.BCID = tActualBCID;
+  tHit.TDC = tTdcValue;
+  tHit.TDC_time_stamp = tTdcTimeStamp;
+  tHit.TDC_trigger_distance = tTdcTriggerDistance;
+  tHit.service_record = tServiceRecord;
+  tHit.trigger_status = tTriggerStatus;
+  tHit.event_status = tEventStatus;
+  bool tCountHits = (tEventStatus & __NO_HIT) != __NO_HIT;  // only count non-virtual hits
+
+  unsigned int tHit1Pixels[__DATA_RECORD_BLOCK_SIZE];  // packed column, row and ToT values of the first hits of a block of data records
+  unsigned int tHit2Pixels[__DATA_RECORD_BLOCK_SIZE];  // packed column, row and ToT values of the second hits of a block of data records
+  for (unsigned int tStart = 0; tStart < pNdataRecords; tStart += __DATA_RECORD_BLOCK_SIZE) {
+    unsigned int tNdataRecords = std::min(pNdataRecords - tStart, __DATA_RECORD_BLOCK_SIZE);
+    decodeDataRecords(pDataWords + tStart, tNdataRecords, tHit1Pixels, tHit2Pixels);
+    for (unsigned int i = 0; i < tNdataRecords; ++i) {
+      unsigned int tTot1 = tHit1Pixels[i] >> 24;
+      unsigned int tTot2 = tHit2Pixels[i] >> 24;
+      if (tTot1 <= _maxTot) {  // ommit late/small hit and no hit TOT values for the TOT(1) hit
+        _hitBuffer[tHitBufferIndex] = tHit;
+        std::memcpy(&_hitBuffer[tHitBufferIndex].column, &tHit1Pixels[i], sizeof(unsigned int));  // column, row and tot at once
+        tHitBufferIndex++;
+        if (tCountHits)
+          tTotalHits++;
+      }
+      if (tTot1 == 14)
+        _nSmallHits++;
+      if (tTot2 <= _maxTot) {  // ommit late/small hit and no hit (15) tot values for the TOT(2) hit
+        _hitBuffer[tHitBufferIndex] = tHit;
+        std::memcpy(&_hitBuffer[tHitBufferIndex].column, &tHit2Pixels[i], sizeof(unsigned int));  // column, row and tot at once
+        tHitBufferIndex++;
+        if (tCountHits)
+          tTotalHits++;
+      }
+      if (tTot2 == 14)
+        _nSmallHits++;
+    }
+  }
+}
+
 bool Interpret::getInfoFromServiceRecord(const unsigned int& pSRAMWORD, unsigned int& pSRcode, unsigned int& pSRcount)
 {
   if (SERVICE_RECORD_MACRO(pSRAMWORD)) {
@@ -1114,6 +2328,20 @@ void Interpret::addTdcTriggerDistanceValue(const unsigned int& pTdcTriggerDistan
     _tdcTriggerDistance[pTdcTriggerDistanceValue] += 1;
 }
 
+void Interpret::addDiagnosticRecord(const unsigned short& pCode, const unsigned int& pWord)
+{
+  if (_diagnosticRecordsSize == 0)
+    return;
+  _diagnosticRecords[_diagnosticRecordIndex].word_index = _nDataWords;
+  _diagnosticRecords[_diagnosticRecordIndex].event_number = _nEvents;
+  _diagnosticRecords[_diagnosticRecordIndex].code = pCode;
+  _diagnosticRecords[_diagnosticRecordIndex].raw_word = pWord;
+  _nDiagnosticRecords++;
+  _diagnosticRecordIndex++;
+  if (_diagnosticRecordIndex == _diagnosticRecordsSize)  // ring buffer, overwrite the oldest records
+    _diagnosticRecordIndex = 0;
+}
+
 void Interpret::allocateHitArray()
 {
   debug(std::string("allocateHitArray()"));
@@ -1130,21 +2358,55 @@ void Interpret::deleteHitArray()
   debug(std::string("deleteHitArray()"));
   if (_hitInfo == 0)
     return;
-  delete[] _hitInfo;
+  if (!_externalHitArray)  // caller owned arrays are not deleted
+    delete[] _hitInfo;
   _hitInfo = 0;
+  _externalHitArray = false;
 }
 
-void Interpret::allocateHitBufferArray()
+void Interpret::allocateEventTableArrays()
 {
-  debug(std::string("allocateHitBufferArray()"));
+  debug(std::string("allocateEventTableArrays()"));
+  deleteEventTableArrays();
   try {
-    _hitBuffer = new HitInfo[__MAXHITBUFFERSIZE];
+    _eventInfo = new EventInfo[_eventInfoSize];
+    _slimHitInfo = new SlimHitInfo[_hitInfoSize];
   } catch (std::bad_alloc& exception) {
-    error(std::string("allocateHitBufferArray(): ") + std::string(exception.what()));
+    error(std::string("allocateEventTableArrays(): ") + std::string(exception.what()));
     throw;
   }
 }
 
+void Interpret::deleteEventTableArrays()
+{
+  debug(std::string("deleteEventTableArrays()"));
+  if (!_externalEventTableArrays) {  // caller owned arrays are not deleted
+    delete[] _eventInfo;
+    delete[] _slimHitInfo;
+  }
+  _eventInfo = 0;
+  _slimHitInfo = 0;
+  _externalEventTableArrays = false;
+}
+
+void Interpret::resizeHitBufferArray(const unsigned int& rSize)
+{
+  debug(std::string("resizeHitBufferArray(...) with size ") + IntToStr(rSize));
+  HitInfo* tHitBuffer = 0;
+  try {
+    tHitBuffer = new HitInfo[rSize];
+  } catch (std::bad_alloc& exception) {
+    error(std::string("resizeHitBufferArray(): ") + std::string(exception.what()));
+    throw;
+  }
+  if (_hitBuffer != 0) {
+    std::copy(_hitBuffer, _hitBuffer + std::min(tHitBufferIndex, rSize), tHitBuffer);
+    delete[] _hitBuffer;
+  }
+  _hitBuffer = tHitBuffer;
+  _hitBufferSize = rSize;
+}
+
 void Interpret::deleteHitBufferArray()
 {
   debug(std::string("deleteHitBufferArray()"));
@@ -1152,6 +2414,22 @@ void Interpret::deleteHitBufferArray()
     return;
   delete[] _hitBuffer;
   _hitBuffer = 0;
+  _hitBufferSize = 0;
+}
+
+bool Interpret::reserveHitBuffer(const unsigned int& rNhits)
+{
+  if (rNhits <= _hitBufferSize)
+    return true;
+  if (rNhits > _maxHitBufferSize)
+    return false;
+  unsigned int tNewSize = _hitBufferSize > 0 ? _hitBufferSize : (unsigned int) __HITBUFFERSTARTSIZE;  // grow geometrically
+  while (tNewSize < rNhits && tNewSize <= _maxHitBufferSize / 2)
+    tNewSize *= 2;
+  if (tNewSize < rNhits || tNewSize > _maxHitBufferSize)
+    tNewSize = _maxHitBufferSize;
+  resizeHitBufferArray(tNewSize);
+  return true;
 }
 
 void Interpret::allocateTriggerStatusCounterArray()
@@ -1278,3 +2556,25 @@ void Interpret::deleteServiceRecordCounterArray()
   delete[] _serviceRecordCounter;
   _serviceRecordCounter = 0;
 }
+
+void Interpret::allocateDiagnosticRecordsArray()
+{
+  debug(std::string("allocateDiagnosticRecordsArray()"));
+  if (_diagnosticRecordsSize == 0)
+    return;
+  try {
+    _diagnosticRecords = new DiagnosticRecord[_diagnosticRecordsSize];
+  } catch (std::bad_alloc& exception) {
+    error(std::string("allocateDiagnosticRecordsArray(): ") + std::string(exception.what()));
+    throw;
+  }
+}
+
+void Interpret::deleteDiagnosticRecordsArray()
+{
+  debug(std::string("deleteDiagnosticRecordsArray()"));
+  if (_diagnosticRecords == 0)
+    return;
+  delete[] _diagnosticRecords;
+  _diagnosticRecords = 0;
+}
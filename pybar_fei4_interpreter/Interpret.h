@@ -5,13 +5,21 @@
 #include <string>
 #include <ctime>
 #include <cmath>
+#include <cstring>
 
 #include "Basis.h"
 #include "defines.h"
+#include "CpuDispatch.h"
+#include "Threads.h"
+#include "Histogram.h"
 
 #define __DEBUG false
 #define __DEBUG2 false
 
+// event callback, called by addEvent() with the event infos and the hits of the event; the hits are only valid during the call
+// and only the hit values are set, the event values of the hits are in the event infos
+typedef void (*EventCallback)(const EventInfo& rEventInfo, const HitInfo* pHits, const unsigned int& rNhits, void* pUserData);
+
 class Interpret: public Basis
 {
 public:
@@ -19,19 +27,27 @@ public:
   ~Interpret(void);
 
   // main functions
-  bool interpretRawData(unsigned int* pDataWords, const unsigned int& pNdataWords);  // starts to interpret the actual raw data pDataWords and saves result to _hitInfo
+  bool interpretRawData(unsigned int* pDataWords, const unsigned int& pNdataWords);  // starts to interpret the actual raw data pDataWords and saves result to _hitInfo, returns false if caller owned output arrays are full before all words are interpreted
+  void histogramOccupancy(unsigned int* pDataWords, const unsigned int& pNdataWords);  // fast mode for occupancy scans, counts the data record hits per read out into the occupancy histogram (and the ToT sums of the mean ToT) set with setHistogram() without building events; the other words are only counted
   bool setMetaData(MetaInfo* &rMetaInfo, const unsigned int& tLength);  // sets the meta words for word number/event correlation
   bool setMetaDataV2(MetaInfoV2* &rMetaInfo, const unsigned int& tLength);  // sets the meta words for word number/event correlation
   void getHits(HitInfo*& rHitInfo, unsigned int& rSize, bool copy = false);  // returns the hit histogram
+  void getEvents(EventInfo*& rEventInfo, unsigned int& rSize, bool copy = false);  // returns the event table, only filled if createEventTable is set
+  void getSlimHits(SlimHitInfo*& rSlimHitInfo, unsigned int& rSize, bool copy = false);  // returns the slim hit table, only filled if createEventTable is set
 
   // set arrays to be filled
   void setMetaDataEventIndex(uint64_t*& rEventNumber, const unsigned int& rSize);  // set the meta event index array to be filled
   void setMetaDataWordIndex(MetaWordInfoOut*& rWordNumber, const unsigned int& rSize);  // set the meta word index array to be filled
+  void setHitsArray(HitInfo*& rHitInfo, const unsigned int& rSize);  // set a caller owned hit array to be filled, if it is full the interpretation stops after the last event that fits
+  void setEventTableArrays(EventInfo*& rEventInfo, const unsigned int& rNevents, SlimHitInfo*& rSlimHitInfo, const unsigned int& rNslimHits);  // set caller owned event table arrays to be filled, if they are full the interpretation stops after the last event that fits
 
   // array info get functions
   unsigned int getNarrayHits() {return _hitIndex;};  // the number of hits of the actual interpreted raw data
+  unsigned int getNarrayEvents() {return _eventIndex;};  // the number of events in the event table of the actual interpreted raw data
   unsigned int getNmetaDataEvent() {return _lastMetaIndexNotSet;};  // the filled length of the array storing the event number per read out
   unsigned int getNmetaDataWord() {return _actualMetaWordIndex;};
+  unsigned int getNinterpretedWords() {return _nInterpretedWords;};  // the number of words interpreted by the last interpretRawData call, the following words have to be given to the next call
+  unsigned int getNpendingEvents() {return (unsigned int) _pendingEvents.size();};  // the number of events that did not fit into the caller owned arrays anymore, they are stored by the next interpretRawData call
 
   // initializers, should be called before first call of interpretRawData() with new data file
   void resetCounters();  // reset summary counters
@@ -40,11 +56,21 @@ public:
 
   // analysis options
   void setHitsArraySize(const unsigned int &rSize);  // set the size of the hit array, has to be able to hold hits of one event
+  void setEventsArraySize(const unsigned int& rSize);  // set the size of the event table array, has to be able to hold the events of one raw data chunk
+  void createEventTable(bool CreateEventTable = true);  // store the events into the event table and the hits into the slim hit table instead of the combined hit array
+  void setEventCallback(EventCallback pEventCallback, void* pUserData = 0, bool storeEventHits = true);  // calls pEventCallback for every event, 0 removes the callback; if storeEventHits is false the hits are only given to the callback and not stored
+  void setHistogram(Histogram* pHistogram, bool storeEventHits = true);  // fills the histograms of pHistogram directly with the hits of every event, the scan parameter is the one of the actual read out, 0 removes the histogram; if storeEventHits is false the hits are not stored into the output arrays
+  void setMaxHitBufferSize(const unsigned int& rSize);  // sets the maximum number of hits in one event, more hits are ignored and the event is flagged as truncated
+  void setNthreads(const unsigned int& rNthreads, const unsigned int& rMinWordsPerThread = __PARALLEL_MIN_WORDS);  // interprets raw data chunks with at least rMinWordsPerThread words per thread in parallel, 0 uses all cores; the result is the same as for the serial interpretation
+  unsigned int getNthreads() {return _nThreads;};
+  unsigned int getNparallelReruns() {return _nParallelReruns;};  // returns the number of parallel chunks that had to be interpreted again because the event state at the chunk start was not found
+  unsigned int getMaxHitBufferSize() {return _maxHitBufferSize;};
+  unsigned int getHitBufferSize() {return _hitBufferSize;};  // returns the number of hits the event hit buffer can hold without growing
   void createEmptyEventHits(bool CreateEmptyEventHits = true);  // create hits that are virtual hits (not real hits) for debugging, thus event no hit events will show up in the hit table
   void createMetaDataWordIndex(bool CreateMetaDataWordIndex = true);
   void setNbCIDs(const unsigned int& NbCIDs);  // set the number of BCIDs with hits for the actual trigger
   void setMaxTot(const unsigned int& rMaxTot);  // sets the maximum ToT code that is considered to be a hit
-  void setFEI4B(bool pIsFEI4B = true) {_fEI4B = pIsFEI4B;};  // set the FE flavor to be able to read the raw data correctly
+  void setFEI4B(bool pIsFEI4B = true);  // set the FE flavor to be able to read the raw data correctly
   bool getFEI4B() {return _fEI4B;};  // returns the FE flavor set
   bool getMetaTableV2() {return _isMetaTableV2;};  // returns the MetaTable flavor (V1 or V2)
   void alignAtTriggerNumber(bool alignAtTriggerNumber = true);  // new events are created if trigger number occurs
@@ -80,18 +106,90 @@ public:
   void reset();  // resets all data but keeps the settings
   void resetMetaDataCounter();  // resets the meta data counter, is needed if meta data was combined from different files
   unsigned int getHitSize();  // return the size of one hit entry in the hit array, needed to check data in memory alignment
+  std::string getSimdVersion() {return getSimdLevelName(_simdLevel);};  // returns the instruction set of the data record pre-scan in use
+
+  // diagnostics, fixed size binary records of the conditions found during interpretation stored in a ring buffer
+  void setDiagnosticRecordsSize(const unsigned int& rSize);  // sets the number of diagnostic records kept, 0 disables the diagnostics
+  void getDiagnosticRecords(DiagnosticRecord*& rDiagnosticRecords, unsigned int& rSize, bool copy = false);  // returns the kept diagnostic records, oldest first
+  unsigned int getNdiagnosticRecords() {return _nDiagnosticRecords;};  // returns the total number of diagnostic records, including the overwritten ones
+  void resetDiagnosticRecords();  // deletes all diagnostic records
 
 private:
+  // interpretation kernels, one kernel for each combination of the options that are fixed for the raw data interpretation
+  typedef void (Interpret::*InterpretRawDataKernel)(unsigned int* pDataWords, const unsigned int& pNdataWords);
+  template <bool TFEI4B, bool TAlignAtTriggerNumber, bool TAlignAtTdcWord, unsigned int TTriggerDataFormat, bool THaveTdcTriggerTimeStamp, bool THaveTdcTriggerDistance, bool TDebugEvents> void interpretRawDataKernel(unsigned int* pDataWords, const unsigned int& pNdataWords);  // interprets the raw data words with the options given as template parameters
+  void selectInterpretRawDataKernel();  // sets _interpretRawDataKernel to the kernel of the actual options, has to be called if one of the options changes
+  template <bool TFEI4B> void selectInterpretRawDataKernel();
+  template <bool TFEI4B, bool TAlignAtTriggerNumber> void selectInterpretRawDataKernel();
+  template <bool TFEI4B, bool TAlignAtTriggerNumber, bool TAlignAtTdcWord> void selectInterpretRawDataKernel();
+  template <bool TFEI4B, bool TAlignAtTriggerNumber, bool TAlignAtTdcWord, unsigned int TTriggerDataFormat> void selectInterpretRawDataKernel();
+  template <bool TFEI4B, bool TAlignAtTriggerNumber, bool TAlignAtTdcWord, unsigned int TTriggerDataFormat, bool THaveTdcTriggerTimeStamp> void selectInterpretRawDataKernel();
+  template <bool TFEI4B, bool TAlignAtTriggerNumber, bool TAlignAtTdcWord, unsigned int TTriggerDataFormat, bool THaveTdcTriggerTimeStamp, bool THaveTdcTriggerDistance> void selectInterpretRawDataKernel();
+
   bool addHit(const unsigned char& pRelBCID, const unsigned short int& pLVLID, const unsigned char& pColumn, const unsigned short int& pRow, const unsigned char& pTot, const unsigned short int& pBCID);  // adds the hit to the event hits array _hitBuffer
   void storeHit(HitInfo& rHit);  // stores the hit into the output hit array _hitInfo
   void storeEventHits();  // adds the hits of the actual event to _hitInfo
-  void correlateMetaWordIndex(const uint64_t& pEventNumber, const unsigned int& pDataWordIndex);  // writes the event number for the meta data
+  bool outputHasSpace(const unsigned int& rNhits);  // returns true if an event with rNhits hits fits into the output arrays
+  void storePendingEvent();  // keeps the actual event until the next interpretRawData call, needed if the caller owned output arrays are full
+  bool storePendingEvents();  // stores the kept events into the output arrays, returns false if not all of them fit
+  unsigned int getReadOutStop(const unsigned int& rWordIndex, const unsigned int& rNdataWords);  // returns the loop index after the last word of the actual read out, rNdataWords if it does not end within the words
+  bool startNextReadOut(const unsigned int& rWordIndex, unsigned int& rReadOutStop, const unsigned int& rNdataWords);  // correlates the meta data of the read out starting with the last interpreted word and sets the loop index after the next read out, returns false at the end of the words
+  void correlateMetaWordIndex(const uint64_t& pEventNumber, const unsigned int& pDataWordIndex);  // writes the event number for the meta data if a read out starts with the word pDataWordIndex
+  void advanceMetaWordIndex(const unsigned int& rStartWordIndex, const unsigned int& rStopWordIndex);  // sets the meta data correlation state to the word index rStopWordIndex without writing event numbers, as if the words were interpreted
+
+  // parallel interpretation, the raw data is split into chunks that are interpreted by separate interpreters and merged in order
+  struct InterpretState  // the variables the interpretation of the following words depends on
+  {
+    unsigned int nDataWords, nDataHeader, nDataRecord, startBCID, startLVL1ID, dbCID;
+    unsigned char triggerStatus;
+    unsigned short eventStatus;
+    unsigned int serviceRecord, eventTriggerNumber, eventTriggerTimeStamp, totalHits, triggerWord, triggerNumber, triggerTimeStamp;
+    unsigned int lastTriggerNumber, lastTriggerTimeStamp, startWordIndex, actualLVL1ID, actualBCID;
+    unsigned short tdcValue, tdcTimeStamp;
+    unsigned char tdcTriggerDistance;
+    bool firstTriggerNrSet, firstTdcSet;
+    std::vector<HitInfo> hitBuffer;  // hits of the actual event
+  };
+  struct ParallelChunk
+  {
+    Interpret* interpreter;  // the interpreter of the chunk, the main interpreter for the first chunk
+    unsigned int* dataWords;  // all raw data words of the interpretRawData call
+    unsigned int nDataWords;  // total word counter of the main interpreter before the interpretRawData call
+    unsigned int dataWordIndex;  // word index of the main interpreter before the interpretRawData call
+    unsigned int lastMetaIndexNotSet;  // meta data correlation state of the main interpreter before the interpretRawData call
+    unsigned int lastWordIndexSet;
+    unsigned int startWordIndex;
+    unsigned int warmUpStart;  // index of the first word interpreted to find the event state at the chunk start
+    unsigned int start;  // index of the first word of the chunk
+    unsigned int stop;  // index after the last word of the chunk
+    unsigned int metaIndexStart;  // first meta event index set by the chunk
+    std::string error;  // text of the exception raised by the chunk interpretation, the chunk has to be interpreted again by the main interpreter
+    bool outOfRange;  // the exception was an out of range exception
+    InterpretState startState;  // event state at the chunk start
+    InterpretState stopState;  // event state at the chunk stop
+    std::vector<MetaWordInfoOut> metaWordIndex;  // meta word index of the chunk
+  };
+  void interpretRawDataParallel(unsigned int* pDataWords, const unsigned int& pNdataWords, const unsigned int& rNchunks);  // interprets the raw data in rNchunks chunks in parallel
+  unsigned int getParallelChunkStart(unsigned int* pDataWords, const unsigned int& pNdataWords, const unsigned int& rIndex);  // returns the index of the first trigger word of the first read out starting at or after rIndex
+  bool getParallelWarmUpStart(unsigned int* pDataWords, const unsigned int& rChunkStart, unsigned int& rWarmUpStart);  // sets rWarmUpStart to the first word in front of the chunk from which on the event state at the chunk start is found, returns false if there is none
+  static void interpretParallelChunk(ParallelChunk& rChunk);  // finds the event state at the chunk start and interprets the chunk, does not throw
+  void interpretChunk(ParallelChunk& rChunk);  // finds the event state at the chunk start and interprets the chunk with this chunk interpreter
+  void copySettings(const Interpret& rInterpret, const unsigned int& rNdataWords);  // copies the interpretation options and the meta data settings, the output arrays are sized for rNdataWords words
+  bool addChunkResults(Interpret& rInterpret, const ParallelChunk& rChunk);  // appends the results of the chunk interpreter, event numbers are shifted by the actual number of events; returns false without adding anything if the results do not fit into the output arrays
+  void saveState(InterpretState& rState);
+  void loadState(const InterpretState& rState);  // the event number of the hits is set to the actual event number
+  bool isSameState(const InterpretState& rState, const InterpretState& rOtherState);
 
   // SRAM word check and interpreting methods
+  void createWordTypeTable();  // fills the word type look up table _wordTypeTable, the order of the word checks is the same as in the interpretation
+  unsigned char getWordType(const unsigned int& pSRAMWORD);  // returns the word type of the SRAM word from the word type look up table
   bool getTimefromDataHeader(const unsigned int& pSRAMWORD, unsigned int& pLVL1ID, unsigned int& pBCID);  // returns true if the SRAMword is a data header and if it is sets the BCID and LVL1
   bool isDataRecord(const unsigned int& pSRAMWORD);  // returns true if data word is a data record (no col, row, ToT limit checks done, only check for data record header)
   bool isTdcWord(const unsigned int& pSRAMWORD);  // returns true if the data word is a TDC count word
   bool getHitsfromDataRecord(const unsigned int& pSRAMWORD, int& pColHit1, int& pRowHit1, int& pTotHit1, int& pColHit2, int& pRowHit2, int& pTotHit2);  // returns true if the SRAMword is a data record with reasonable hit infos and if it is sets pCol,pRow,pTot
+  unsigned int getDataRecordRunLength(const unsigned int* pDataWords, const unsigned int& pNdataWords);  // returns the number of consecutive data records with reasonable hit infos at the beginning of pDataWords, uses the SIMD instructions selected at run time
+  void decodeDataRecords(const unsigned int* pDataWords, const unsigned int& pNdataRecords, unsigned int* pHit1Pixels, unsigned int* pHit2Pixels);  // decodes the column, row and ToT values of both hits of the data records, packed as in DATA_RECORD_HIT1_PIXEL_MACRO, uses the SIMD instructions selected at run time
+  void addDataRecordHits(const unsigned int* pDataWords, const unsigned int& pNdataRecords);  // adds the hits of consecutive data records with reasonable hit infos to the event hits array _hitBuffer
   bool getInfoFromServiceRecord(const unsigned int& pSRAMWORD, unsigned int& pSRcode, unsigned int& pSRcount);  // returns true if the SRAMword is a service record and sets pSRcode, pSRcount
   bool isTriggerWord(const unsigned int& pSRAMWORD);  // returns true if data word is trigger word
   bool isAddressRecord(const unsigned int& pSRAMWORD, unsigned int& rAddress, bool& isShiftRegister);  // returns true if data word is a address record
@@ -108,13 +206,20 @@ private:
   void addServiceRecord(const unsigned char& pSRcode, const unsigned int& pSRcounter);  // adds the service record code to SR histogram
   void addTdcValue(const unsigned int& pTdcValue);  // adds the TDC value to TDC histogram
   void addTdcTriggerDistanceValue(const unsigned int& pTdcTriggerDistanceValue);  // adds the TDC distance value to TDC histogram
+  void addDiagnosticRecord(const unsigned short& pCode, const unsigned int& pWord = 0);  // adds a diagnostic record for the actual word/event to the ring buffer if diagnostics are activated
 
   // memory allocation/initialization
   void setStandardSettings();
   void allocateHitArray();
   void deleteHitArray();
-  void allocateHitBufferArray();
+  void allocateEventTableArrays();
+  void deleteEventTableArrays();
+  void setEventInfo(EventInfo& rEventInfo);  // sets the event infos of the actual event, without the hit index
+  void storeEventInfo(const EventInfo& rEventInfo);  // stores the event infos into the event table _eventInfo
+  void storeSlimHit(HitInfo& rHit);  // stores the hit into the slim hit table _slimHitInfo
+  void resizeHitBufferArray(const unsigned int& rSize);  // reallocates the event hit buffer and keeps the hits of the actual event
   void deleteHitBufferArray();
+  bool reserveHitBuffer(const unsigned int& rNhits);  // makes sure that the event hit buffer can hold rNhits hits, returns false if rNhits exceeds the maximum number of hits in one event
   void allocateTriggerStatusCounterArray();
   void resetTriggerStatusCounterArray();
   void deleteTriggerStatusCounterArray();
@@ -130,15 +235,30 @@ private:
   void allocateServiceRecordCounterArray();
   void resetServiceRecordCounterArray();
   void deleteServiceRecordCounterArray();
+  void allocateDiagnosticRecordsArray();
+  void deleteDiagnosticRecordsArray();
 
   // array variables for interpreted information
   unsigned int _hitInfoSize;  // size of the _hitInfo array
   unsigned int _hitIndex;  // max index of _hitInfo filled
   HitInfo* _hitInfo;  // holds the actual interpreted hits
+  SlimHitInfo* _slimHitInfo;  // holds the actual interpreted hits without event infos if the event table is created, size _hitInfoSize and index _hitIndex
+  unsigned int _eventInfoSize;  // size of the _eventInfo array
+  unsigned int _eventIndex;  // max index of _eventInfo filled
+  EventInfo* _eventInfo;  // holds the actual interpreted events if the event table is created
+  uint64_t _nSlimHits;  // total number of hits stored in the slim hit table, needed for the hit index of the events
+  bool _externalHitArray;  // true if _hitInfo is owned by the caller, it is not deleted and never overflows
+  bool _externalEventTableArrays;  // true if _eventInfo and _slimHitInfo are owned by the caller, they are not deleted and never overflow
+  bool _outputFull;  // set if an event did not fit into the caller owned output arrays, the interpretation stops after the actual word
+  unsigned int _nInterpretedWords;  // number of words interpreted by the last interpretRawData call
+  std::vector<EventInfo> _pendingEvents;  // events that did not fit into the caller owned output arrays
+  std::vector<HitInfo> _pendingHits;  // hits of the pending events, with the event infos already set
 
   // array variables for the hit events buffer
   unsigned int tHitBufferIndex;  // index for the buffer hit info array
   HitInfo* _hitBuffer;  // holds the actual interpreted hits of one event, needed to be able to set event error codes subsequently
+  unsigned int _hitBufferSize;  // size of the _hitBuffer array, allocated when the first hit is added and reused for all following events
+  unsigned int _maxHitBufferSize;  // maximum number of hits in one event, limits the growth of the _hitBuffer array
 
   // config variables
   unsigned int _NbCID;  // number of BCIDs for one trigger
@@ -154,6 +274,11 @@ private:
   bool _haveTdcTriggerDistance;  // set to true to use TDC trigger distance
   unsigned int _TriggerDataFormat;  // set trigger data format
   unsigned int _maxTriggerNumber;  // maximum trigger trigger number
+  InterpretRawDataKernel _interpretRawDataKernel;  // the interpretation kernel for the actual options
+  unsigned int _nThreads;  // number of threads for the parallel interpretation, 1 for serial interpretation
+  unsigned int _minWordsPerThread;  // minimum number of words per thread for the parallel interpretation
+  unsigned int _nParallelReruns;  // number of parallel chunks interpreted again
+  std::vector<Interpret*> _chunkInterpreters;  // interpreters of the parallel chunks, the first chunk is interpreted by this interpreter
 
   // one event variables
   unsigned int tNdataWords;  // number of data words per event
@@ -210,9 +335,24 @@ private:
   unsigned int _metaWordIndexLength;  // length of the word number array
   unsigned int _actualMetaWordIndex;  // counter for the actual meta word array index
   bool _createEmptyEventHits;  // true if empty event virtual hits are created
+  bool _createEventTable;  // true if events and slim hits are stored instead of hits with event infos
+  EventCallback _eventCallback;  // called for every event, 0 if not set
+  void* _eventCallbackData;  // user data given to the event callback
+  bool _storeEventHits;  // false if the hits are only given to the event callback or the histogram
+  Histogram* _histogram;  // filled with the hits of every event, 0 if not set
   bool _createMetaDataWordIndex;  // true if word index has to be set
   bool _isMetaTableV2;  // set to true if using MetaInfoV2 table
 
+  // word type look up table
+  unsigned char _wordTypeTable[__N_WORD_TYPE_INDICES];  // word type for each combination of word header and FE-I4 record header
+  unsigned int _simdLevel;  // instruction set level of the CPU, selects the data record pre-scan version
+
+  // diagnostics ring buffer
+  DiagnosticRecord* _diagnosticRecords;  // holds the last _diagnosticRecordsSize diagnostic records
+  unsigned int _diagnosticRecordsSize;  // size of the _diagnosticRecords array, 0 if diagnostics are deactivated
+  unsigned int _diagnosticRecordIndex;  // index of the next diagnostic record to write
+  unsigned int _nDiagnosticRecords;  // total number of diagnostic records
+
   // counter histograms
   unsigned int* _triggerStatusCounter;  // trigger error histogram
   unsigned int* _eventStatusCounter;  // error code histogram
@@ -0,0 +1,141 @@
+#include "OnlineInterpret.h"
+
+OnlineInterpret::OnlineInterpret(Interpret* pInterpret, Histogram* pHistogram)
+{
+  setSourceFileName("OnlineInterpret");
+  if (pInterpret == 0 || pHistogram == 0)
+    throw std::invalid_argument("OnlineInterpret: interpreter and histogram have to be set");
+  _interpret = pInterpret;
+  _histogram = pHistogram;
+  _running = false;
+  _queueWrite = 0;
+  _queueRead = 0;
+  _nRejectedChunks = 0;
+  _stop = 0;
+  _failed = 0;
+  _statusSequence = 0;
+  _interpret->setHistogram(_histogram, false);  // the results are the histograms and the counters, no hits are stored
+  publishStatus(0);
+}
+
+OnlineInterpret::~OnlineInterpret(void)
+{
+  debug("~OnlineInterpret()");
+  stop();
+  _interpret->setHistogram(0);
+}
+
+void OnlineInterpret::start()
+{
+  if (Basis::debugSet())
+    debug("start()");
+  if (_running)
+    return;
+  atomicStore(_stop, 0);
+  if (!_worker.start(&OnlineInterpret::runWorker, this))
+    throw std::runtime_error("OnlineInterpret: cannot start the worker thread");
+  _running = true;
+}
+
+void OnlineInterpret::stop()
+{
+  if (Basis::debugSet())
+    debug("stop()");
+  if (!_running)
+    return;
+  atomicStore(_stop, 1);
+  _worker.join();
+  _running = false;
+}
+
+void OnlineInterpret::wait()
+{
+  if (Basis::debugSet())
+    debug("wait()");
+  if (!_running && getNprocessedChunks() != getNaddedChunks())
+    throw std::runtime_error("OnlineInterpret: the worker thread is not running");
+  while (getNprocessedChunks() != getNaddedChunks())
+    sleepMilliSeconds(__ONLINE_IDLE_SLEEP);
+  if (hasError())
+    throw std::runtime_error("OnlineInterpret: " + _errorMessage);
+}
+
+bool OnlineInterpret::addRawData(unsigned int* pDataWords, const unsigned int& rNdataWords)
+{
+  unsigned int tQueueWrite = _queueWrite;  // only written by this thread
+  if (tQueueWrite - atomicLoad(_queueRead) >= __ONLINE_QUEUE_SIZE) {
+    atomicStore(_nRejectedChunks, _nRejectedChunks + 1);
+    return false;
+  }
+  _queue[tQueueWrite & (__ONLINE_QUEUE_SIZE - 1)].dataWords = pDataWords;
+  _queue[tQueueWrite & (__ONLINE_QUEUE_SIZE - 1)].nDataWords = rNdataWords;
+  atomicStore(_queueWrite, tQueueWrite + 1);  // the chunk is visible to the worker after it is written
+  return true;
+}
+
+void OnlineInterpret::getStatus(OnlineStatus& rStatus)
+{
+  for (;;) {
+    unsigned int tStatusSequence = atomicLoad(_statusSequence);
+    rStatus = _status[tStatusSequence & 1];
+    memoryFence();
+    if (atomicLoad(_statusSequence) == tStatusSequence)  // the worker did not start to overwrite the buffer while it was copied
+      return;
+  }
+}
+
+void OnlineInterpret::runWorker(void* pOnlineInterpret)
+{
+  ((OnlineInterpret*) pOnlineInterpret)->work();
+}
+
+void OnlineInterpret::work()
+{
+  for (;;) {
+    unsigned int tQueueRead = _queueRead;  // only written by this thread
+    if (tQueueRead == atomicLoad(_queueWrite)) {
+      if (atomicLoad(_stop) != 0 && tQueueRead == atomicLoad(_queueWrite))  // chunks added before stop() are still interpreted
+        return;
+      sleepMilliSeconds(__ONLINE_IDLE_SLEEP);
+      continue;
+    }
+    if (atomicLoad(_failed) == 0)
+      interpretChunk(_queue[tQueueRead & (__ONLINE_QUEUE_SIZE - 1)]);
+    publishStatus(tQueueRead + 1);
+    atomicStore(_queueRead, tQueueRead + 1);  // the chunk can be reused by the producer
+  }
+}
+
+void OnlineInterpret::interpretChunk(const RawDataChunk& rChunk)
+{
+  try {
+    _interpret->interpretRawData(rChunk.dataWords, rChunk.nDataWords);
+  }
+  catch (std::exception& e) {
+    _errorMessage = e.what();
+    atomicStore(_failed, 1);
+  }
+  catch (...) {
+    _errorMessage = "unknown exception during the interpretation";
+    atomicStore(_failed, 1);
+  }
+}
+
+void OnlineInterpret::publishStatus(const unsigned int& rNchunks)
+{
+  unsigned int tStatusSequence = _statusSequence;  // only written by this thread
+  memoryFence();  // readers of the buffer written now see the sequence change before the buffer changes
+  OnlineStatus& rStatus = _status[(tStatusSequence + 1) & 1];
+  rStatus.nChunks = rNchunks;
+  rStatus.nWords = _interpret->getNwords();
+  rStatus.nEvents = _interpret->getNevents();
+  rStatus.nHits = _interpret->getNhits();
+  rStatus.nTriggers = _interpret->getNtriggers();
+  rStatus.nEmptyEvents = _interpret->getNemptyEvents();
+  rStatus.nUnknownWords = _interpret->getNunknownWords();
+  unsigned int* tEventStatusCounter = 0;
+  unsigned int tNeventStatusCounters = 0;
+  _interpret->getEventStatusCounters(tEventStatusCounter, tNeventStatusCounters);
+  std::copy(tEventStatusCounter, tEventStatusCounter + tNeventStatusCounters, rStatus.eventStatusCounter);
+  atomicStore(_statusSequence, tStatusSequence + 1);
+}
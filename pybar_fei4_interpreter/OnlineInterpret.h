@@ -0,0 +1,76 @@
+#pragma once
+// online interpretation engine: the DAQ thread only puts raw data chunks into a lock-free single producer/single consumer queue,
+// a worker thread interprets them with an Interpret instance that fills its Histogram directly; the counters are handed over
+// in double buffers, thus the monitor can poll them at any time without stalling the worker
+
+#include "Basis.h"
+#include "defines.h"
+#include "Threads.h"
+#include "Interpret.h"
+#include "Histogram.h"
+
+struct OnlineStatus  // counters of the online interpretation, copied after every interpreted chunk
+{
+  unsigned int nChunks;  // number of interpreted raw data chunks
+  unsigned int nWords;  // number of interpreted raw data words
+  uint64_t nEvents;
+  unsigned int nHits;
+  unsigned int nTriggers;
+  unsigned int nEmptyEvents;
+  unsigned int nUnknownWords;
+  unsigned int eventStatusCounter[__N_EVENT_STATUS_BITS];
+};
+
+class OnlineInterpret: public Basis
+{
+public:
+  OnlineInterpret(Interpret* pInterpret, Histogram* pHistogram);  // the interpreter and the histogram are not owned and must not be used by other threads while the worker runs
+  ~OnlineInterpret(void);
+
+  // control functions, called by the owner thread
+  void start();  // starts the worker thread
+  void stop();  // interprets the chunks in the queue and stops the worker thread
+  void wait();  // blocks until all chunks in the queue are interpreted, throws if the interpretation of a chunk failed
+  bool isRunning() {return _running;};
+
+  // producer function, called by the DAQ thread only
+  bool addRawData(unsigned int* pDataWords, const unsigned int& rNdataWords);  // puts the raw data chunk into the queue without copying it and returns immediately, returns false if the queue is full; the words have to be valid until the chunk is interpreted
+
+  // monitor functions, can be called by any thread at any time
+  void getStatus(OnlineStatus& rStatus);  // copies the counters after the last interpreted chunk
+  unsigned int getNaddedChunks() {return atomicLoad(_queueWrite);};  // number of chunks put into the queue
+  unsigned int getNprocessedChunks() {return atomicLoad(_queueRead);};  // number of chunks interpreted, their raw data is not used anymore
+  unsigned int getNrejectedChunks() {return atomicLoad(_nRejectedChunks);};  // number of chunks not added because the queue was full
+  bool hasError() {return atomicLoad(_failed) != 0;};  // true if the interpretation of a chunk failed, the following chunks are not interpreted
+
+private:
+  struct RawDataChunk
+  {
+    unsigned int* dataWords;
+    unsigned int nDataWords;
+  };
+
+  static void runWorker(void* pOnlineInterpret);
+  void work();  // the worker loop, interprets the queued chunks until stop() is called and the queue is empty
+  void interpretChunk(const RawDataChunk& rChunk);
+  void publishStatus(const unsigned int& rNchunks);  // copies the interpreter counters into the status buffer not read by the monitor and exchanges the buffers
+
+  Interpret* _interpret;
+  Histogram* _histogram;
+  Thread _worker;
+  bool _running;
+
+  // lock-free single producer/single consumer queue, the positions only increase and are written by one thread each
+  RawDataChunk _queue[__ONLINE_QUEUE_SIZE];
+  volatile unsigned int _queueWrite;  // number of chunks added, written by the producer only
+  volatile unsigned int _queueRead;  // number of chunks interpreted, written by the worker only
+  volatile unsigned int _nRejectedChunks;  // written by the producer only
+  volatile unsigned int _stop;  // set by stop(), the worker finishes after the queue is empty
+  volatile unsigned int _failed;
+  std::string _errorMessage;  // written by the worker before _failed is set
+
+  // double buffered counters, the worker writes the buffer _statusSequence+1 and increments _statusSequence afterwards;
+  // a reader copy of the buffer _statusSequence is consistent if _statusSequence did not change while copying
+  OnlineStatus _status[2];
+  volatile unsigned int _statusSequence;
+};
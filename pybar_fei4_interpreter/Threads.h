@@ -0,0 +1,188 @@
+#pragma once
+// minimal portable threads for the parallel interpretation and histogramming, std::thread is not available
+// for all compilers the extensions are built with (e.g. MSVC 2008 for Python 2.7)
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX  // windows.h must not define min/max macros
+#endif
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+// returns the number of logical cores
+inline unsigned int getNumberOfCores()
+{
+#ifdef _WIN32
+  SYSTEM_INFO tSystemInfo;
+  GetSystemInfo(&tSystemInfo);
+  return tSystemInfo.dwNumberOfProcessors > 0 ? (unsigned int) tSystemInfo.dwNumberOfProcessors : 1;
+#else
+  long tNcores = sysconf(_SC_NPROCESSORS_ONLN);
+  return tNcores > 0 ? (unsigned int) tNcores : 1;
+#endif
+}
+
+// lock-free access to values shared between threads: a load sees all writes the other thread did before the store of the value
+inline unsigned int atomicLoad(const volatile unsigned int& rValue)
+{
+#ifdef _WIN32
+  unsigned int tValue = rValue;
+  MemoryBarrier();
+  return tValue;
+#else
+  return __atomic_load_n(&rValue, __ATOMIC_ACQUIRE);
+#endif
+}
+
+inline void atomicStore(volatile unsigned int& rValue, const unsigned int& rNewValue)
+{
+#ifdef _WIN32
+  MemoryBarrier();
+  rValue = rNewValue;
+#else
+  __atomic_store_n(&rValue, rNewValue, __ATOMIC_RELEASE);
+#endif
+}
+
+inline bool atomicCompareExchange(volatile unsigned int& rValue, const unsigned int& rExpectedValue, const unsigned int& rNewValue)  // sets the value to rNewValue if it is rExpectedValue, returns true if it was set
+{
+#ifdef _WIN32
+  return (unsigned int) InterlockedCompareExchange((volatile LONG*) &rValue, (LONG) rNewValue, (LONG) rExpectedValue) == rExpectedValue;
+#else
+  return __sync_bool_compare_and_swap(&rValue, rExpectedValue, rNewValue);
+#endif
+}
+
+inline void memoryFence()  // full memory barrier, orders all loads and stores before the fence with all loads and stores after it
+{
+#ifdef _WIN32
+  MemoryBarrier();
+#else
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+#endif
+}
+
+#ifdef _WIN32
+typedef DWORD ThreadId;
+#else
+typedef pthread_t ThreadId;
+#endif
+
+inline ThreadId getCurrentThreadId()
+{
+#ifdef _WIN32
+  return GetCurrentThreadId();
+#else
+  return pthread_self();
+#endif
+}
+
+inline bool isCurrentThread(const ThreadId& rThreadId)
+{
+#ifdef _WIN32
+  return rThreadId == GetCurrentThreadId();
+#else
+  return pthread_equal(rThreadId, pthread_self()) != 0;
+#endif
+}
+
+inline void sleepMilliSeconds(const unsigned int& rMilliSeconds)
+{
+#ifdef _WIN32
+  Sleep(rMilliSeconds);
+#else
+  usleep(rMilliSeconds * 1000);
+#endif
+}
+
+class Thread
+{
+public:
+  Thread(): _started(false), _function(0), _argument(0) {}
+  ~Thread() {join();}
+
+  bool start(void (*pFunction)(void*), void* pArgument)  // runs pFunction(pArgument) in a new thread, returns false if the thread cannot be created
+  {
+    join();
+    _function = pFunction;
+    _argument = pArgument;
+#ifdef _WIN32
+    _handle = CreateThread(0, 0, &Thread::run, this, 0, 0);
+    _started = _handle != 0;
+#else
+    _started = pthread_create(&_handle, 0, &Thread::run, this) == 0;
+#endif
+    return _started;
+  }
+
+  void join()  // waits until the thread is finished
+  {
+    if (!_started)
+      return;
+#ifdef _WIN32
+    WaitForSingleObject(_handle, INFINITE);
+    CloseHandle(_handle);
+#else
+    pthread_join(_handle, 0);
+#endif
+    _started = false;
+  }
+
+private:
+  Thread(const Thread&);  // not copyable
+  Thread& operator=(const Thread&);
+
+#ifdef _WIN32
+  static DWORD WINAPI run(LPVOID pThread)
+  {
+    Thread* tThread = (Thread*) pThread;
+    tThread->_function(tThread->_argument);
+    return 0;
+  }
+  HANDLE _handle;
+#else
+  static void* run(void* pThread)
+  {
+    Thread* tThread = (Thread*) pThread;
+    tThread->_function(tThread->_argument);
+    return 0;
+  }
+  pthread_t _handle;
+#endif
+  bool _started;
+  void (*_function)(void*);
+  void* _argument;
+};
+
+// calls pFunction(rTasks[i]) for all tasks in parallel, the first task is done by the calling thread;
+// pFunction must not throw, tasks whose thread cannot be created are done by the calling thread
+template <typename T> struct ParallelTask
+{
+  void (*function)(T&);
+  T* task;
+  static void run(void* pParallelTask)
+  {
+    ParallelTask* tParallelTask = (ParallelTask*) pParallelTask;
+    tParallelTask->function(*tParallelTask->task);
+  }
+};
+
+template <typename T> void runParallel(void (*pFunction)(T&), std::vector<T>& rTasks)
+{
+  if (rTasks.empty())
+    return;
+  std::vector<ParallelTask<T> > tParallelTasks(rTasks.size());
+  Thread* tThreads = new Thread[rTasks.size()];  // threads are not copyable, no std::vector
+  for (size_t i = 1; i < rTasks.size(); ++i) {
+    tParallelTasks[i].function = pFunction;
+    tParallelTasks[i].task = &rTasks[i];
+    if (!tThreads[i].start(&ParallelTask<T>::run, &tParallelTasks[i]))
+      pFunction(rTasks[i]);
+  }
+  pFunction(rTasks[0]);
+  delete[] tThreads;  // joins the threads
+}
@@ -7,6 +7,7 @@ import numpy as np
 cimport numpy as cnp
 from numpy cimport ndarray
 from libc.stdint cimport uint8_t, uint16_t, uint32_t, uint64_t, int64_t
+from libcpp.string cimport string
 
 from data_struct cimport numpy_cluster_info
 from pybar_fei4_interpreter.data_struct cimport numpy_hit_info, numpy_meta_data, numpy_meta_data_v2, numpy_meta_word_data
@@ -14,39 +15,101 @@ from pybar_fei4_interpreter.data_struct import MetaTable, MetaTableV2
 
 cnp.import_array()  # if array is used it has to be imported, otherwise possible runtime error
 
+cdef extern from "CpuDispatch.h":
+    unsigned int getSimdLevel()
+    string getSimdLevelName(const unsigned int& rLevel)
+
+getSimdLevel()  # select the kernel versions from cpuid at import time
+
 cdef extern from "AnalysisFunctions.h":
     cdef cppclass ClusterInfo:
         ClusterInfo()
-    unsigned int getNclusterInEvents(int64_t*& rEventNumber, const unsigned int& rSize, int64_t*& rResultEventNumber, unsigned int*& rResultCount)
-    unsigned int getEventsInBothArrays(int64_t*& rEventArrayOne, const unsigned int& rSizeArrayOne, int64_t*& rEventArrayTwo, const unsigned int& rSizeArrayTwo, int64_t*& rEventArrayIntersection)
-    unsigned int getMaxEventsInBothArrays(int64_t*& rEventArrayOne, const unsigned int& rSizeArrayOne, int64_t*& rEventArrayTwo, const unsigned int& rSizeArrayTwo, int64_t*& rEventArrayIntersection, const unsigned int& rSizeArrayResult) except +  # exception raised by C++ code handled by Python
-    void in1d_sorted(int64_t*& rEventArrayOne, const unsigned int& rSizeArrayOne, int64_t*& rEventArrayTwo, const unsigned int& rSizeArrayTwo, uint8_t*& rSelection)
-    void histogram_1d(const unsigned int*& x, const unsigned int& rSize, const unsigned int& rNbinsX, uint32_t*& rResult) except +  # exception raised by C++ code handled by Python
-    void histogram_2d(const unsigned int*& x, const unsigned int*& y, const unsigned int& rSize, const unsigned int& rNbinsX, const unsigned int& rNbinsY, uint32_t*& rResult) except +  # exception raised by C++ code handled by Python
-    void histogram_3d(const unsigned int*& x, const unsigned int*& y, const unsigned int*& z, const unsigned int& rSize, const unsigned int& rNbinsX, const unsigned int& rNbinsY, const unsigned int& rNbinsZ, uint32_t*& rResult) except +  # exception raised by C++ code handled by Python
-    void mapCluster(int64_t*& rEventArray, const unsigned int& rEventArraySize, ClusterInfo*& rClusterInfo, const unsigned int& rClusterInfoSize, ClusterInfo*& rMappedClusterInfo, const unsigned int& rMappedClusterInfoSize) except +  # exception raised by C++ code handled by Python
+    unsigned int getNclusterInEvents(int64_t*& rEventNumber, const unsigned int& rSize, int64_t*& rResultEventNumber, unsigned int*& rResultCount) nogil
+    unsigned int getEventsInBothArrays(int64_t*& rEventArrayOne, const unsigned int& rSizeArrayOne, int64_t*& rEventArrayTwo, const unsigned int& rSizeArrayTwo, int64_t*& rEventArrayIntersection) nogil
+    unsigned int getMaxEventsInBothArrays(int64_t*& rEventArrayOne, const unsigned int& rSizeArrayOne, int64_t*& rEventArrayTwo, const unsigned int& rSizeArrayTwo, int64_t*& rEventArrayIntersection, const unsigned int& rSizeArrayResult) except + nogil  # exception raised by C++ code handled by Python
+    void in1d_sorted(int64_t*& rEventArrayOne, const unsigned int& rSizeArrayOne, int64_t*& rEventArrayTwo, const unsigned int& rSizeArrayTwo, uint8_t*& rSelection) nogil
+    void histogram_1d(const unsigned int*& x, const unsigned int& rSize, const unsigned int& rNbinsX, uint32_t*& rResult) except + nogil  # exception raised by C++ code handled by Python
+    void histogram_2d(const unsigned int*& x, const unsigned int*& y, const unsigned int& rSize, const unsigned int& rNbinsX, const unsigned int& rNbinsY, uint32_t*& rResult) except + nogil  # exception raised by C++ code handled by Python
+    void histogram_3d(const unsigned int*& x, const unsigned int*& y, const unsigned int*& z, const unsigned int& rSize, const unsigned int& rNbinsX, const unsigned int& rNbinsY, const unsigned int& rNbinsZ, uint32_t*& rResult) except + nogil  # exception raised by C++ code handled by Python
+    void mapCluster(int64_t*& rEventArray, const unsigned int& rEventArraySize, ClusterInfo*& rClusterInfo, const unsigned int& rClusterInfoSize, ClusterInfo*& rMappedClusterInfo, const unsigned int& rMappedClusterInfoSize) except + nogil  # exception raised by C++ code handled by Python
+
+def get_simd_version():  # instruction set of the active histogramming kernels, can be restricted with the environment variable PYBAR_FEI4_INTERPRETER_SIMD (baseline, sse2)
+    return getSimdLevelName(getSimdLevel()).decode()
 
+# the functions release the GIL while they run, the pointers and sizes are taken from the arrays before
 def get_n_cluster_in_events(cnp.ndarray[cnp.int64_t, ndim=1] event_numbers, cnp.ndarray[cnp.int64_t, ndim=1] result_event_numbers, cnp.ndarray[cnp.uint32_t, ndim=1] result_cluster_count):
-    return getNclusterInEvents(<int64_t*&> event_numbers.data, <const unsigned int&> event_numbers.shape[0], <int64_t*&> result_event_numbers.data, <unsigned int*&> result_cluster_count.data)
+    cdef int64_t* event_numbers_data = <int64_t*> event_numbers.data
+    cdef unsigned int size = <unsigned int> event_numbers.shape[0]
+    cdef int64_t* result_event_numbers_data = <int64_t*> result_event_numbers.data
+    cdef unsigned int* result_cluster_count_data = <unsigned int*> result_cluster_count.data
+    cdef unsigned int n_events
+    with nogil:
+        n_events = getNclusterInEvents(event_numbers_data, size, result_event_numbers_data, result_cluster_count_data)
+    return n_events
 
 def get_events_in_both_arrays(cnp.ndarray[cnp.int64_t, ndim=1] array_one, cnp.ndarray[cnp.int64_t, ndim=1] array_two, cnp.ndarray[cnp.int64_t, ndim=1] array_result):
-    return getEventsInBothArrays(<int64_t*&> array_one.data, <const unsigned int&> array_one.shape[0], <int64_t*&> array_two.data, <const unsigned int&> array_two.shape[0], <int64_t*&> array_result.data)
+    cdef int64_t* array_one_data = <int64_t*> array_one.data
+    cdef int64_t* array_two_data = <int64_t*> array_two.data
+    cdef int64_t* array_result_data = <int64_t*> array_result.data
+    cdef unsigned int size_one = <unsigned int> array_one.shape[0]
+    cdef unsigned int size_two = <unsigned int> array_two.shape[0]
+    cdef unsigned int n_events
+    with nogil:
+        n_events = getEventsInBothArrays(array_one_data, size_one, array_two_data, size_two, array_result_data)
+    return n_events
 
 def get_max_events_in_both_arrays(cnp.ndarray[cnp.int64_t, ndim=1] array_one, cnp.ndarray[cnp.int64_t, ndim=1] array_two, cnp.ndarray[cnp.int64_t, ndim=1] array_result):
-    return getMaxEventsInBothArrays(<int64_t*&> array_one.data, <const unsigned int&> array_one.shape[0], <int64_t*&> array_two.data, <const unsigned int&> array_two.shape[0], <int64_t*&> array_result.data, <const unsigned int&> array_result.shape[0])
+    cdef int64_t* array_one_data = <int64_t*> array_one.data
+    cdef int64_t* array_two_data = <int64_t*> array_two.data
+    cdef int64_t* array_result_data = <int64_t*> array_result.data
+    cdef unsigned int size_one = <unsigned int> array_one.shape[0]
+    cdef unsigned int size_two = <unsigned int> array_two.shape[0]
+    cdef unsigned int size_result = <unsigned int> array_result.shape[0]
+    cdef unsigned int n_events
+    with nogil:
+        n_events = getMaxEventsInBothArrays(array_one_data, size_one, array_two_data, size_two, array_result_data, size_result)
+    return n_events
 
 def get_in1d_sorted(cnp.ndarray[cnp.int64_t, ndim=1] array_one, cnp.ndarray[cnp.int64_t, ndim=1] array_two, cnp.ndarray[cnp.uint8_t, ndim=1] array_result):
-    in1d_sorted(<int64_t*&> array_one.data, <const unsigned int&> array_one.shape[0], <int64_t*&> array_two.data, <const unsigned int&> array_two.shape[0], <uint8_t*&> array_result.data)
+    cdef int64_t* array_one_data = <int64_t*> array_one.data
+    cdef int64_t* array_two_data = <int64_t*> array_two.data
+    cdef uint8_t* array_result_data = <uint8_t*> array_result.data
+    cdef unsigned int size_one = <unsigned int> array_one.shape[0]
+    cdef unsigned int size_two = <unsigned int> array_two.shape[0]
+    with nogil:
+        in1d_sorted(array_one_data, size_one, array_two_data, size_two, array_result_data)
     return (array_result == 1)
 
 def hist_1d(cnp.ndarray[cnp.int32_t, ndim=1] x, const unsigned int& n_x, cnp.ndarray[cnp.uint32_t, ndim=1] array_result):
-    histogram_1d(<const unsigned int*&> x.data, <const unsigned int&> x.shape[0], <const unsigned int&> n_x, <uint32_t*&> array_result.data)
+    cdef const unsigned int* x_data = <const unsigned int*> x.data
+    cdef unsigned int size = <unsigned int> x.shape[0]
+    cdef uint32_t* array_result_data = <uint32_t*> array_result.data
+    with nogil:
+        histogram_1d(x_data, size, n_x, array_result_data)
 
 def hist_2d(cnp.ndarray[cnp.int32_t, ndim=1] x, cnp.ndarray[cnp.int32_t, ndim=1] y, const unsigned int& n_x, const unsigned int& n_y, cnp.ndarray[cnp.uint32_t, ndim=1] array_result):
-    histogram_2d(<const unsigned int*&> x.data, <const unsigned int*&> y.data, <const unsigned int&> x.shape[0], <const unsigned int&> n_x, <const unsigned int&> n_y, <uint32_t*&> array_result.data)
+    cdef const unsigned int* x_data = <const unsigned int*> x.data
+    cdef const unsigned int* y_data = <const unsigned int*> y.data
+    cdef unsigned int size = <unsigned int> x.shape[0]
+    cdef uint32_t* array_result_data = <uint32_t*> array_result.data
+    with nogil:
+        histogram_2d(x_data, y_data, size, n_x, n_y, array_result_data)
 
 def hist_3d(cnp.ndarray[cnp.int32_t, ndim=1] x, cnp.ndarray[cnp.int32_t, ndim=1] y, cnp.ndarray[cnp.int32_t, ndim=1] z, const unsigned int& n_x, const unsigned int& n_y, const unsigned int& n_z, cnp.ndarray[cnp.uint32_t, ndim=1] array_result, throw_exception = True):
-    histogram_3d(<const unsigned int*&> x.data, <const unsigned int*&> y.data, <const unsigned int*&> z.data, <const unsigned int&> x.shape[0], <const unsigned int&> n_x, <const unsigned int&> n_y, <const unsigned int&> n_z, <uint32_t*&> array_result.data)
+    cdef const unsigned int* x_data = <const unsigned int*> x.data
+    cdef const unsigned int* y_data = <const unsigned int*> y.data
+    cdef const unsigned int* z_data = <const unsigned int*> z.data
+    cdef unsigned int size = <unsigned int> x.shape[0]
+    cdef uint32_t* array_result_data = <uint32_t*> array_result.data
+    with nogil:
+        histogram_3d(x_data, y_data, z_data, size, n_x, n_y, n_z, array_result_data)
 
 def map_cluster(cnp.ndarray[cnp.int64_t, ndim=1] event_array, cnp.ndarray[numpy_cluster_info, ndim=1] cluster_hit_info, cnp.ndarray[numpy_cluster_info, ndim=1] mapped_cluster_hit_info):
-    mapCluster(<int64_t*&> event_array.data, <const unsigned int&> event_array.shape[0], <ClusterInfo *&> cluster_hit_info.data, <const unsigned int &> cluster_hit_info.shape[0], <ClusterInfo *&> mapped_cluster_hit_info.data, <const unsigned int &> mapped_cluster_hit_info.shape[0])
+    cdef int64_t* event_array_data = <int64_t*> event_array.data
+    cdef ClusterInfo* cluster_hit_info_data = <ClusterInfo*> cluster_hit_info.data
+    cdef ClusterInfo* mapped_cluster_hit_info_data = <ClusterInfo*> mapped_cluster_hit_info.data
+    cdef unsigned int event_array_size = <unsigned int> event_array.shape[0]
+    cdef unsigned int cluster_hit_info_size = <unsigned int> cluster_hit_info.shape[0]
+    cdef unsigned int mapped_cluster_hit_info_size = <unsigned int> mapped_cluster_hit_info.shape[0]
+    with nogil:
+        mapCluster(event_array_data, event_array_size, cluster_hit_info_data, cluster_hit_info_size, mapped_cluster_hit_info_data, mapped_cluster_hit_info_size)
@@ -0,0 +1,94 @@
+# declarations of the histogram class, also used by the interpreter to fill the histograms directly
+from libcpp cimport bool as cpp_bool
+from libc.stdint cimport uint64_t, int64_t
+from libcpp.string cimport string
+
+cdef extern from "Basis.h":
+    cdef cppclass Basis:
+        Basis()
+
+cdef extern from "Histogram.h":
+    cdef cppclass HitInfo:
+        HitInfo()
+    cdef cppclass ParInfo:
+        ParInfo()
+    cdef cppclass ClusterInfo:
+        ClusterInfo()
+    cdef cppclass MetaInfoV2:
+        MetaInfoV2()
+    cdef cppclass Histogram(Basis):
+        Histogram() except +  # exception raised by C++ code handled by Python
+        void setErrorOutput(cpp_bool pToggle)
+        void setWarningOutput(cpp_bool pToggle)
+        void setInfoOutput(cpp_bool pToggle)
+        void setDebugOutput(cpp_bool pToggle)
+
+        void createOccupancyHist(cpp_bool CreateOccHist)
+        void createRelBCIDHist(cpp_bool CreateRelBCIDHist)
+        void createMeanTotHist(cpp_bool CreateMeanTotHist)
+        void createTotHist(cpp_bool CreateTotHist)
+        void createTdcValueHist(cpp_bool CreateTdcValueHist)
+        void createTdcTriggerDistanceHist(cpp_bool CreateTdcTriggerDistanceHist)
+        void createTdcPixelHist(cpp_bool CreateTdcPixelHist)
+        void createTotPixelHist(cpp_bool CreateTotPixelHist)
+        void setMaxTot(const unsigned int& rMaxTot)
+        void setTdcPixelHistRange(const unsigned int& rMinTdc, const unsigned int& rMaxTdc, const unsigned int& rTdcBinWidth) except +
+        unsigned int getNtdcPixelHistBins()
+        void setSparseReset(cpp_bool rSparseReset)
+        cpp_bool getSparseReset()
+        void setNthreads(const unsigned int& rNthreads, const unsigned int& rMinHitsPerThread)
+        unsigned int getNthreads()
+
+        void getOccupancy(unsigned int& rNparameterValues, unsigned int*& rOccupancy, cpp_bool copy)  # returns the occupancy histogram for all hits
+        void getTotHist(unsigned int*& rTotHist, cpp_bool copy)  # returns the tot histogram for all hits
+        void getMeanTot(unsigned int& rNparameterValues, float*& rOccupancy, cpp_bool copy)
+        void getRmsTot(unsigned int& rNparameterValues, float*& rRmsTot, cpp_bool copy)
+        void getTdcValuesHist(unsigned int*& rTdcValueHist, cpp_bool copy)
+        void getTdcTriggerDistancesHist(unsigned int*& rTdcTriggerDistanceHist, cpp_bool copy)
+        void getRelBcidHist(unsigned int*& rRelBcidHist, cpp_bool copy)  # returns the relative BCID histogram for all hits
+        void getTdcPixelHist(unsigned short*& rTdcPixelHist, cpp_bool copy)  # returns the tdc pixel histogram for all hits
+        unsigned int getNtdcPixelHistEntries()
+        void getTdcPixelHistEntries(unsigned short* pColumnIndex, unsigned short* pRowIndex, unsigned short* pTdcBin, unsigned int* pCount)  # returns the filled bins of the tdc pixel histogram
+        void getTotPixelHist(unsigned short*& rTotPixelHist, cpp_bool copy)  # returns the tot pixel histogram for all hits
+
+        void takeSnapshot() nogil  # copies the histograms consistently while another thread fills them
+        void getSnapshotOccupancy(unsigned int& rNparameterValues, unsigned int*& rOccupancy)
+        void getSnapshotTotHist(unsigned int*& rTotHist)
+        void getSnapshotTdcValuesHist(unsigned int*& rTdcValueHist)
+        void getSnapshotTdcTriggerDistancesHist(unsigned int*& rTdcTriggerDistanceHist)
+        void getSnapshotRelBcidHist(unsigned int*& rRelBcidHist)
+        void getSnapshotMeanTot(unsigned int& rNparameterValues, float*& rMeanTot)
+        void getSnapshotRmsTot(unsigned int& rNparameterValues, float*& rRmsTot)
+        void getSnapshotTotPixelHist(unsigned short*& rTotPixelHist)
+        void getSnapshotTdcPixelHist(unsigned int& rNtdcBins, unsigned short*& rTdcPixelHist)
+
+        void addHits(HitInfo*& rHitInfo, const unsigned int& rNhits) except + nogil  # exception raised by C++ code handled by Python
+        void addClusterSeedHits(ClusterInfo*& rClusterInfo, const unsigned int& rNcluster) except + nogil  # exception raised by C++ code handled by Python
+        void addScanParameter(int*& rParInfo, const unsigned int& rNparInfoLength) except +  # exception raised by C++ code handled by Python
+        void setNoScanParameter()
+        void addMetaEventIndex(uint64_t*& rMetaEventIndex, const unsigned int& rNmetaEventIndexLength) except +  # exception raised by C++ code handled by Python
+
+        unsigned int getMinParameter()  # returns the minimum parameter from _parInfo
+        unsigned int getMaxParameter()  # returns the maximum parameter from _parInfo
+        unsigned int getNparameters()  # returns the parameter range from _parInfo
+        string getSimdVersion()  # returns the instruction set of the addHits version in use
+
+        void calculateThresholdScanArrays(double rMuArray[], double rSigmaArray[], const unsigned int& rMaxInjections, const unsigned int& min_parameter, const unsigned int& max_parameter, const cpp_bool& rFitSCurves) except + nogil  # takes the occupancy histograms for different parameters for the threshold arrays
+        void setThresholdScanSteps(const unsigned int& rNsteps) except +  # accumulates the occupancy of the completed scan steps
+        unsigned int getThresholdScanSteps()
+        void calculateThresholdScanEstimates(double rMuArray[], double rSigmaArray[], const unsigned int& rMaxInjections, const unsigned int& min_parameter, const unsigned int& max_parameter) except +  # threshold arrays from the completed scan steps
+
+        void reset() except +  # exception raised by C++ code handled by Python
+        void merge(const Histogram& rHistogram) except +  # adds the histograms of rHistogram
+        string serialize()  # compact binary copy of the settings and histograms
+        void deserialize(const string& rData) except +  # exception raised by C++ code handled by Python
+
+        void setTimeSlices(const unsigned int& rNslices, const double& rSliceLength) except +
+        void setMetaTimeStamps(MetaInfoV2*& rMetaInfo, const unsigned int& rNmetaInfoLength)
+        unsigned int getNtimeSlices()
+        void getTimeSlices(int64_t* pSliceIndex, double* pStartTimeStamp, unsigned int* pNhits)  # the slices in the history, oldest first
+        void getTimeSliceOccupancy(const unsigned int& rFirstSlice, const unsigned int& rLastSlice, unsigned int* pOccupancy, uint64_t* pTotSum) except +  # sums a range of history slices
+
+
+cdef class PyDataHistograming:
+    cdef Histogram* thisptr  # hold a C++ instance which we're wrapping
@@ -7,61 +7,11 @@ import numpy as np
 cimport numpy as cnp
 from libcpp cimport bool as cpp_bool  # to be able to use bool variables, as cpp_bool according to http://code.google.com/p/cefpython/source/browse/cefpython/cefpython.pyx?spec=svne037c69837fa39ae220806c2faa1bbb6ae4500b9&r=e037c69837fa39ae220806c2faa1bbb6ae4500b9
 from data_struct cimport numpy_hit_info, numpy_meta_data, numpy_meta_data_v2, numpy_par_info, numpy_cluster_info
-from libc.stdint cimport uint64_t
+from libc.stdint cimport uint64_t, int64_t
+from libcpp.string cimport string
 
 cnp.import_array()  # if array is used it has to be imported, otherwise possible runtime error
 
-cdef extern from "Basis.h":
-    cdef cppclass Basis:
-        Basis()
-
-cdef extern from "Histogram.h":
-    cdef cppclass HitInfo:
-        HitInfo()
-    cdef cppclass ParInfo:
-        ParInfo()
-    cdef cppclass ClusterInfo:
-        ClusterInfo()
-    cdef cppclass Histogram(Basis):
-        Histogram() except +  # exception raised by C++ code handled by Python
-        void setErrorOutput(cpp_bool pToggle)
-        void setWarningOutput(cpp_bool pToggle)
-        void setInfoOutput(cpp_bool pToggle)
-        void setDebugOutput(cpp_bool pToggle)
-
-        void createOccupancyHist(cpp_bool CreateOccHist)
-        void createRelBCIDHist(cpp_bool CreateRelBCIDHist)
-        void createMeanTotHist(cpp_bool CreateMeanTotHist)
-        void createTotHist(cpp_bool CreateTotHist)
-        void createTdcValueHist(cpp_bool CreateTdcValueHist)
-        void createTdcTriggerDistanceHist(cpp_bool CreateTdcTriggerDistanceHist)
-        void createTdcPixelHist(cpp_bool CreateTdcPixelHist)
-        void createTotPixelHist(cpp_bool CreateTotPixelHist)
-        void setMaxTot(const unsigned int& rMaxTot)
-
-        void getOccupancy(unsigned int& rNparameterValues, unsigned int*& rOccupancy, cpp_bool copy)  # returns the occupancy histogram for all hits
-        void getTotHist(unsigned int*& rTotHist, cpp_bool copy)  # returns the tot histogram for all hits
-        void getMeanTot(unsigned int& rNparameterValues, float*& rOccupancy, cpp_bool copy)
-        void getTdcValuesHist(unsigned int*& rTdcValueHist, cpp_bool copy)
-        void getTdcTriggerDistancesHist(unsigned int*& rTdcTriggerDistanceHist, cpp_bool copy)
-        void getRelBcidHist(unsigned int*& rRelBcidHist, cpp_bool copy)  # returns the relative BCID histogram for all hits
-        void getTdcPixelHist(unsigned short*& rTdcPixelHist, cpp_bool copy)  # returns the tdc pixel histogram for all hits
-        void getTotPixelHist(unsigned short*& rTotPixelHist, cpp_bool copy)  # returns the tot pixel histogram for all hits
-
-        void addHits(HitInfo*& rHitInfo, const unsigned int& rNhits) except +  # exception raised by C++ code handled by Python
-        void addClusterSeedHits(ClusterInfo*& rClusterInfo, const unsigned int& rNcluster) except +  # exception raised by C++ code handled by Python
-        void addScanParameter(int*& rParInfo, const unsigned int& rNparInfoLength) except +  # exception raised by C++ code handled by Python
-        void setNoScanParameter()
-        void addMetaEventIndex(uint64_t*& rMetaEventIndex, const unsigned int& rNmetaEventIndexLength) except +  # exception raised by C++ code handled by Python
-
-        unsigned int getMinParameter()  # returns the minimum parameter from _parInfo
-        unsigned int getMaxParameter()  # returns the maximum parameter from _parInfo
-        unsigned int getNparameters()  # returns the parameter range from _parInfo
-
-        void calculateThresholdScanArrays(double rMuArray[], double rSigmaArray[], const unsigned int& rMaxInjections, const unsigned int& min_parameter, const unsigned int& max_parameter)  # takes the occupancy histograms for different parameters for the threshold arrays
-
-        void reset() except +  # exception raised by C++ code handled by Python
-
 cdef data_to_numpy_array_uint16(cnp.uint16_t* ptr, cnp.npy_intp N):
     cdef cnp.ndarray[cnp.uint16_t, ndim=1] arr = cnp.PyArray_SimpleNewFromData(1, <cnp.npy_intp*> &N, cnp.NPY_UINT16, <cnp.uint16_t*> ptr)
     #PyArray_ENABLEFLAGS(arr, np.NPY_OWNDATA)
@@ -77,13 +27,8 @@ cdef data_to_numpy_array_float(cnp.float32_t* ptr, cnp.npy_intp N):
     #PyArray_ENABLEFLAGS(arr, np.NPY_OWNDATA)
     return arr
 
-cdef cnp.uint16_t* data_16
-cdef cnp.uint32_t* data_32
-cdef cnp.float32_t* data_float
-cdef unsigned int Nparameter = 0
-
-cdef class PyDataHistograming:
-    cdef Histogram* thisptr  # hold a C++ instance which we're wrapping
+# a histogram instance must not be used by several threads at the same time, different instances can histogram in parallel
+cdef class PyDataHistograming:  # the wrapped C++ instance thisptr is declared in data_histograming.pxd
     def __cinit__(self):
         self.thisptr = new Histogram()
     def __dealloc__(self):
@@ -114,46 +59,119 @@ cdef class PyDataHistograming:
         self.thisptr.createTotPixelHist(<cpp_bool> toggle)
     def set_max_tot(self, max_tot):
         self.thisptr.setMaxTot(<const unsigned int&> max_tot)
-    def get_occupancy(self):
-        self.thisptr.getOccupancy(Nparameter, <unsigned int*&> data_32, <cpp_bool> False)
+    def set_tdc_pixel_hist_range(self, min_tdc, max_tdc, tdc_bin_width=1):  # the tdc pixel histogram has bins of tdc_bin_width TDC values from min_tdc to max_tdc (exclusive), resets the tdc pixel histogram
+        self.thisptr.setTdcPixelHistRange(<const unsigned int&> min_tdc, <const unsigned int&> max_tdc, <const unsigned int&> tdc_bin_width)
+    def set_sparse_reset(self, toggle):  # the resets only clear the pixel histogram blocks filled since the last reset, for few hit pixels and frequent resets
+        self.thisptr.setSparseReset(<cpp_bool> toggle)
+    def get_sparse_reset(self):
+        return <cpp_bool> self.thisptr.getSparseReset()
+    def set_n_threads(self, n_threads, min_hits_per_thread=1048576):  # hit arrays with at least min_hits_per_thread hits per thread are histogrammed in parallel, 0 uses all cores
+        self.thisptr.setNthreads(<const unsigned int&> n_threads, <const unsigned int&> min_hits_per_thread)
+    def get_n_threads(self):
+        return <unsigned int> self.thisptr.getNthreads()
+    def take_snapshot(self):  # copies the histograms while another thread fills them, the snapshot is consistent and read with snapshot=True until the next take_snapshot call
+        with nogil:
+            self.thisptr.takeSnapshot()
+    def get_occupancy(self, snapshot=False):
+        cdef cnp.uint32_t* data_32 = NULL
+        cdef unsigned int Nparameter = 0
+        if snapshot:
+            self.thisptr.getSnapshotOccupancy(Nparameter, <unsigned int*&> data_32)
+        else:
+            self.thisptr.getOccupancy(Nparameter, <unsigned int*&> data_32, <cpp_bool> False)
         if data_32 != NULL:
             array = data_to_numpy_array_uint32(data_32, 80 * 336 * Nparameter)
             return array.reshape((80, 336, Nparameter), order='F')  # make linear array to 3d array (col,row,parameter)
-    def get_tot_hist(self):
-        self.thisptr.getTotHist(<unsigned int*&> data_32, <cpp_bool> False)
+    def get_tot_hist(self, snapshot=False):
+        cdef cnp.uint32_t* data_32 = NULL
+        if snapshot:
+            self.thisptr.getSnapshotTotHist(<unsigned int*&> data_32)
+        else:
+            self.thisptr.getTotHist(<unsigned int*&> data_32, <cpp_bool> False)
         if data_32 != NULL:
             return data_to_numpy_array_uint32(data_32, 16)
-    def get_mean_tot(self):
-        self.thisptr.getMeanTot(Nparameter, <float*&> data_float, <cpp_bool> False)
+    def get_mean_tot(self, snapshot=False):
+        cdef cnp.float32_t* data_float = NULL
+        cdef unsigned int Nparameter = 0
+        if snapshot:
+            self.thisptr.getSnapshotMeanTot(Nparameter, <float*&> data_float)
+        else:
+            self.thisptr.getMeanTot(Nparameter, <float*&> data_float, <cpp_bool> False)
         if data_float != NULL:
             array = data_to_numpy_array_float(data_float, 80 * 336 * Nparameter)
             return array.reshape((80, 336, Nparameter), order='F')  # make linear array to 3d array (col,row,parameter)
-    def get_tdc_value_hist(self):
-        self.thisptr.getTdcValuesHist(<unsigned int*&> data_32, <cpp_bool> False)
+    def get_rms_tot(self, snapshot=False):  # ToT RMS of the hits of each pixel and scan parameter, the ToT noise
+        cdef cnp.float32_t* data_float = NULL
+        cdef unsigned int Nparameter = 0
+        if snapshot:
+            self.thisptr.getSnapshotRmsTot(Nparameter, <float*&> data_float)
+        else:
+            self.thisptr.getRmsTot(Nparameter, <float*&> data_float, <cpp_bool> False)
+        if data_float != NULL:
+            array = data_to_numpy_array_float(data_float, 80 * 336 * Nparameter)
+            return array.reshape((80, 336, Nparameter), order='F')
+    def get_tdc_value_hist(self, snapshot=False):
+        cdef cnp.uint32_t* data_32 = NULL
+        if snapshot:
+            self.thisptr.getSnapshotTdcValuesHist(<unsigned int*&> data_32)
+        else:
+            self.thisptr.getTdcValuesHist(<unsigned int*&> data_32, <cpp_bool> False)
         if data_32 != NULL:
             return data_to_numpy_array_uint32(data_32, 4096)
-    def get_tdc_trigger_distance_hist(self):
-        self.thisptr.getTdcTriggerDistancesHist(<unsigned int*&> data_32, <cpp_bool> False)
+    def get_tdc_trigger_distance_hist(self, snapshot=False):
+        cdef cnp.uint32_t* data_32 = NULL
+        if snapshot:
+            self.thisptr.getSnapshotTdcTriggerDistancesHist(<unsigned int*&> data_32)
+        else:
+            self.thisptr.getTdcTriggerDistancesHist(<unsigned int*&> data_32, <cpp_bool> False)
         if data_32 != NULL:
             return data_to_numpy_array_uint32(data_32, 256)
-    def get_rel_bcid_hist(self):
-        self.thisptr.getRelBcidHist(<unsigned int*&> data_32, <cpp_bool> False)
+    def get_rel_bcid_hist(self, snapshot=False):
+        cdef cnp.uint32_t* data_32 = NULL
+        if snapshot:
+            self.thisptr.getSnapshotRelBcidHist(<unsigned int*&> data_32)
+        else:
+            self.thisptr.getRelBcidHist(<unsigned int*&> data_32, <cpp_bool> False)
         if data_32 != NULL:
             return data_to_numpy_array_uint32(data_32, 256)
-    def get_tot_pixel_hist(self):
-        self.thisptr.getTotPixelHist(<cnp.uint16_t*&> data_16, <cpp_bool> False)
+    def get_tot_pixel_hist(self, snapshot=False):
+        cdef cnp.uint16_t* data_16 = NULL
+        if snapshot:
+            self.thisptr.getSnapshotTotPixelHist(<cnp.uint16_t*&> data_16)
+        else:
+            self.thisptr.getTotPixelHist(<cnp.uint16_t*&> data_16, <cpp_bool> False)
         if data_16 != NULL:
             array = data_to_numpy_array_uint16(data_16, 80 * 336 * 16)
             return array.reshape((80, 336, 16), order='F')  # make linear array to 3d array (col,row,parameter)
-    def get_tdc_pixel_hist(self):
-        self.thisptr.getTdcPixelHist(<cnp.uint16_t*&> data_16, <cpp_bool> False)
+    def get_tdc_pixel_hist(self, snapshot=False):  # dense (col, row, tdc bin) histogram filled from the sparse histogram, the counts saturate at 65535
+        cdef cnp.uint16_t* data_16 = NULL
+        cdef unsigned int Nbins = 0
+        if snapshot:
+            self.thisptr.getSnapshotTdcPixelHist(Nbins, <cnp.uint16_t*&> data_16)
+        else:
+            Nbins = self.thisptr.getNtdcPixelHistBins()
+            self.thisptr.getTdcPixelHist(<cnp.uint16_t*&> data_16, <cpp_bool> False)
         if data_16 != NULL:
-            array = data_to_numpy_array_uint16(data_16, 80 * 336 * 4096)
-            return array.reshape((80, 336, 4096), order='F')
+            array = data_to_numpy_array_uint16(data_16, 80 * 336 * Nbins)
+            return array.reshape((80, 336, Nbins), order='F')
+    def get_tdc_pixel_hist_entries(self):  # the filled bins of the tdc pixel histogram as column index, row index, tdc bin and count arrays
+        cdef unsigned int n_entries = self.thisptr.getNtdcPixelHistEntries()
+        cdef cnp.ndarray[cnp.uint16_t, ndim=1] column = np.empty(n_entries, dtype=np.uint16)
+        cdef cnp.ndarray[cnp.uint16_t, ndim=1] row = np.empty(n_entries, dtype=np.uint16)
+        cdef cnp.ndarray[cnp.uint16_t, ndim=1] tdc_bin = np.empty(n_entries, dtype=np.uint16)
+        cdef cnp.ndarray[cnp.uint32_t, ndim=1] count = np.empty(n_entries, dtype=np.uint32)
+        self.thisptr.getTdcPixelHistEntries(<unsigned short*> column.data, <unsigned short*> row.data, <unsigned short*> tdc_bin.data, <unsigned int*> count.data)
+        return column, row, tdc_bin, count
     def add_hits(self, cnp.ndarray[numpy_hit_info, ndim=1] hit_info):
-        self.thisptr.addHits(<HitInfo*&> hit_info.data, <const unsigned int&> hit_info.shape[0])
+        cdef HitInfo* hits = <HitInfo*> hit_info.data
+        cdef unsigned int n_hits = <unsigned int> hit_info.shape[0]
+        with nogil:  # other Python threads run while the hits are histogrammed
+            self.thisptr.addHits(hits, n_hits)
     def add_cluster_seed_hits(self, cnp.ndarray[numpy_cluster_info, ndim=1] cluster_info, Ncluster):
-        self.thisptr.addClusterSeedHits(<ClusterInfo*&> cluster_info.data, <const unsigned int&> Ncluster)
+        cdef ClusterInfo* clusters = <ClusterInfo*> cluster_info.data
+        cdef unsigned int n_cluster = <unsigned int> Ncluster
+        with nogil:
+            self.thisptr.addClusterSeedHits(clusters, n_cluster)
     def add_scan_parameter(self, cnp.ndarray[cnp.int32_t, ndim=1] parameter_info):
         self.thisptr.addScanParameter(<int*&> parameter_info.data, <const unsigned int&> parameter_info.shape[0])
     def set_no_scan_parameter(self):
@@ -162,7 +180,47 @@ cdef class PyDataHistograming:
         self.thisptr.addMetaEventIndex(<uint64_t*&> event_index.data, <unsigned int&> array_length)
     def get_n_parameters(self):
         return <unsigned int> self.thisptr.getNparameters()
-    def calculate_threshold_scan_arrays(self, cnp.ndarray[cnp.float64_t, ndim=1] threshold, cnp.ndarray[cnp.float64_t, ndim=1] noise, n_injections, min_parameter, max_parameter):
-        self.thisptr.calculateThresholdScanArrays(<double*> threshold.data, <double*> noise.data, <const unsigned int&> n_injections, <const unsigned int&> min_parameter, <const unsigned int&> max_parameter)
+    def get_simd_version(self):  # instruction set of the add_hits version, selected from cpuid
+        return self.thisptr.getSimdVersion().decode()
+    def calculate_threshold_scan_arrays(self, cnp.ndarray[cnp.float64_t, ndim=1] threshold, cnp.ndarray[cnp.float64_t, ndim=1] noise, n_injections, min_parameter, max_parameter, fit_s_curves=False):  # with fit_s_curves the S-curve of each pixel is fitted with an error function, uses get_n_threads() threads
+        cdef double* mu = <double*> threshold.data
+        cdef double* sigma = <double*> noise.data
+        cdef unsigned int max_injections = <unsigned int> n_injections
+        cdef unsigned int min_par = <unsigned int> min_parameter
+        cdef unsigned int max_par = <unsigned int> max_parameter
+        cdef cpp_bool fit = <cpp_bool> fit_s_curves
+        with nogil:
+            self.thisptr.calculateThresholdScanArrays(mu, sigma, max_injections, min_par, max_par, fit)
+    def set_threshold_scan_steps(self, n_steps):  # call after the hits of each scan step are added, the estimates only need the new steps
+        self.thisptr.setThresholdScanSteps(<unsigned int> n_steps)
+    def get_threshold_scan_steps(self):
+        return self.thisptr.getThresholdScanSteps()
+    def calculate_threshold_scan_estimates(self, cnp.ndarray[cnp.float64_t, ndim=1] threshold, cnp.ndarray[cnp.float64_t, ndim=1] noise, n_injections, min_parameter, max_parameter):  # equal to calculate_threshold_scan_arrays after the last step
+        self.thisptr.calculateThresholdScanEstimates(<double*> threshold.data, <double*> noise.data, <unsigned int> n_injections, <unsigned int> min_parameter, <unsigned int> max_parameter)
     def reset(self):
         self.thisptr.reset()
+    def merge(self, PyDataHistograming histogram):  # adds the histograms of histogram, e.g. of another worker; the same histograms have to be created for the same scan parameters
+        self.thisptr.merge(histogram.thisptr[0])
+    def serialize(self):  # the settings, scan parameter values and histograms as bytes, to be exchanged between processes
+        return self.thisptr.serialize()
+    def deserialize(self, bytes data):  # replaces the settings and histograms with the serialized ones, the scan parameter and meta event index arrays are kept
+        self.thisptr.deserialize(<string> data)
+    def set_time_slices(self, n_slices, slice_length=0):  # keeps the occupancy and ToT sums of the n_slices newest time slices of slice_length seconds (0: one slice per read out), 0 slices disables the history
+        self.thisptr.setTimeSlices(<const unsigned int&> n_slices, <const double&> slice_length)
+    def set_meta_time_stamps(self, cnp.ndarray[numpy_meta_data_v2, ndim=1] meta_data):  # the meta data of the read outs of the meta event index, needed for slices of slice_length seconds
+        self.thisptr.setMetaTimeStamps(<MetaInfoV2*&> meta_data.data, <const unsigned int&> meta_data.shape[0])
+    def get_time_slices(self):  # the slice index, start time stamp and number of hits of the slices in the history, oldest first
+        cdef unsigned int n_slices = self.thisptr.getNtimeSlices()
+        cdef cnp.ndarray[cnp.int64_t, ndim=1] slice_index = np.empty(n_slices, dtype=np.int64)
+        cdef cnp.ndarray[cnp.float64_t, ndim=1] timestamp_start = np.empty(n_slices, dtype=np.float64)
+        cdef cnp.ndarray[cnp.uint32_t, ndim=1] n_hits = np.empty(n_slices, dtype=np.uint32)
+        if n_slices > 0:
+            self.thisptr.getTimeSlices(<int64_t*> slice_index.data, <double*> timestamp_start.data, <unsigned int*> n_hits.data)
+        return slice_index, timestamp_start, n_hits
+    def get_time_slice_occupancy(self, first_slice=0, last_slice=None):  # occupancy and ToT sums of the history slices first_slice to last_slice (exclusive) as (col, row) arrays
+        cdef cnp.ndarray[cnp.uint32_t, ndim=1] occupancy = np.empty(80 * 336, dtype=np.uint32)
+        cdef cnp.ndarray[cnp.uint64_t, ndim=1] tot_sum = np.empty(80 * 336, dtype=np.uint64)
+        if last_slice is None:
+            last_slice = self.thisptr.getNtimeSlices()
+        self.thisptr.getTimeSliceOccupancy(<const unsigned int&> first_slice, <const unsigned int&> last_slice, <unsigned int*> occupancy.data, <uint64_t*> tot_sum.data)
+        return occupancy.reshape((80, 336), order='F'), tot_sum.reshape((80, 336), order='F')
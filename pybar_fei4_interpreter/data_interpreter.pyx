@@ -9,8 +9,11 @@ from numpy cimport ndarray
 from libcpp cimport bool as cpp_bool  # to be able to use bool variables, as cpp_bool according to http://code.google.com/p/cefpython/source/browse/cefpython/cefpython.pyx?spec=svne037c69837fa39ae220806c2faa1bbb6ae4500b9&r=e037c69837fa39ae220806c2faa1bbb6ae4500b9
 from data_struct cimport numpy_hit_info, numpy_meta_data, numpy_meta_data_v2, numpy_meta_word_data
 from data_struct import MetaTable, MetaTableV2
+from data_histograming cimport Histogram, PyDataHistograming
 from tables import dtype_from_descr
 from libc.stdint cimport uint64_t
+from libcpp.string cimport string
+from collections import deque
 
 cnp.import_array()  # if array is used it has to be imported, otherwise possible runtime error
 
@@ -27,6 +30,13 @@ cdef extern from "Interpret.h":
         MetaWordInfoOut()
     cdef cppclass HitInfo:
         HitInfo()
+    cdef cppclass EventInfo:
+        EventInfo()
+    cdef cppclass SlimHitInfo:
+        SlimHitInfo()
+    cdef cppclass DiagnosticRecord:
+        DiagnosticRecord()
+    ctypedef void (*EventCallback)(const EventInfo& rEventInfo, const HitInfo* pHits, const unsigned int& rNhits, void* pUserData)
     cdef cppclass Interpret(Basis):
         Interpret() except +  # exception raised by C++ code handled by Python
         void printStatus()
@@ -42,16 +52,31 @@ cdef extern from "Interpret.h":
         cpp_bool getMetaTableV2()
 
         void setHitsArraySize(const unsigned int &rSize)
+        void setEventsArraySize(const unsigned int& rSize)
+        void createEventTable(cpp_bool CreateEventTable)
+        void setEventCallback(EventCallback pEventCallback, void* pUserData, cpp_bool storeEventHits)
+        void setHistogram(Histogram* pHistogram, cpp_bool storeEventHits)
+        void setMaxHitBufferSize(const unsigned int& rSize)
+        unsigned int getMaxHitBufferSize()
+        unsigned int getHitBufferSize()
+        void setNthreads(const unsigned int& rNthreads, const unsigned int& rMinWordsPerThread)
+        unsigned int getNthreads()
+        unsigned int getNparallelReruns()  # returns the number of parallel chunks that were interpreted again
 
         void setMetaData(MetaInfo*& rMetaInfo, const unsigned int& tLength) except +  # exception raised by C++ code handled by Python
         void setMetaDataV2(MetaInfoV2*& rMetaInfo, const unsigned int& tLength) except +  # exception raised by C++ code handled by Python
 
         void setMetaDataEventIndex(uint64_t*& rEventNumber, const unsigned int& rSize)
         void setMetaDataWordIndex(MetaWordInfoOut*& rWordNumber, const unsigned int& rSize)
+        void setHitsArray(HitInfo*& rHitInfo, const unsigned int& rSize)
+        void setEventTableArrays(EventInfo*& rEventInfo, const unsigned int& rNevents, SlimHitInfo*& rSlimHitInfo, const unsigned int& rNslimHits)
 
-        void interpretRawData(unsigned int* pDataWords, const unsigned int& pNdataWords) except +  # exception raised by C++ code handled by Python
+        void interpretRawData(unsigned int* pDataWords, const unsigned int& pNdataWords) except + nogil  # exception raised by C++ code handled by Python
+        void histogramOccupancy(unsigned int* pDataWords, const unsigned int& pNdataWords) except + nogil  # exception raised by C++ code handled by Python
 #         void getMetaEventIndex(unsigned int& rEventNumberIndex, unsigned int*& rEventNumber)
         void getHits(HitInfo*& rHitInfo, unsigned int& rSize, cpp_bool copy)
+        void getEvents(EventInfo*& rEventInfo, unsigned int& rSize, cpp_bool copy)
+        void getSlimHits(SlimHitInfo*& rSlimHitInfo, unsigned int& rSize, cpp_bool copy)
 
         void getServiceRecordsCounters(unsigned int*& rServiceRecordsCounter, unsigned int& rNserviceRecords, cpp_bool copy)  # returns the total service record counter array
         void getEventStatusCounters(unsigned int*& rEventStatusCounter, unsigned int& rNeventStatusCounters, cpp_bool copy)  # returns the total errors counter array
@@ -59,8 +84,11 @@ cdef extern from "Interpret.h":
         void getTdcValues(unsigned int*& rTdcValue, unsigned int& rNtdcValues, cpp_bool copy)
         void getTdcTriggerDistances(unsigned int*& rTdcTriggerDistance, unsigned int& rNtdcTriggerDistance, cpp_bool copy)
         unsigned int getNarrayHits()  # returns the maximum index filled with hits in the hit array
+        unsigned int getNarrayEvents()  # returns the maximum index filled with events in the event array
         unsigned int getNmetaDataEvent()  # returns the maximum index filled with event data infos
         unsigned int getNmetaDataWord()
+        unsigned int getNinterpretedWords()  # returns the number of words interpreted by the last interpretRawData call
+        unsigned int getNpendingEvents()  # returns the number of events that did not fit into the caller owned arrays
         void alignAtTriggerNumber(cpp_bool alignAtTriggerNumber)
         void alignAtTdcWord(cpp_bool alignAtTdcWord)
         void setTriggerDataFormat(const unsigned int& rTriggerDataFormat)
@@ -77,9 +105,10 @@ cdef extern from "Interpret.h":
         void printSummary()
         void debugEvents(const unsigned int& rStartEvent, const unsigned int& rStopEvent, const cpp_bool& debugEvents)
 
-        void addEvent()
+        void addEvent() except +
 
         unsigned int getHitSize()
+        string getSimdVersion()
 
         void reset()
         void resetHistograms()
@@ -88,9 +117,12 @@ cdef extern from "Interpret.h":
         unsigned int getNhits()
         uint64_t getNevents()
 
-cdef cnp.uint32_t* data_32
-cdef HitInfo* hits
-cdef unsigned int n_entries = 0
+        void setDiagnosticRecordsSize(const unsigned int& rSize) except +
+        void getDiagnosticRecords(DiagnosticRecord*& rDiagnosticRecords, unsigned int& rSize, cpp_bool copy)
+        unsigned int getNdiagnosticRecords()
+        void resetDiagnosticRecords()
+
+# an interpreter instance must not be used by several threads at the same time, different instances can interpret in parallel
 cdef data_to_numpy_array_uint32(cnp.uint32_t* ptr, cnp.npy_intp N):
     cdef cnp.ndarray[cnp.uint32_t, ndim=1] arr = cnp.PyArray_SimpleNewFromData(1, <cnp.npy_intp*> &N, cnp.NPY_UINT32, <cnp.uint32_t*> ptr)
     #PyArray_ENABLEFLAGS(arr, np.NPY_OWNDATA)
@@ -116,8 +148,88 @@ cdef hit_data_to_numpy_array(void* ptr, cnp.npy_intp N):
     arr.setflags(write=False)  # protect the hit data
     return arr
 
+cdef event_dt = cnp.dtype([
+    ('event_number', '<i8'),
+    ('trigger_number', '<u4'),
+    ('trigger_time_stamp', '<u4'),
+    ('TDC', '<u2'),
+    ('TDC_time_stamp', '<u2'),
+    ('TDC_trigger_distance', '<u1'),
+    ('trigger_status', '<u1'),
+    ('service_record', '<u4'),
+    ('event_status', '<u2'),
+    ('n_hits', '<u4'),
+    ('hit_index', '<u8')])
+cdef slim_hit_dt = cnp.dtype([
+    ('event_number', '<i8'),
+    ('relative_BCID', '<u1'),
+    ('LVL1ID', '<u2'),
+    ('column', '<u1'),
+    ('row', '<u2'),
+    ('tot', '<u1'),
+    ('BCID', '<u2')])
+cdef data_to_numpy_record_array(void* ptr, cnp.npy_intp N, dtype):
+    arr = cnp.PyArray_SimpleNewFromData(1, <cnp.npy_intp*> &N, cnp.NPY_INT8, <void*> ptr).view(dtype)
+    arr.setflags(write=False)  # protect the data
+    return arr
+
+cdef diagnostic_dt = cnp.dtype([
+    ('word_index', '<u4'),
+    ('event_number', '<i8'),
+    ('code', '<u2'),
+    ('raw_word', '<u4')])
+diagnostic_messages = {  # text for the diagnostic codes defined in defines.h
+    1: 'too many data headers, aligning at trigger number (set __TRUNC_EVENT)',
+    2: 'BCID jumping',
+    3: 'LVL1 is not constant',
+    4: 'missing trigger (adding new event)',
+    5: 'event incomplete (adding new event)',
+    6: 'Trigger Number not increasing by 1',
+    7: 'too many data records',
+    8: 'data record values out of bounds',
+    9: 'UNKNOWN WORD',
+    10: 'BCID ERROR',
+    11: '# trigger words > 1',
+    12: 'hit array full'}
+
+cdef void call_event_callback(const EventInfo& rEventInfo, const HitInfo* pHits, const unsigned int& rNhits, void* pUserData) noexcept with gil:  # calls the Python event callback with read only views of the event infos and the hits
+    cdef list event_callback = <list> pUserData  # [callback, exception raised by the callback]
+    if event_callback[1] is not None:  # no further calls after an exception
+        return
+    try:
+        event_callback[0](data_to_numpy_record_array(<void*> &rEventInfo, sizeof(EventInfo), event_dt)[0], hit_data_to_numpy_array(<void*> pHits, sizeof(HitInfo) * rNhits))
+    except BaseException as exception:  # exceptions cannot pass the C++ code, they are raised after the interpretation
+        event_callback[1] = exception
+
+
+cdef extern from "OnlineInterpret.h":
+    cdef struct OnlineStatus:
+        unsigned int nChunks
+        unsigned int nWords
+        uint64_t nEvents
+        unsigned int nHits
+        unsigned int nTriggers
+        unsigned int nEmptyEvents
+        unsigned int nUnknownWords
+        unsigned int eventStatusCounter[16]  # __N_EVENT_STATUS_BITS
+    cdef cppclass OnlineInterpret(Basis):
+        OnlineInterpret(Interpret* pInterpret, Histogram* pHistogram) except +  # exception raised by C++ code handled by Python
+        void start() except +  # exception raised by C++ code handled by Python
+        void stop() nogil
+        void wait() except + nogil  # exception raised by C++ code handled by Python
+        cpp_bool addRawData(unsigned int* pDataWords, const unsigned int& rNdataWords)
+        void getStatus(OnlineStatus& rStatus)
+        unsigned int getNaddedChunks()
+        unsigned int getNprocessedChunks()
+        unsigned int getNrejectedChunks()
+        cpp_bool hasError()
+
+
 cdef class PyDataInterpreter:
     cdef Interpret* thisptr  # hold a C++ instance which we're wrapping
+    cdef object output_arrays  # caller owned output arrays, referenced as long as the interpreter fills them
+    cdef list event_callback  # Python event callback and the exception it raised, referenced as long as the interpreter calls it
+    cdef PyDataHistograming histogram  # histogram filled with the hits of every event, referenced as long as the interpreter fills it
     def __cinit__(self):
         self.thisptr = new Interpret()
     def __dealloc__(self):
@@ -134,14 +246,65 @@ cdef class PyDataInterpreter:
         self.thisptr.setErrorOutput(<cpp_bool> toggle)
     def set_hits_array_size(self, size):
         self.thisptr.setHitsArraySize(<const unsigned int&> size)
-    def interpret_raw_data(self, cnp.ndarray[cnp.uint32_t, ndim=1] data):
-        self.thisptr.interpretRawData(<unsigned int*> data.data, <unsigned int> data.shape[0])
-        return data, data.shape[0]
+    def set_events_array_size(self, size):
+        self.thisptr.setEventsArraySize(<const unsigned int&> size)
+    def create_event_table(self, value):  # store the events into an event table and the hits into a slim hit table instead of the combined hit table
+        self.thisptr.createEventTable(<cpp_bool> value)
+    def set_max_hit_buffer_size(self, size):  # maximum number of hits in one event, more hits are ignored and the event is flagged as truncated
+        self.thisptr.setMaxHitBufferSize(<const unsigned int&> size)
+    def get_max_hit_buffer_size(self):
+        return <unsigned int> self.thisptr.getMaxHitBufferSize()
+    def get_hit_buffer_size(self):  # number of hits the event hit buffer can hold without growing
+        return <unsigned int> self.thisptr.getHitBufferSize()
+    def set_n_threads(self, n_threads, min_words_per_thread=1048576):  # raw data chunks with at least min_words_per_thread words per thread are interpreted in parallel, 0 uses all cores
+        self.thisptr.setNthreads(<const unsigned int&> n_threads, <const unsigned int&> min_words_per_thread)
+    def get_n_threads(self):
+        return <unsigned int> self.thisptr.getNthreads()
+    def get_n_parallel_reruns(self):
+        return <unsigned int> self.thisptr.getNparallelReruns()
+    def set_hits_array(self, ndarray hits):  # caller owned hit array, if it is full interpret_raw_data stops after the last event that fits
+        if hits.dtype.itemsize != sizeof(HitInfo) or not hits.flags.c_contiguous:
+            raise ValueError('The hit array has to be a contiguous array with the hit data type')
+        self.output_arrays = (hits, )
+        self.thisptr.setHitsArray(<HitInfo*&> hits.data, <const unsigned int&> hits.shape[0])
+    def set_event_table_arrays(self, ndarray events, ndarray slim_hits):  # caller owned event table arrays, if they are full interpret_raw_data stops after the last event that fits
+        if events.dtype.itemsize != sizeof(EventInfo) or slim_hits.dtype.itemsize != sizeof(SlimHitInfo) or not events.flags.c_contiguous or not slim_hits.flags.c_contiguous:
+            raise ValueError('The event table arrays have to be contiguous arrays with the event and slim hit data type')
+        self.output_arrays = (events, slim_hits)
+        self.thisptr.setEventTableArrays(<EventInfo*&> events.data, <const unsigned int&> events.shape[0], <SlimHitInfo*&> slim_hits.data, <const unsigned int&> slim_hits.shape[0])
+    def interpret_raw_data(self, cnp.ndarray[cnp.uint32_t, ndim=1] data):  # returns the data and the number of interpreted words, the following words have to be given to the next call
+        cdef unsigned int* data_words = <unsigned int*> data.data
+        cdef unsigned int n_data_words = <unsigned int> data.shape[0]
+        with nogil:  # other Python threads run while the raw data is interpreted
+            self.thisptr.interpretRawData(data_words, n_data_words)
+        self.raise_event_callback_exception()
+        return data, self.thisptr.getNinterpretedWords()
+    def histogram_occupancy(self, cnp.ndarray[cnp.uint32_t, ndim=1] data):  # fast mode for occupancy scans, counts the data record hits per read out into the occupancy histogram of the histogram set with set_histogram without building events
+        cdef unsigned int* data_words = <unsigned int*> data.data
+        cdef unsigned int n_data_words = <unsigned int> data.shape[0]
+        with nogil:
+            self.thisptr.histogramOccupancy(data_words, n_data_words)
+    def get_n_pending_events(self):  # events that did not fit into the caller owned arrays, stored by the next interpret_raw_data call
+        return <unsigned int> self.thisptr.getNpendingEvents()
     def get_hits(self):
+        cdef HitInfo* hits = NULL
+        cdef unsigned int n_entries = 0
         self.thisptr.getHits(<HitInfo*&> hits, <unsigned int&> n_entries, <cpp_bool> False)
         if hits != NULL:
             array = hit_data_to_numpy_array(hits, sizeof(HitInfo) * n_entries)
             return array
+    def get_events(self):  # event table, the hits of the event are get_slim_hits()[hit_index:hit_index + n_hits]
+        cdef EventInfo* events = NULL
+        cdef unsigned int n_entries = 0
+        self.thisptr.getEvents(<EventInfo*&> events, <unsigned int&> n_entries, <cpp_bool> False)
+        if events != NULL:
+            return data_to_numpy_record_array(events, sizeof(EventInfo) * n_entries, event_dt)
+    def get_slim_hits(self):
+        cdef SlimHitInfo* slim_hits = NULL
+        cdef unsigned int n_entries = 0
+        self.thisptr.getSlimHits(<SlimHitInfo*&> slim_hits, <unsigned int&> n_entries, <cpp_bool> False)
+        if slim_hits != NULL:
+            return data_to_numpy_record_array(slim_hits, sizeof(SlimHitInfo) * n_entries, slim_hit_dt)
     def set_meta_data(self, ndarray meta_data):  # set_meta_data(self, cnp.ndarray[numpy_meta_data, ndim=1] meta_data)
         meta_data_dtype = meta_data.dtype
         if meta_data_dtype == dtype_from_descr(MetaTable):
@@ -155,27 +318,39 @@ cdef class PyDataInterpreter:
     def set_meta_data_word_index(self, cnp.ndarray[numpy_meta_word_data, ndim=1] meta_word_data):
         self.thisptr.setMetaDataWordIndex(<MetaWordInfoOut*&> meta_word_data.data, <const unsigned int&>  meta_word_data.shape[0])
     def get_service_records_counters(self):
+        cdef cnp.uint32_t* data_32 = NULL
+        cdef unsigned int n_entries = 0
         self.thisptr.getServiceRecordsCounters(<unsigned int*&> data_32, <unsigned int&> n_entries, <cpp_bool> False)
         if data_32 != NULL:
             return data_to_numpy_array_uint32(data_32, n_entries)
     def get_event_status_counters(self):
+        cdef cnp.uint32_t* data_32 = NULL
+        cdef unsigned int n_entries = 0
         self.thisptr.getEventStatusCounters(<unsigned int*&> data_32, <unsigned int&> n_entries, <cpp_bool> False)
         if data_32 != NULL:
             return data_to_numpy_array_uint32(data_32, n_entries)
     def get_trigger_status_counters(self):
+        cdef cnp.uint32_t* data_32 = NULL
+        cdef unsigned int n_entries = 0
         self.thisptr.getTriggerStatusCounters(<unsigned int*&> data_32, <unsigned int&> n_entries, <cpp_bool> False)
         if data_32 != NULL:
             return data_to_numpy_array_uint32(data_32, n_entries)
     def get_tdc_values(self):
+        cdef cnp.uint32_t* data_32 = NULL
+        cdef unsigned int n_entries = 0
         self.thisptr.getTdcValues(<unsigned int*&> data_32, <unsigned int&> n_entries, <cpp_bool> False)
         if data_32 != NULL:
             return data_to_numpy_array_uint32(data_32, n_entries)
     def get_tdc_trigger_distances(self):
+        cdef cnp.uint32_t* data_32 = NULL
+        cdef unsigned int n_entries = 0
         self.thisptr.getTdcTriggerDistances(<unsigned int*&> data_32, <unsigned int&> n_entries, <cpp_bool> False)
         if data_32 != NULL:
             return data_to_numpy_array_uint32(data_32, n_entries)
     def get_n_array_hits(self):
         return <unsigned int> self.thisptr.getNarrayHits()
+    def get_n_array_events(self):
+        return <unsigned int> self.thisptr.getNarrayEvents()
     def get_n_meta_data_word(self):
         return <unsigned int> self.thisptr.getNmetaDataWord()
     def align_at_trigger(self, align_at_trigger):
@@ -215,10 +390,30 @@ cdef class PyDataInterpreter:
         self.thisptr.setFEI4B(<cpp_bool> setFEI4B)
     def store_event(self):
         self.thisptr.addEvent()
+        self.raise_event_callback_exception()
+    def set_event_callback(self, callback, store_hits=True):  # callback(event_info, hits) is called for every event with read only views that are only valid during the call, None removes the callback; if store_hits is False the hits are not stored into the hit array
+        if callback is None:
+            self.thisptr.setEventCallback(NULL, NULL, <cpp_bool> True)
+            self.event_callback = None
+        else:
+            self.event_callback = [callback, None]
+            self.thisptr.setEventCallback(call_event_callback, <void*> self.event_callback, <cpp_bool> store_hits)
+    def set_histogram(self, PyDataHistograming histogram, store_hits=True):  # fills the histograms of histogram directly with the hits of every event, the scan parameter is the one of the actual read out, None removes the histogram; if store_hits is False the hits are not stored into the hit array
+        self.histogram = histogram
+        if histogram is None:
+            self.thisptr.setHistogram(NULL, <cpp_bool> True)
+        else:
+            self.thisptr.setHistogram(histogram.thisptr, <cpp_bool> store_hits)
+    cdef raise_event_callback_exception(self):
+        if self.event_callback is not None and self.event_callback[1] is not None:
+            exception, self.event_callback[1] = self.event_callback[1], None
+            raise exception
     def debug_events(self,start_event,stop_event,toggle = True):
         self.thisptr.debugEvents(<const unsigned int&> start_event, <const unsigned int&> stop_event, <const cpp_bool&> toggle)
     def get_hit_size(self):
         return <unsigned int> self.thisptr.getHitSize()
+    def get_simd_version(self):  # instruction set of the data record pre-scan, selected from cpuid
+        return self.thisptr.getSimdVersion().decode()
     def set_max_tdc_delay(self, max_tdc_delay):  # max delay, below tdc words are fully ignored (but counted)
         self.thisptr.setMaxTdcDelay(<const unsigned int&> max_tdc_delay)
     def set_max_trigger_number(self, max_trigger_number):  # max delay, below tdc words are fully ignored (but counted)
@@ -239,3 +434,77 @@ cdef class PyDataInterpreter:
         return <unsigned int> self.thisptr.getNhits()
     def get_n_events(self):
         return <uint64_t> self.thisptr.getNevents()
+    def set_diagnostic_records_size(self, size):  # number of diagnostic records kept in the ring buffer, 0 deactivates the diagnostics
+        self.thisptr.setDiagnosticRecordsSize(<const unsigned int&> size)
+    def get_diagnostic_records(self):  # returns a copy of the kept diagnostic records, oldest first
+        cdef DiagnosticRecord* diagnostic_records = NULL
+        cdef unsigned int n_entries = 0
+        cdef cnp.npy_intp n_bytes
+        self.thisptr.getDiagnosticRecords(<DiagnosticRecord*&> diagnostic_records, <unsigned int&> n_entries, <cpp_bool> False)
+        if diagnostic_records != NULL:
+            n_bytes = sizeof(DiagnosticRecord) * n_entries
+            return cnp.PyArray_SimpleNewFromData(1, &n_bytes, cnp.NPY_INT8, <void*> diagnostic_records).view(diagnostic_dt).copy()
+        return np.zeros(shape=(0, ), dtype=diagnostic_dt)
+    def get_diagnostic_messages(self):  # formats the kept diagnostic records
+        return ['word %d at event %d: %s (raw word 0x%08x)' % (record['word_index'], record['event_number'], diagnostic_messages.get(record['code'], 'unknown diagnostic code %d' % record['code']), record['raw_word']) for record in self.get_diagnostic_records()]
+    def get_n_diagnostic_records(self):  # total number of diagnostic records, including the overwritten ones
+        return <unsigned int> self.thisptr.getNdiagnosticRecords()
+    def reset_diagnostic_records(self):
+        self.thisptr.resetDiagnosticRecords()
+
+
+cdef class PyOnlineInterpreter:  # interprets the raw data chunks in a worker thread with the interpreter that fills the histogram directly, the interpreter and the histogram must not be used otherwise while the worker runs
+    cdef OnlineInterpret* thisptr  # hold a C++ instance which we're wrapping
+    cdef PyDataInterpreter interpreter
+    cdef PyDataHistograming histogram
+    cdef object chunks  # raw data chunks in the queue, referenced until they are interpreted
+    cdef unsigned int n_released_chunks
+    def __cinit__(self, PyDataInterpreter interpreter not None, PyDataHistograming histogram not None):
+        self.thisptr = new OnlineInterpret(interpreter.thisptr, histogram.thisptr)
+        self.interpreter = interpreter
+        self.histogram = histogram
+        interpreter.histogram = histogram
+        self.chunks = deque()
+        self.n_released_chunks = 0
+    def __dealloc__(self):
+        if self.thisptr != NULL:
+            with nogil:  # the worker can need the GIL for the event callback
+                self.thisptr.stop()
+            del self.thisptr
+    def start(self):  # starts the worker thread
+        self.thisptr.start()
+    def stop(self):  # interprets the queued raw data chunks and stops the worker thread
+        with nogil:
+            self.thisptr.stop()
+        self.release_chunks()
+    def wait(self):  # blocks until the queued raw data chunks are interpreted
+        try:
+            with nogil:
+                self.thisptr.wait()
+        finally:
+            self.release_chunks()
+    def add_raw_data(self, cnp.ndarray[cnp.uint32_t, ndim=1] data):  # puts the raw data chunk into the queue without copying and without waiting for the interpretation, returns False if the queue is full
+        if not data.flags.c_contiguous:
+            raise ValueError('The raw data has to be a contiguous array')
+        self.release_chunks()
+        if self.thisptr.addRawData(<unsigned int*> data.data, <unsigned int> data.shape[0]):
+            self.chunks.append(data)
+            return True
+        return False
+    def get_status(self):  # returns the counters after the last interpreted chunk, can be called at any time
+        cdef OnlineStatus status
+        self.thisptr.getStatus(status)
+        return {'n_chunks': status.nChunks, 'n_words': status.nWords, 'n_events': status.nEvents, 'n_hits': status.nHits, 'n_triggers': status.nTriggers, 'n_empty_events': status.nEmptyEvents, 'n_unknown_words': status.nUnknownWords, 'event_status_counter': np.array([status.eventStatusCounter[i] for i in range(16)], dtype=np.uint32)}
+    def get_n_added_chunks(self):
+        return <unsigned int> self.thisptr.getNaddedChunks()
+    def get_n_processed_chunks(self):
+        return <unsigned int> self.thisptr.getNprocessedChunks()
+    def get_n_rejected_chunks(self):  # chunks not added because the queue was full
+        return <unsigned int> self.thisptr.getNrejectedChunks()
+    def has_error(self):
+        return <cpp_bool> self.thisptr.hasError()
+    cdef release_chunks(self):  # drops the references to the interpreted chunks
+        cdef unsigned int n_processed_chunks = self.thisptr.getNprocessedChunks()
+        while self.n_released_chunks != n_processed_chunks:
+            self.chunks.popleft()
+            self.n_released_chunks += 1
@@ -82,6 +82,30 @@ class HitInfoTable(tb.IsDescription):
     event_status = tb.UInt16Col(pos=14)
 
 
+class EventInfoTable(tb.IsDescription):
+    event_number = tb.Int64Col(pos=0)
+    trigger_number = tb.UInt32Col(pos=1)
+    trigger_time_stamp = tb.UInt32Col(pos=2)
+    TDC = tb.UInt16Col(pos=3)
+    TDC_time_stamp = tb.UInt16Col(pos=4)
+    TDC_trigger_distance = tb.UInt8Col(pos=5)
+    trigger_status = tb.UInt8Col(pos=6)
+    service_record = tb.UInt32Col(pos=7)
+    event_status = tb.UInt16Col(pos=8)
+    n_hits = tb.UInt32Col(pos=9)
+    hit_index = tb.UInt64Col(pos=10)
+
+
+class SlimHitInfoTable(tb.IsDescription):
+    event_number = tb.Int64Col(pos=0)
+    relative_BCID = tb.UInt8Col(pos=1)
+    LVL1ID = tb.UInt16Col(pos=2)
+    column = tb.UInt8Col(pos=3)
+    row = tb.UInt16Col(pos=4)
+    tot = tb.UInt8Col(pos=5)
+    BCID = tb.UInt16Col(pos=6)
+
+
 class MetaInfoEventTable(tb.IsDescription):
     event_number = tb.Int64Col(pos=0)
     time_stamp = tb.Float64Col(pos=1)
@@ -35,6 +35,32 @@ typedef struct HitInfo{
   uint16_t event_status;  // event status value
 } HitInfo;
 
+// structure to store the event infos for the event table, the hits of the event are stored in the slim hit table
+typedef struct EventInfo{
+  int64_t event_number;  // event number value
+  uint32_t trigger_number;  // trigger number
+  uint32_t trigger_time_stamp;  // trigger time stamp
+  uint16_t TDC;  // TDC value (12-bit value)
+  uint16_t TDC_time_stamp;  // TDC time stamp (8-bit or 16-bit value)
+  uint8_t TDC_trigger_distance;  // TDC trigger distance (8-bit value)
+  uint8_t trigger_status;  // event service records
+  uint32_t service_record;  // event service records
+  uint16_t event_status;  // event status value
+  uint32_t n_hits;  // number of hits of the event
+  uint64_t hit_index;  // index of the first hit of the event in the slim hit table
+} EventInfo;
+
+// structure to store the hits without the event infos that are stored in the event table
+typedef struct SlimHitInfo{
+  int64_t event_number;  // event number value, index of the event in the event table
+  uint8_t relative_BCID;  // relative BCID value
+  uint16_t LVL1ID;  // LVL1ID
+  uint8_t column;  // column value
+  uint16_t row;  // row value
+  uint8_t tot;  // ToT value
+  uint16_t BCID;  // absolute BCID value
+} SlimHitInfo;
+
 // structure to store the hits with cluster info
 typedef struct ClusterHitInfo{
   int64_t event_number;  // event number value
@@ -103,12 +129,31 @@ typedef struct MetaWordInfoOut{
   uint32_t stopWordIdex;  // stop word index
 } MetaWordInfoOut;
 
+// structure to store the conditions found during interpretation, formatted on request
+typedef struct DiagnosticRecord{
+  uint32_t word_index;  // total word index of the word that raised the condition
+  int64_t event_number;  // event number at the time the condition was raised
+  uint16_t code;  // diagnostic code
+  uint32_t raw_word;  // raw data word that raised the condition, 0 if not related to a word
+} DiagnosticRecord;
+
 // DUT and TLU defines
 const uint32_t __BCIDCOUNTERSIZE_FEI4A=256;  // BCID counter for FEI4A has 8 bit
 const uint32_t __BCIDCOUNTERSIZE_FEI4B=1024;  // BCID counter for FEI4B has 10 bit
 const uint32_t __NSERVICERECORDS=32;  // number of different service records
 const size_t __MAXARRAYSIZE=2000000;  // maximum buffer array size for the output hit array (has to be bigger than hits in one chunk)
-const size_t __MAXHITBUFFERSIZE=4000000;  // maximum buffer array size for the hit buffer array (has to be bigger than hits in one event)
+const size_t __MAXHITBUFFERSIZE=4000000;  // standard maximum number of hits in one event, events with more hits are truncated
+const unsigned int __DATA_RECORD_BLOCK_SIZE=64;  // number of data records that are decoded at once
+const size_t __HITBUFFERSTARTSIZE=1024;  // initial size of the hit buffer array, it grows geometrically with the hits per event up to the maximum number of hits
+const size_t __PARALLEL_MIN_WORDS=1048576;  // standard minimum number of raw data words per thread for the parallel interpretation, less words are interpreted serially
+const size_t __PARALLEL_MIN_HITS=1048576;  // standard minimum number of hits per thread for the parallel histogramming, less hits are histogrammed serially
+const unsigned int __THRESHOLD_BLOCK_SIZE=256;  // number of pixels whose parameter slices are processed together in the threshold scan analysis
+const unsigned int __SCURVE_FIT_MAX_ITERATIONS=100;  // maximum number of Levenberg-Marquardt iterations of the S-curve fit
+const size_t __RESET_BLOCK_SIZE=256;  // number of bins of the pixel histogram blocks that are tracked for the sparse reset, 105 blocks per pixel matrix
+const unsigned int __HISTOGRAM_FORMAT_VERSION=2;  // version of the serialized histogram format, has to be increased if the format changes
+const size_t __PARALLEL_WARM_UP_WORDS=16384;  // number of raw data words interpreted in front of a parallel chunk to find the event state at the chunk start
+const unsigned int __ONLINE_QUEUE_SIZE=1024;  // number of raw data chunks the online interpretation queue can hold, has to be a power of two
+const unsigned int __ONLINE_IDLE_SLEEP=1;  // time in ms the online interpretation worker sleeps if the queue is empty
 
 // event status codes
 const uint32_t __N_EVENT_STATUS_BITS=16;  // number of event error codes
@@ -137,6 +182,21 @@ const uint32_t __TRG_NUMBER_MORE_ONE=2;  // more than one trigger per event
 const uint32_t __TRG_ERROR_TRG_ACCEPT=4;  // TLU error
 const uint32_t __TRG_ERROR_LOW_TIMEOUT=8;  // TLU error
 
+// diagnostic codes
+const uint32_t __N_DIAGNOSTIC_CODES=13;  // number of diagnostic codes
+const uint16_t __DIAG_TOO_MANY_DATA_HEADERS=1;  // too many data headers while aligning at trigger number
+const uint16_t __DIAG_BCID_JUMP=2;  // BCID not increasing by 1, event is kept
+const uint16_t __DIAG_NON_CONST_LVL1ID=3;  // LVL1ID not constant in the event
+const uint16_t __DIAG_NO_TRG_WORD=4;  // trigger word missing, new event is created
+const uint16_t __DIAG_MISSING_DATA_HEADER=5;  // data headers missing at trigger word, new event is created
+const uint16_t __DIAG_TRG_NUMBER_INC_ERROR=6;  // trigger number not increasing by 1
+const uint16_t __DIAG_HIT_BUFFER_FULL=7;  // too many data records in the event, hits are ignored
+const uint16_t __DIAG_DATA_RECORD_OUT_OF_BOUNDS=8;  // data record values out of bounds
+const uint16_t __DIAG_UNKNOWN_WORD=9;  // unknown word
+const uint16_t __DIAG_BCID_ERROR=10;  // BCID not increasing by 1, event is incomplete and new event is created
+const uint16_t __DIAG_TRG_NUMBER_MORE_ONE=11;  // more than one trigger word in the event
+const uint16_t __DIAG_HIT_ARRAY_FULL=12;  // output hit array is full
+
 // Clusterizer definitions
 const uint32_t __MAXBCID=256;  // maximum possible BCID window width, 16 for the FE, 256 in FE stop mode
 const uint32_t __MAXTOTBINS=128;  // number of ToT bins for the cluster ToT histogram (in ToT = [0:31])
@@ -167,6 +227,7 @@ const uint32_t RAW_DATA_MAX_ROW=336;
 #define TRIGGER_FROMAT_TRIGGER_NUMBER 0  // 0: trigger word contains trigger counter
 #define TRIGGER_FROMAT_TIME_STAMP 1  // 1: trigger word contains time stamp
 #define TRIGGER_FROMAT_COMBINED 2  // 2: trigger word contains both, 2: 15bit time stamp and 16bit trigger number
+#define TRIGGER_FROMAT_INVALID 3  // not a valid trigger data format, the interpretation of a trigger word throws an exception
 
 // TDC macros
 #define __N_TDC_VALUES 4096
@@ -227,6 +288,9 @@ const uint32_t RAW_DATA_MAX_ROW=336;
 #define DATA_RECORD_COLUMN2_MACRO(X) ((DATA_RECORD_COLUMN_MASK & X) >> 17)
 #define DATA_RECORD_ROW2_MACRO(X) (((DATA_RECORD_ROW_MASK & X) >> 8) + 1)
 #define DATA_RECORD_TOT2_MACRO(X) (DATA_RECORD_TOT2_MASK & X)
+#define DATA_RECORD_HIT1_PIXEL_MACRO(X) (((DATA_RECORD_COLUMN_MASK & X) >> 17) | (DATA_RECORD_ROW_MASK & X) | ((DATA_RECORD_TOT1_MASK & X) << 20))  // column, row and ToT of the first hit packed like the column, row and tot bytes of HitInfo (little endian)
+#define DATA_RECORD_HIT2_PIXEL_MACRO(X) (((((DATA_RECORD_COLUMN_MASK & X) >> 17) | (DATA_RECORD_ROW_MASK & X)) + (1 << 8)) | ((DATA_RECORD_TOT2_MASK & X) << 24))  // column, row and ToT of the second hit packed like the column, row and tot bytes of HitInfo (little endian)
+#define DATA_RECORD_HITS_VALID_MACRO(X) (DATA_RECORD_MACRO(X) && ((DATA_RECORD_TOT1_MASK & X) != DATA_RECORD_TOT1_MASK) && (((DATA_RECORD_TOT2_MASK & X) == DATA_RECORD_TOT2_MASK) || ((DATA_RECORD_ROW_MASK & X) != DATA_RECORD_MAX_ROW)) ? true : false)  // true if data word is data record with reasonable hit infos, same checks as in getHitsfromDataRecord
 
 // Address Record (AR)
 #define ADDRESS_RECORD 0x00EA0000
@@ -270,5 +334,21 @@ const uint32_t RAW_DATA_MAX_ROW=336;
 #define SERVICE_RECORD_ETC_MACRO_FEI4B(X) ((SERVICE_RECORD_ETC_MASK_FEI4B & X) >> 4)
 #define SERVICE_RECORD_L1REQ_MACRO_FEI4B(X) (SERVICE_RECORD_L1REQ_MASK_FEI4B & X)
 
+// Word type look up table, the table index is build from the 4-bit word header and the 8-bit FE-I4 record header
+#define __N_WORD_TYPE_INDICES 4096  // number of entries of the word type look up table
+#define WORD_TYPE_INDEX_MACRO(X) (((0xF0000000 & X) >> 20) | ((0x00FF0000 & X) >> 16))  // calculates the word type look up table index from a raw data word
+#define DATA_RECORD_ROW_RANGE_MACRO(X) (((DATA_RECORD_ROW_MASK & X) <= DATA_RECORD_MAX_ROW) && ((DATA_RECORD_ROW_MASK & X) >= DATA_RECORD_MIN_ROW) ? true : false)  // the row is not part of the table index and has to be checked for data records separately
+
+// word types
+const unsigned char __UNKNOWN_WORD_TYPE=0;  // word that cannot be interpreted
+const unsigned char __DATA_HEADER_WORD_TYPE=1;  // FE-I4 data header
+const unsigned char __TRIGGER_WORD_TYPE=2;  // trigger word
+const unsigned char __SERVICE_RECORD_WORD_TYPE=3;  // FE-I4 service record
+const unsigned char __TDC_WORD_TYPE=4;  // TDC word
+const unsigned char __DATA_RECORD_WORD_TYPE=5;  // FE-I4 data record
+const unsigned char __ADDRESS_RECORD_WORD_TYPE=6;  // FE-I4 address record
+const unsigned char __VALUE_RECORD_WORD_TYPE=7;  // FE-I4 value record
+const unsigned char __OTHER_WORD_TYPE=8;  // word from other module with one-hot header
+
 #pragma pack(pop)  // pop needed to suppress VS C4103 compiler warning
 #endif  // DEFINES_H
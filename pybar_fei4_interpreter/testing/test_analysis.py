@@ -2,13 +2,17 @@
 '''
 
 import os
+import itertools
+import math
 import unittest
+import threading
 import tables as tb
 import numpy as np
 
 from pybar_fei4_interpreter import analysis_utils
+from pybar_fei4_interpreter import analysis_functions
 from pybar_fei4_interpreter import data_struct
-from pybar_fei4_interpreter.data_interpreter import PyDataInterpreter
+from pybar_fei4_interpreter.data_interpreter import PyDataInterpreter, PyOnlineInterpreter
 from pybar_fei4_interpreter.data_histograming import PyDataHistograming
 
 
@@ -80,6 +84,25 @@ def get_col_row_tot_array_from_data_record_array(array):  # TODO: max ToT
     return col_row_tot_array_filtered[:, 0], col_row_tot_array_filtered[:, 1], col_row_tot_array_filtered[:, 2]  # column, row, ToT
 
 
+def get_three_events_raw_data():  # three events with trigger numbers 1 to 3 and one data header each, the events have 3, 2 and 0 hits
+    return np.array([0x80000001, 0x00E90000] + [(column << 17) | (1 << 8) | (1 << 4) | 0xF for column in range(1, 4)] +
+                    [0x80000002, 0x00E90001, (5 << 17) | (2 << 8) | 0x23, 0x80000003, 0x00E90002], np.uint32)
+
+
+def get_three_events_interpreter():  # interpreter for the raw data of get_three_events_raw_data
+    interpreter = PyDataInterpreter()
+    interpreter.set_trig_count(1)
+    interpreter.set_warning_output(False)
+    return interpreter
+
+
+def get_three_events_hits():  # hits of the raw data of get_three_events_raw_data interpreted without options
+    interpreter = get_three_events_interpreter()
+    interpreter.interpret_raw_data(get_three_events_raw_data())
+    interpreter.store_event()
+    return interpreter.get_hits().copy()
+
+
 class TestAnalysis(unittest.TestCase):
 
     @classmethod
@@ -162,6 +185,62 @@ class TestAnalysis(unittest.TestCase):
         occ_hist_python, _, _ = np.histogram2d(col_arr, row_arr, bins=(80, 336), range=[[1, 80], [1, 336]])
         self.assertTrue(np.all(occ_hist_cpp == occ_hist_python))
 
+    def test_interpretation_options(self):  # check every interpretation kernel selected by the options with the same events
+        def get_raw_data(tdc_first):
+            raw_data = []
+            for event in range(5):
+                trigger_word = 0x80000000 | (5 << 16) | event  # 5 is the time stamp of the combined trigger data format
+                tdc_word = 0x40000000 | (10 << 20) | ((7 + event) << 12) | (100 + event)  # trigger distance 10, short time stamp 7 + event
+                raw_data.extend([tdc_word, trigger_word] if tdc_first else [trigger_word, tdc_word])
+                for bcid in range(16):
+                    raw_data.append(0x00E90000 | (4 << 8) | (16 * event + bcid))  # LVL1ID 4 for FE-I4A, 1 for FE-I4B
+                    if bcid == 0:
+                        raw_data.extend([((event + 1) << 17) | (10 << 8) | ((event + 2) << 4) | 0xF, 0x00EF0000 | (10 << 10) | 1])
+                    elif bcid == 3:
+                        raw_data.extend([(40 << 17) | ((100 + event) << 8) | (3 << 4) | 5, (80 << 17) | (336 << 8) | (1 << 4) | 0xF])
+            return np.array(raw_data, dtype=np.uint32)
+
+        for fei4b, trigger_data_format, tdc_trigger_time_stamp, tdc_trigger_distance, alignment, debug_events in itertools.product((False, True), (0, 1, 2), (False, True), (False, True), (None, 'trigger', 'tdc'), (False, True)):
+            interpreter = PyDataInterpreter()
+            interpreter.set_warning_output(False)
+            interpreter.set_FEI4B(fei4b)
+            interpreter.set_trigger_data_format(trigger_data_format)
+            interpreter.set_tdc_trigger_time_stamp(tdc_trigger_time_stamp)
+            interpreter.set_tdc_trigger_distance(tdc_trigger_distance)
+            interpreter.align_at_trigger(alignment == 'trigger')
+            interpreter.align_at_tdc(alignment == 'tdc')
+            if debug_events:
+                interpreter.debug_events(100, 100)  # kernel with event debugging, no event in range
+            interpreter.interpret_raw_data(get_raw_data(tdc_first=alignment == 'tdc'))
+            interpreter.store_event()
+            hits = interpreter.get_hits()
+            options = (fei4b, trigger_data_format, tdc_trigger_time_stamp, tdc_trigger_distance, alignment, debug_events)
+
+            self.assertEqual(interpreter.get_n_events(), 5, options)
+            self.assertEqual(interpreter.get_n_hits(), 20, options)
+            self.assertListEqual(hits['event_number'].tolist(), np.repeat(np.arange(5), 4).tolist(), options)
+            self.assertListEqual(hits['column'].tolist(), [1, 40, 40, 80, 2, 40, 40, 80, 3, 40, 40, 80, 4, 40, 40, 80, 5, 40, 40, 80], options)
+            self.assertListEqual(hits['row'].tolist(), [10, 100, 101, 336, 10, 101, 102, 336, 10, 102, 103, 336, 10, 103, 104, 336, 10, 104, 105, 336], options)
+            self.assertListEqual(hits['tot'].tolist(), [2, 3, 5, 1, 3, 3, 5, 1, 4, 3, 5, 1, 5, 3, 5, 1, 6, 3, 5, 1], options)
+            self.assertListEqual(hits['relative_BCID'].tolist(), [0, 3, 3, 3] * 5, options)
+            self.assertListEqual(hits['BCID'].tolist(), (np.repeat(16 * np.arange(5), 4) + [0, 3, 3, 3] * 5).tolist(), options)
+            self.assertTrue(np.all(hits['LVL1ID'] == (1 if fei4b else 4)), options)
+            expected_trigger_number = {0: (5 << 16) + np.arange(5), 1: np.zeros(5), 2: np.arange(5)}[trigger_data_format]
+            expected_trigger_time_stamp = {0: np.zeros(5), 1: (5 << 16) + np.arange(5), 2: np.full(5, 5)}[trigger_data_format]
+            self.assertListEqual(hits['trigger_number'].tolist(), np.repeat(expected_trigger_number, 4).tolist(), options)
+            self.assertListEqual(hits['trigger_time_stamp'].tolist(), np.repeat(expected_trigger_time_stamp, 4).tolist(), options)
+            self.assertListEqual(hits['TDC'].tolist(), np.repeat(100 + np.arange(5), 4).tolist(), options)
+            if tdc_trigger_time_stamp:
+                expected_tdc_time_stamp = 7 + np.arange(5) + (0 if tdc_trigger_distance else (10 << 8))
+            else:
+                expected_tdc_time_stamp = np.zeros(5)
+            self.assertListEqual(hits['TDC_time_stamp'].tolist(), np.repeat(expected_tdc_time_stamp, 4).tolist(), options)
+            self.assertTrue(np.all(hits['TDC_trigger_distance'] == (10 if tdc_trigger_distance else 0)), options)
+            self.assertTrue(np.all(hits['event_status'] == 8449), options)  # service record, TDC word and more than one hit
+            self.assertTrue(np.all(hits['trigger_status'] == 0), options)
+            self.assertEqual(interpreter.get_service_records_counters()[10], 5, options)
+            self.assertListEqual(interpreter.get_tdc_values()[100:105].tolist(), [1] * 5, options)
+
     def test_trigger_data_format(self):
         raw_data = np.array([3611295745, 82411778, 82793472, 82411779, 82794496, 82411780, 82795520, 82379013, 82379014, 82379015, 82379016, 67240383, 82379017, 82379018, 82379019, 82379020, 82379021, 82379022, 82379023, 82379024, 82379025,
                              3611361282, 82380701, 82380702, 82380703, 82380704, 82380705, 82380706, 82380707, 67240383, 82380708, 82380709, 82380710, 82380711, 82380712, 82380713, 82380714, 82380715, 82380716,
@@ -194,6 +273,760 @@ class TestAnalysis(unittest.TestCase):
             self.assertTrue(np.all(hits["trigger_number"] == trigger_number_ref))
             self.assertTrue(np.all(hits["trigger_time_stamp"] == trigger_time_stamp_ref))
 
+    def test_diagnostic_records(self):  # check the diagnostic records ring buffer
+        raw_data = np.array([0, 1, 2], np.uint32)  # unknown words
+        interpreter = PyDataInterpreter()
+        interpreter.set_warning_output(False)
+        interpreter.set_diagnostic_records_size(2)
+        interpreter.interpret_raw_data(raw_data)
+        records = interpreter.get_diagnostic_records()
+        self.assertEqual(interpreter.get_n_diagnostic_records(), 3)
+        self.assertListEqual([2, 3], records['word_index'].tolist())  # oldest record is overwritten
+        self.assertListEqual([1, 2], records['raw_word'].tolist())
+        self.assertListEqual([9, 9], records['code'].tolist())
+        self.assertEqual(len(interpreter.get_diagnostic_messages()), 2)
+
+    def test_hit_buffer_size(self):  # check the growing event hit buffer and the truncation of events with too many hits
+        raw_data = np.array([0x00E90000] + [(column << 17) | (1 << 8) | (1 << 4) | 0xF for column in range(1, 11)], np.uint32)  # data header and 10 hits
+        interpreter = PyDataInterpreter()
+        interpreter.set_trig_count(1)
+        interpreter.set_warning_output(False)
+        self.assertEqual(interpreter.get_hit_buffer_size(), 0)  # allocated when needed
+        interpreter.interpret_raw_data(raw_data)
+        interpreter.store_event()
+        self.assertEqual(interpreter.get_hits().shape[0], 10)
+        self.assertGreaterEqual(interpreter.get_hit_buffer_size(), 10)
+        interpreter.reset()
+        interpreter.set_max_hit_buffer_size(4)
+        self.assertEqual(interpreter.get_hit_buffer_size(), 4)
+        interpreter.interpret_raw_data(raw_data)
+        interpreter.store_event()
+        hits = interpreter.get_hits()
+        self.assertListEqual([1, 2, 3, 4], hits['column'].tolist())
+        self.assertTrue(np.all(hits['event_status'] & 128 == 128))  # truncated event
+
+    def test_event_table(self):  # check that the event table and slim hit table hold the same information as the combined hit table
+        raw_data, hits = get_three_events_raw_data(), get_three_events_hits()
+        interpreter = get_three_events_interpreter()
+        interpreter.create_event_table(True)
+        interpreter.interpret_raw_data(raw_data)
+        interpreter.store_event()
+        events, slim_hits = interpreter.get_events(), interpreter.get_slim_hits()
+        self.assertIsNone(interpreter.get_hits())  # the hits are only stored into the slim hit table
+        self.assertListEqual([0, 1, 2], events['event_number'].tolist())
+        self.assertListEqual([3, 2, 0], events['n_hits'].tolist())
+        self.assertListEqual([0, 3, 5], events['hit_index'].tolist())
+        self.assertListEqual([1, 2, 3], events['trigger_number'].tolist())
+        for name in slim_hits.dtype.names:
+            self.assertTrue(np.all(slim_hits[name] == hits[name]))
+        for name in events.dtype.names[:-2]:
+            self.assertTrue(np.all(np.repeat(events[name], events['n_hits']) == hits[name]))
+
+    def test_caller_owned_hit_array(self):  # check that the interpretation into a small caller owned hit array resumes at the event boundary
+        raw_data, hits = get_three_events_raw_data(), get_three_events_hits()
+        interpreter = get_three_events_interpreter()
+        interpreter.set_hits_array(np.zeros(3, dtype=tb.dtype_from_descr(data_struct.HitInfoTable)))
+        hit_chunks, n_words = [], 0
+        while n_words < raw_data.shape[0]:
+            _, n_interpreted_words = interpreter.interpret_raw_data(raw_data[n_words:])
+            n_words += n_interpreted_words
+            hit_chunks.append(interpreter.get_hits().copy())
+        self.assertEqual(len(hit_chunks), 2)  # the second event does not fit anymore
+        interpreter.store_event()
+        while interpreter.get_n_pending_events():
+            interpreter.interpret_raw_data(raw_data[:0])
+            hit_chunks.append(interpreter.get_hits().copy())
+        self.assertTrue(np.all(np.concatenate(hit_chunks) == hits))
+        self.assertEqual(interpreter.get_n_hits(), 5)
+
+    def test_parallel_interpretation(self):  # check that the parallel interpretation gives the same result as the serial interpretation
+        raw_data = []
+        for trigger_number in range(0, 600, 3):
+            raw_data.extend([0x80000000 | trigger_number, 0x00E90000] + [(column << 17) | (1 << 8) | (1 << 4) | 0xF for column in range(1, 4)] +
+                            [0x80000000 | (trigger_number + 1), 0x00E90001, (5 << 17) | (2 << 8) | 0x23, 0x80000000 | (trigger_number + 2), 0x00E90002])
+        raw_data = np.array(raw_data, np.uint32)
+        results = []
+        for n_threads in (1, 4):
+            interpreter = PyDataInterpreter()
+            interpreter.set_trig_count(1)
+            interpreter.set_warning_output(False)
+            interpreter.set_n_threads(n_threads, min_words_per_thread=100)
+            interpreter.interpret_raw_data(raw_data)
+            interpreter.store_event()
+            results.append((interpreter.get_hits().copy(), interpreter.get_n_events(), interpreter.get_n_hits(), interpreter.get_event_status_counters().copy()))
+            self.assertEqual(interpreter.get_n_parallel_reruns(), 0)
+        self.assertTrue(np.all(results[0][0] == results[1][0]))
+        self.assertEqual(results[0][1:3], results[1][1:3])
+        self.assertTrue(np.all(results[0][3] == results[1][3]))
+
+        # events with 16 data headers, the chunks start at read outs given by the meta data and more than the warm up words after the data start
+        raw_data, read_out_starts = [], []
+        for event in range(4000):
+            if event % 20 == 0:
+                read_out_starts.append(len(raw_data))
+            raw_data.append(0x80000000 | event)
+            for data_header in range(16):
+                raw_data.append(0x00E90000 | ((event & 0x7F) << 10) | ((event * 16 + data_header) & 0x3FF))
+                if (event + data_header) % 5 == 0:
+                    raw_data.append(((data_header + 1) << 17) | ((event % 336 + 1) << 8) | (1 << 4) | 0xF)
+        raw_data = np.array(raw_data, np.uint32)
+        meta_data = np.zeros(shape=(len(read_out_starts), ), dtype=tb.dtype_from_descr(data_struct.MetaTableV2))
+        meta_data['index_start'] = read_out_starts
+        meta_data['index_stop'] = read_out_starts[1:] + [raw_data.shape[0]]
+        meta_data['data_length'] = meta_data['index_stop'] - meta_data['index_start']
+        results = []
+        for n_threads in (1, 4):
+            interpreter = PyDataInterpreter()
+            interpreter.set_trig_count(16)
+            interpreter.set_FEI4B(True)
+            interpreter.set_warning_output(False)
+            interpreter.set_meta_data(meta_data)
+            meta_event_index = np.zeros(shape=(meta_data.shape[0], ), dtype=np.uint64)
+            interpreter.set_meta_event_data(meta_event_index)
+            interpreter.set_n_threads(n_threads, min_words_per_thread=10000)
+            interpreter.interpret_raw_data(raw_data)
+            interpreter.store_event()
+            results.append((interpreter.get_hits().copy(), meta_event_index, interpreter.get_n_events(), interpreter.get_n_hits()))
+            self.assertEqual(interpreter.get_n_parallel_reruns(), 0)
+        self.assertEqual(results[0][2:], (4000, 12800))
+        self.assertTrue(np.all(results[0][0] == results[1][0]))
+        self.assertTrue(np.all(results[0][1] == results[1][1]))
+        self.assertEqual(results[0][2:], results[1][2:])
+
+        results = []
+        for n_threads in (1, 4):  # the hit array is full in the last chunk, the parallel interpretation fails at the same hit
+            interpreter = PyDataInterpreter()
+            interpreter.set_trig_count(16)
+            interpreter.set_FEI4B(True)
+            interpreter.set_warning_output(False)
+            interpreter.set_error_output(False)
+            interpreter.set_hits_array_size(10000)
+            interpreter.set_n_threads(n_threads, min_words_per_thread=10000)
+            self.assertRaises(IndexError, interpreter.interpret_raw_data, raw_data)
+            results.append((interpreter.get_hits().copy(), interpreter.get_n_events(), interpreter.get_n_hits()))
+        self.assertEqual(results[0][0].shape[0], 10000)
+        self.assertTrue(np.all(results[0][0] == results[1][0]))
+        self.assertEqual(results[0][1:], results[1][1:])
+
+    def test_event_callback(self):  # check that the event callback gets the same events and hits as the hit array
+        raw_data, hits = get_three_events_raw_data(), get_three_events_hits()
+        events, callback_hits = [], []
+
+        def callback(event_info, event_hits):
+            events.append((event_info['event_number'], event_info['trigger_number'], event_info['n_hits']))
+            callback_hits.append(event_hits.copy())  # the views are only valid during the call
+
+        interpreter = get_three_events_interpreter()
+        interpreter.set_event_callback(callback, store_hits=False)
+        interpreter.interpret_raw_data(raw_data)
+        interpreter.store_event()
+        self.assertListEqual(events, [(0, 1, 3), (1, 2, 2), (2, 3, 0)])
+        callback_hits = np.concatenate(callback_hits)
+        for name in ('event_number', 'relative_BCID', 'column', 'row', 'tot'):  # the event values are in the event infos
+            self.assertTrue(np.all(callback_hits[name] == hits[name]))
+        self.assertEqual(interpreter.get_n_array_hits(), 0)  # hits are not stored
+        self.assertEqual(interpreter.get_n_hits(), 5)
+
+    def test_snapshot_in_event_callback(self):  # check that the filling thread can take histogram snapshots between events
+        histograming = PyDataHistograming()
+        histograming.create_occupancy_hist(True)
+        histograming.set_no_scan_parameter()
+        n_hits = []
+
+        def callback(event_info, event_hits):
+            histograming.take_snapshot()  # called by the thread that fills the histograms
+            n_hits.append(histograming.get_occupancy(snapshot=True).sum())
+
+        interpreter = get_three_events_interpreter()
+        interpreter.set_histogram(histograming, store_hits=False)
+        interpreter.set_event_callback(callback, store_hits=False)
+        interpreter.interpret_raw_data(get_three_events_raw_data())
+        interpreter.store_event()
+        self.assertListEqual(n_hits, [0, 3, 5])  # the event is histogrammed after its callback
+        self.assertEqual(histograming.get_occupancy().sum(), 5)
+
+    def test_fused_histograming(self):  # check that the histograms filled by the interpreter are the same as the histograms of the stored hits
+        raw_data, meta_data = [], []
+        for read_out in range(3):  # one scan parameter per read out with read_out + 1 hits per event
+            start_index = len(raw_data)
+            for trigger_number in range(read_out * 10, (read_out + 1) * 10):
+                raw_data.extend([0x80000000 | trigger_number, 0x00E90000 | read_out] + [(column << 17) | ((read_out + 1) << 8) | (column << 4) | 0xF for column in range(1, read_out + 2)])
+            meta_data.append((start_index, len(raw_data), len(raw_data) - start_index, 0., 0., 0))
+        raw_data = np.array(raw_data, np.uint32)
+        meta_data = np.array(meta_data, dtype=tb.dtype_from_descr(data_struct.MetaTableV2))
+        scan_parameter = np.arange(3, dtype=np.int32)
+        results = []
+        for fused in (False, True):
+            interpreter = PyDataInterpreter()
+            histograming = PyDataHistograming()
+            interpreter.set_trig_count(1)
+            interpreter.set_warning_output(False)
+            meta_event_index = np.zeros(shape=(meta_data.shape[0], ), dtype=np.uint64)
+            interpreter.set_meta_data(meta_data)
+            interpreter.set_meta_event_data(meta_event_index)
+            histograming.create_occupancy_hist(True)
+            histograming.create_tot_hist(True)
+            histograming.create_rel_bcid_hist(True)
+            histograming.add_scan_parameter(scan_parameter)
+            if fused:
+                interpreter.set_histogram(histograming, store_hits=False)
+            interpreter.interpret_raw_data(raw_data)
+            interpreter.store_event()
+            if fused:
+                self.assertEqual(interpreter.get_n_array_hits(), 0)  # hits are not stored
+            else:
+                histograming.add_meta_event_index(meta_event_index, interpreter.get_n_meta_data_event())
+                histograming.add_hits(interpreter.get_hits())
+            results.append((interpreter.get_n_hits(), histograming.get_occupancy().copy(), histograming.get_tot_hist().copy(), histograming.get_rel_bcid_hist().copy()))
+        self.assertEqual(results[0][0], 60)
+        self.assertListEqual(results[1][1].sum(axis=(0, 1)).tolist(), [10, 20, 30])
+        self.assertEqual(results[1][1][2, 2, 2], 10)
+        for result, fused_result in zip(results[0], results[1]):
+            self.assertTrue(np.all(result == fused_result))
+
+    def test_fused_histograming_last_row(self):  # the second hit of a data record in the last row with TOT2 = 15 is in row 337 with max ToT 15
+        raw_data = np.array([0x80000000, 0x00E90000, (10 << 17) | (336 << 8) | (5 << 4) | 0xF], np.uint32)
+        for max_tot in (14, 15):
+            for fused in (False, True):
+                interpreter = PyDataInterpreter()
+                histograming = PyDataHistograming()
+                interpreter.set_trig_count(1)
+                interpreter.set_warning_output(False)
+                interpreter.set_max_tot(max_tot)
+                histograming.set_max_tot(max_tot)
+                histograming.create_occupancy_hist(True)
+                histograming.set_no_scan_parameter()
+                if fused:
+                    interpreter.set_histogram(histograming, store_hits=False)
+                interpreter.interpret_raw_data(raw_data)
+                if max_tot == 15 and fused:  # row 337 is out of range for the histograms
+                    self.assertRaises(IndexError, interpreter.store_event)
+                    continue
+                interpreter.store_event()
+                if max_tot == 15:
+                    self.assertRaises(IndexError, histograming.add_hits, interpreter.get_hits())
+                    continue
+                if not fused:
+                    histograming.add_hits(interpreter.get_hits())
+                self.assertEqual(histograming.get_occupancy().sum(), 1)
+                self.assertEqual(histograming.get_occupancy()[9, 335, 0], 1)
+
+    def test_occupancy_counting(self):  # check that the occupancy counting without event building gives the same occupancy as the interpretation
+        raw_data, meta_data = [], []
+        for read_out in range(3):  # one scan parameter per read out
+            start_index = len(raw_data)
+            for trigger_number in range(read_out * 10, (read_out + 1) * 10):
+                raw_data.extend([0x80000000 | trigger_number, 0x00E90000 | read_out] + [(column << 17) | ((read_out + 1) << 8) | (column << 4) | (0xF if column % 2 else 0xE) for column in range(1, read_out + 3)] + [0x00E90001 | read_out])
+            meta_data.append((start_index, len(raw_data), len(raw_data) - start_index, 0., 0., 0))
+        raw_data = np.array(raw_data, np.uint32)
+        meta_data = np.array(meta_data, dtype=tb.dtype_from_descr(data_struct.MetaTableV2))
+        scan_parameter = np.arange(3, dtype=np.int32)
+        results = []
+        for counting in (False, True):
+            interpreter = PyDataInterpreter()
+            histograming = PyDataHistograming()
+            interpreter.set_trig_count(2)
+            interpreter.set_max_tot(14)
+            interpreter.set_warning_output(False)
+            interpreter.set_meta_data(meta_data)
+            histograming.create_occupancy_hist(True)
+            histograming.add_scan_parameter(scan_parameter)
+            interpreter.set_histogram(histograming, store_hits=False)
+            if counting:
+                interpreter.histogram_occupancy(raw_data[:100])  # read outs are continued in the next call
+                interpreter.histogram_occupancy(raw_data[100:])
+                self.assertEqual(interpreter.get_n_events(), 0)  # no event building
+            else:
+                interpreter.set_meta_event_data(np.zeros(shape=(meta_data.shape[0], ), dtype=np.uint64))
+                interpreter.interpret_raw_data(raw_data)
+                interpreter.store_event()
+            results.append((interpreter.get_n_hits(), histograming.get_occupancy().copy()))
+        self.assertEqual(results[0][0], 130)
+        self.assertEqual(results[0][0], results[1][0])
+        self.assertTrue(np.all(results[0][1] == results[1][1]))
+        self.assertListEqual(results[1][1].sum(axis=(0, 1)).tolist(), [20, 30, 40])  # ToT 14 hits are above the histogram maximum ToT
+
+    def test_occupancy_counting_last_row(self):  # the second hit of a data record in the last row with TOT2 = 15 is in row 337 with max ToT 15
+        raw_data = np.array([0x80000000, 0x00E90000, (10 << 17) | (336 << 8) | (5 << 4) | 0xF, (11 << 17) | (335 << 8) | (5 << 4) | 0xF], np.uint32)
+        interpreter = PyDataInterpreter()
+        histograming = PyDataHistograming()
+        interpreter.set_warning_output(False)
+        interpreter.set_max_tot(15)
+        histograming.set_max_tot(15)
+        histograming.create_occupancy_hist(True)
+        histograming.set_no_scan_parameter()
+        interpreter.set_histogram(histograming, store_hits=False)
+        interpreter.histogram_occupancy(raw_data)
+        self.assertEqual(interpreter.get_n_hits(), 4)
+        occupancy = histograming.get_occupancy()
+        self.assertEqual(occupancy.sum(), 3)
+        self.assertEqual(occupancy[9, 335, 0], 1)
+        self.assertEqual(occupancy[10, 334, 0], 1)
+        self.assertEqual(occupancy[10, 335, 0], 1)  # the second hit of a data record below the last row is histogrammed
+
+    def test_online_interpretation(self):  # check that the interpretation of queued chunks in the worker thread gives the same result as the interpretation
+        raw_data = []
+        for trigger_number in range(1000):
+            raw_data.extend([0x80000000 | trigger_number, 0x00E90000] + [(column << 17) | ((trigger_number % 300 + 1) << 8) | (column << 4) | 0xF for column in range(1, trigger_number % 5 + 2)])
+        raw_data = np.array(raw_data, np.uint32)
+        results = []
+        for online in (False, True):
+            interpreter = PyDataInterpreter()
+            histograming = PyDataHistograming()
+            interpreter.set_trig_count(1)
+            interpreter.set_warning_output(False)
+            histograming.create_occupancy_hist(True)
+            histograming.set_no_scan_parameter()
+            if online:
+                online_interpreter = PyOnlineInterpreter(interpreter, histograming)
+                self.assertTrue(online_interpreter.add_raw_data(raw_data[:1000]))  # chunks can be queued before the worker runs
+                online_interpreter.start()
+                for index in range(1000, raw_data.shape[0], 1000):
+                    while not online_interpreter.add_raw_data(raw_data[index:index + 1000]):
+                        pass
+                    online_interpreter.get_status()  # polling while the worker interprets
+                online_interpreter.wait()
+                online_interpreter.stop()
+                status = online_interpreter.get_status()
+                self.assertEqual(status['n_chunks'], online_interpreter.get_n_added_chunks())
+                self.assertEqual(status['n_words'], raw_data.shape[0])
+                self.assertEqual(status['n_events'], 999)  # the last event is stored by store_event
+            else:
+                interpreter.set_histogram(histograming, store_hits=False)
+                interpreter.interpret_raw_data(raw_data)
+            interpreter.store_event()
+            results.append((interpreter.get_n_events(), interpreter.get_n_hits(), histograming.get_occupancy().copy()))
+        self.assertEqual(results[0][1], 3000)
+        self.assertEqual(results[0][:2], results[1][:2])
+        self.assertTrue(np.all(results[0][2] == results[1][2]))
+
+    def test_histogram_snapshot(self):  # check that the snapshots taken while another thread fills the histograms are consistent
+        hits = np.zeros(shape=(1000, ), dtype=tb.dtype_from_descr(data_struct.HitInfoTable))
+        hits['column'] = np.arange(1000) % 80 + 1
+        hits['row'] = np.arange(1000) % 336 + 1
+        hits['tot'] = np.arange(1000) % 14
+        histograming = PyDataHistograming()
+        histograming.create_occupancy_hist(True)
+        histograming.create_tot_hist(True)
+        histograming.create_mean_tot_hist(True)
+        histograming.create_tot_pixel_hist(True)
+        histograming.set_no_scan_parameter()
+
+        def fill():
+            for _ in range(2000):
+                histograming.add_hits(hits)
+
+        fill_thread = threading.Thread(target=fill)
+        fill_thread.start()
+        n_hits = []
+        while fill_thread.is_alive():
+            histograming.take_snapshot()
+            n_hits.append(histograming.get_occupancy(snapshot=True).sum())
+            self.assertEqual(n_hits[-1] % 1000, 0)  # only complete add_hits calls
+            self.assertEqual(histograming.get_tot_hist(snapshot=True).sum(), n_hits[-1])  # the histograms are from the same point
+            self.assertEqual(histograming.get_tot_pixel_hist(snapshot=True).sum(), n_hits[-1])
+            mean_tot = histograming.get_mean_tot(snapshot=True)
+            self.assertEqual(np.count_nonzero(~np.isnan(mean_tot)), min(n_hits[-1], 1000))
+        fill_thread.join()
+        self.assertListEqual(n_hits, sorted(n_hits))
+        histograming.take_snapshot()
+        self.assertEqual(histograming.get_occupancy(snapshot=True).sum(), 2000000)
+        self.assertTrue(np.all(histograming.get_occupancy(snapshot=True) == histograming.get_occupancy()))
+        self.assertTrue(np.all(histograming.get_tot_pixel_hist(snapshot=True) == histograming.get_tot_pixel_hist()))
+        np.testing.assert_array_equal(histograming.get_mean_tot(snapshot=True), histograming.get_mean_tot())
+
+    def test_parallel_histograming(self):  # check that the parallel histogramming gives the same histograms as the serial histogramming
+        hits = np.zeros(shape=(1000, ), dtype=tb.dtype_from_descr(data_struct.HitInfoTable))
+        hits['event_number'] = np.arange(1000) // 10
+        hits['column'] = np.arange(1000) % 80 + 1
+        hits['row'] = np.arange(1000) % 336 + 1
+        hits['tot'] = np.arange(1000) % 14
+        hits['relative_BCID'] = np.arange(1000) % 16
+        meta_event_index = np.arange(0, 100, 25).astype(np.uint64)  # four read outs with 25 events each
+        scan_parameter = np.array([0, 1, 1, 2], np.int32)
+        bad_hits = hits.copy()
+        bad_hits['column'][700] = 81
+        results = []
+        for n_threads in (1, 4):
+            histograming = PyDataHistograming()
+            histograming.set_n_threads(n_threads, min_hits_per_thread=100)
+            self.assertEqual(histograming.get_n_threads(), n_threads)
+            histograming.create_occupancy_hist(True)
+            histograming.create_tot_hist(True)
+            histograming.create_rel_bcid_hist(True)
+            histograming.create_tot_pixel_hist(True)
+            histograming.add_scan_parameter(scan_parameter)
+            histograming.add_meta_event_index(meta_event_index, meta_event_index.shape[0])
+            histograming.add_hits(hits)
+            self.assertRaises(IndexError, histograming.add_hits, bad_hits)  # the hits in front of the bad hit are histogrammed
+            results.append((histograming.get_occupancy().copy(), histograming.get_tot_hist().copy(), histograming.get_rel_bcid_hist().copy(), histograming.get_tot_pixel_hist().copy()))
+        self.assertEqual(results[0][0].shape[2], 3)
+        self.assertEqual(results[0][0].sum(), 1700)
+        for result, parallel_result in zip(results[0], results[1]):
+            self.assertTrue(np.all(result == parallel_result))
+
+    def test_mean_tot(self):  # check the mean and RMS ToT from the ToT sums against numpy for the serial, the parallel and the occupancy counting histogramming
+        tots = np.random.RandomState(0).randint(0, 14, size=4000)
+        hits = np.zeros(shape=(4000, ), dtype=tb.dtype_from_descr(data_struct.HitInfoTable))
+        hits['column'] = np.arange(4000) % 3 + 1
+        hits['row'] = 1
+        hits['tot'] = tots
+        expected_mean = [tots[column::3].mean() for column in range(3)]
+        expected_rms = [tots[column::3].std() for column in range(3)]
+        for n_threads in (1, 4):
+            histograming = PyDataHistograming()
+            histograming.set_n_threads(n_threads, min_hits_per_thread=100)
+            histograming.create_mean_tot_hist(True)
+            histograming.set_no_scan_parameter()
+            histograming.add_hits(hits)
+            mean_tot, rms_tot = histograming.get_mean_tot(), histograming.get_rms_tot()
+            np.testing.assert_allclose(mean_tot[:3, 0, 0], expected_mean, rtol=1e-6)
+            np.testing.assert_allclose(rms_tot[:3, 0, 0], expected_rms, rtol=1e-5)
+            self.assertEqual(np.count_nonzero(~np.isnan(mean_tot)), 3)  # no hits, no mean ToT
+        raw_data = np.array([0x80000000, 0x00E90000] + [((column + 1) << 17) | (1 << 8) | (tot << 4) | 0xF for column, tot in zip(np.arange(4000) % 3, tots)], np.uint32)
+        interpreter = PyDataInterpreter()
+        histograming = PyDataHistograming()
+        interpreter.set_warning_output(False)
+        histograming.create_mean_tot_hist(True)
+        histograming.set_no_scan_parameter()
+        interpreter.set_histogram(histograming, store_hits=False)
+        interpreter.histogram_occupancy(raw_data)  # the occupancy counting fills the ToT sums too
+        np.testing.assert_allclose(histograming.get_mean_tot()[:3, 0, 0], expected_mean, rtol=1e-6)
+        np.testing.assert_allclose(histograming.get_rms_tot()[:3, 0, 0], expected_rms, rtol=1e-5)
+
+    def test_scan_parameter_lookup(self):  # check that the scan parameter of the hits is found for any hit order and for read outs set after add_meta_event_index
+        hits = np.zeros(shape=(1000, ), dtype=tb.dtype_from_descr(data_struct.HitInfoTable))
+        hits['event_number'] = np.arange(1000) // 10
+        hits['column'] = 1
+        hits['row'] = 1
+        meta_event_index = np.zeros(shape=(6, ), dtype=np.uint64)  # the first two read outs have no events
+        scan_parameter = np.arange(6, dtype=np.int32)
+        results = []
+        for shuffled in (False, True):
+            histograming = PyDataHistograming()
+            histograming.create_occupancy_hist(True)
+            histograming.add_scan_parameter(scan_parameter)
+            meta_event_index[:] = 0
+            histograming.add_meta_event_index(meta_event_index, meta_event_index.shape[0])
+            meta_event_index[:4] = [0, 0, 0, 40]  # the interpreter sets the read outs while the hits are histogrammed
+            histograming.add_hits(hits[:400])
+            meta_event_index[4:] = [60, 90]
+            histograming.add_hits(np.random.RandomState(0).permutation(hits[400:]) if shuffled else hits[400:])
+            results.append(histograming.get_occupancy()[0, 0, :].tolist())
+        self.assertListEqual(results[0], [0, 0, 400, 200, 300, 100])
+        self.assertListEqual(results[0], results[1])
+
+    def test_sparse_reset(self):  # check that the sparse reset clears the histograms filled by add_hits, the parallel histogramming and the occupancy counting
+        hits = np.zeros(shape=(1000, ), dtype=tb.dtype_from_descr(data_struct.HitInfoTable))
+        hits['event_number'] = np.arange(1000) // 10
+        hits['column'] = np.arange(1000) % 7 + 1
+        hits['row'] = np.arange(1000) % 11 + 300
+        hits['tot'] = np.arange(1000) % 14
+        meta_event_index = np.arange(0, 100, 10).astype(np.uint64)
+        scan_parameter = np.arange(10, dtype=np.int32)
+        for sparse_reset, n_threads in itertools.product((False, True), (1, 4)):
+            histograming = PyDataHistograming()
+            histograming.set_n_threads(n_threads, min_hits_per_thread=100)
+            histograming.set_sparse_reset(sparse_reset)
+            self.assertEqual(histograming.get_sparse_reset(), sparse_reset)
+            histograming.create_occupancy_hist(True)
+            histograming.create_mean_tot_hist(True)
+            histograming.create_tot_pixel_hist(True)
+            results = []
+            for _ in range(2):
+                histograming.add_scan_parameter(scan_parameter)
+                histograming.add_meta_event_index(meta_event_index, meta_event_index.shape[0])
+                histograming.add_hits(hits)
+                results.append((histograming.get_occupancy().copy(), histograming.get_mean_tot().copy(), histograming.get_tot_pixel_hist().copy()))
+                histograming.reset()
+                self.assertFalse(np.any(histograming.get_occupancy()))
+                self.assertTrue(np.all(np.isnan(histograming.get_mean_tot())))
+                self.assertFalse(np.any(histograming.get_tot_pixel_hist()))
+            self.assertEqual(results[0][0].sum(), 1000)
+            for result, second_result in zip(results[0], results[1]):
+                np.testing.assert_array_equal(result, second_result)
+        raw_data = np.array([0x80000000, 0x00E90000] + [((column + 1) << 17) | ((row + 1) << 8) | 0x5F for column, row in zip(np.arange(100) % 80, np.arange(100) % 336)], np.uint32)
+        interpreter = PyDataInterpreter()
+        histograming = PyDataHistograming()
+        interpreter.set_warning_output(False)
+        histograming.set_sparse_reset(True)
+        histograming.create_mean_tot_hist(True)
+        histograming.set_no_scan_parameter()
+        interpreter.set_histogram(histograming, store_hits=False)
+        interpreter.histogram_occupancy(raw_data)  # fills the occupancy of the read out directly
+        self.assertEqual(histograming.get_occupancy().sum(), 100)
+        histograming.reset()
+        self.assertFalse(np.any(histograming.get_occupancy()))
+        self.assertTrue(np.all(np.isnan(histograming.get_mean_tot())))
+
+    def test_threshold_scan_arrays(self):  # check the fast threshold algorithm against a numpy implementation and the S-curve fit against the true thresholds
+        n_parameters, n_injections = 50, 100
+        true_mu, true_sigma = np.array([10.3, 20.7, 35.1]), np.array([1.5, 3.2, 2.1])
+        parameters = np.arange(n_parameters)
+        s_curves = np.array([np.round(n_injections / 2. * (1 + np.array([math.erf(x) for x in (parameters - mu) / (np.sqrt(2) * sigma)]))) for mu, sigma in zip(true_mu, true_sigma)]).astype(np.int64)
+        pixel, parameter = np.nonzero(s_curves)
+        n_hits = s_curves[pixel, parameter]
+        hits = np.zeros(shape=(n_hits.sum(), ), dtype=tb.dtype_from_descr(data_struct.HitInfoTable))
+        hits['event_number'] = np.repeat(parameter, n_hits)  # one event per parameter
+        hits['column'] = np.repeat(pixel, n_hits) * 30 + 1
+        hits['row'] = np.repeat(pixel, n_hits) * 100 + 1
+        expected_mu = np.full(shape=(80 * 336, ), fill_value=n_parameters - 0.5)  # no hits
+        expected_sigma = np.zeros(shape=(80 * 336, ))
+        for index, s_curve in enumerate(s_curves):
+            pixel_index = index * 30 + index * 100 * 80
+            expected_mu[pixel_index] = n_parameters - 1 + 0.5 - s_curve.sum() / float(n_injections)
+            expected_sigma[pixel_index] = (np.where(parameters < expected_mu[pixel_index], s_curve, n_injections - s_curve)).sum() / float(n_injections) * np.sqrt(np.pi / 2)
+        results = []
+        for n_threads, fit_s_curves in itertools.product((1, 4), (False, True)):
+            histograming = PyDataHistograming()
+            histograming.set_n_threads(n_threads)
+            histograming.create_occupancy_hist(True)
+            histograming.add_scan_parameter(parameters.astype(np.int32))
+            histograming.add_meta_event_index(parameters.astype(np.uint64), n_parameters)
+            histograming.add_hits(hits)
+            mu, sigma = np.zeros(shape=(80 * 336, ), dtype=np.float64), np.zeros(shape=(80 * 336, ), dtype=np.float64)
+            histograming.calculate_threshold_scan_arrays(mu, sigma, n_injections, 0, n_parameters - 1, fit_s_curves=fit_s_curves)
+            results.append((mu, sigma))
+            pixel_indices = np.arange(3) * 30 + np.arange(3) * 100 * 80
+            if fit_s_curves:
+                np.testing.assert_allclose(mu[pixel_indices], true_mu, atol=0.1)  # the S-curves are rounded
+                np.testing.assert_allclose(sigma[pixel_indices], true_sigma, atol=0.2)
+                mu[pixel_indices], sigma[pixel_indices] = expected_mu[pixel_indices], expected_sigma[pixel_indices]  # the other pixels have the fast algorithm values
+            np.testing.assert_allclose(mu, expected_mu, rtol=1e-12)
+            np.testing.assert_allclose(sigma, expected_sigma, rtol=1e-12)
+        for result, parallel_result in zip(results[:2], results[2:]):
+            self.assertTrue(np.all(result[0] == parallel_result[0]) and np.all(result[1] == parallel_result[1]))
+
+    def test_threshold_scan_estimates(self):  # check the threshold estimates during the scan against the batch calculation
+        n_parameters, n_injections = 50, 100
+        true_mu, true_sigma = np.array([10.3, 20.7, 35.1]), np.array([1.5, 3.2, 2.1])
+        parameters = np.arange(n_parameters)
+        s_curves = np.array([np.round(n_injections / 2. * (1 + np.array([math.erf(x) for x in (parameters - mu) / (np.sqrt(2) * sigma)]))) for mu, sigma in zip(true_mu, true_sigma)]).astype(np.int64)
+        pixel_indices = np.arange(3) * 30 + np.arange(3) * 100 * 80
+        histograming = PyDataHistograming()
+        histograming.create_occupancy_hist(True)
+        histograming.add_scan_parameter(parameters.astype(np.int32))
+        histograming.add_meta_event_index(parameters.astype(np.uint64), n_parameters)
+        mu, sigma = np.zeros(shape=(80 * 336, ), dtype=np.float64), np.zeros(shape=(80 * 336, ), dtype=np.float64)
+        for step in range(n_parameters):  # one event per scan step
+            pixel = np.nonzero(s_curves[:, step])[0]
+            n_hits = s_curves[pixel, step]
+            hits = np.zeros(shape=(n_hits.sum(), ), dtype=tb.dtype_from_descr(data_struct.HitInfoTable))
+            hits['event_number'] = step
+            hits['column'] = np.repeat(pixel, n_hits) * 30 + 1
+            hits['row'] = np.repeat(pixel, n_hits) * 100 + 1
+            histograming.add_hits(hits)
+            histograming.set_threshold_scan_steps(step + 1)
+            if step == 29:
+                histograming.calculate_threshold_scan_estimates(mu, sigma, n_injections, 0, n_parameters - 1)
+                step_mu, step_sigma = mu[pixel_indices], sigma[pixel_indices]
+        self.assertEqual(histograming.get_threshold_scan_steps(), n_parameters)
+        histograming.calculate_threshold_scan_estimates(mu, sigma, n_injections, 0, n_parameters - 1)
+        batch_mu, batch_sigma = np.zeros(shape=(80 * 336, ), dtype=np.float64), np.zeros(shape=(80 * 336, ), dtype=np.float64)
+        histograming.calculate_threshold_scan_arrays(batch_mu, batch_sigma, n_injections, 0, n_parameters - 1)
+        np.testing.assert_allclose(mu, batch_mu, rtol=1e-12)
+        np.testing.assert_allclose(sigma, batch_sigma, rtol=1e-12)
+        np.testing.assert_allclose(step_mu[0], batch_mu[pixel_indices[0]], rtol=1e-12)  # the S-curve is complete after 30 steps
+        np.testing.assert_allclose(step_sigma[0], batch_sigma[pixel_indices[0]], rtol=1e-12)
+        self.assertEqual(step_mu[2], 29.5)  # no hits yet
+        self.assertEqual(step_sigma[2], 0)
+        histograming.set_threshold_scan_steps(1)  # the steps are accumulated again
+        self.assertEqual(histograming.get_threshold_scan_steps(), 1)
+        histograming.reset()
+        self.assertEqual(histograming.get_threshold_scan_steps(), 0)
+
+    def test_merge_and_serialize(self):  # check that the histograms of several workers exchanged as bytes and merged are the histograms of all hits
+        hits = np.zeros(shape=(30000, ), dtype=tb.dtype_from_descr(data_struct.HitInfoTable))
+        random_state = np.random.RandomState(0)
+        hits['event_number'] = np.arange(30000) // 10
+        hits['column'] = random_state.randint(1, 81, size=30000)
+        hits['row'] = random_state.randint(1, 337, size=30000)
+        hits['tot'] = random_state.randint(0, 14, size=30000)
+        hits['relative_BCID'] = random_state.randint(0, 16, size=30000)
+        hits['TDC'] = random_state.randint(0, 4096, size=30000)
+        hits['TDC_trigger_distance'] = random_state.randint(0, 256, size=30000)
+        hits['event_status'] = 256
+        meta_event_index = np.arange(0, 3000, 300).astype(np.uint64)
+        scan_parameter = np.arange(10, dtype=np.int32)
+
+        def create_histograming(sparse_reset=False):
+            histograming = PyDataHistograming()
+            histograming.set_sparse_reset(sparse_reset)
+            histograming.create_occupancy_hist(True)
+            histograming.create_mean_tot_hist(True)
+            histograming.create_tot_hist(True)
+            histograming.create_rel_bcid_hist(True)
+            histograming.create_tdc_value_hist(True)
+            histograming.create_tdc_trigger_distance_hist(True)
+            histograming.create_tot_pixel_hist(True)
+            histograming.create_tdc_pixel_hist(True)
+            histograming.set_tdc_pixel_hist_range(0, 4096, 64)
+            histograming.add_scan_parameter(scan_parameter)
+            histograming.add_meta_event_index(meta_event_index, meta_event_index.shape[0])
+            return histograming
+
+        def get_histograms(histograming):
+            return [histograming.get_occupancy().copy(), histograming.get_mean_tot().copy(), histograming.get_rms_tot().copy(), histograming.get_tot_hist().copy(), histograming.get_rel_bcid_hist().copy(), histograming.get_tdc_value_hist().copy(),
+                    histograming.get_tdc_trigger_distance_hist().copy(), histograming.get_tot_pixel_hist().copy(), histograming.get_tdc_pixel_hist().copy()]
+
+        all_histograming = create_histograming()
+        all_histograming.add_hits(hits)
+        all_histograming.set_threshold_scan_steps(4)
+        data = []
+        for worker, worker_hits in enumerate((hits[:8000], hits[8000:20000], hits[20000:])):  # the workers histogram parts of the run
+            histograming = create_histograming(sparse_reset=worker == 1)
+            histograming.add_hits(worker_hits)
+            histograming.set_threshold_scan_steps(4)
+            data.append(histograming.serialize())
+        self.assertLess(len(data[0]), 80 * 336 * 10 * 4)  # smaller than the dense occupancy
+        merged_histograming = PyDataHistograming()
+        merged_histograming.deserialize(data[0])
+        for worker_data in data[1:]:
+            histograming = PyDataHistograming()
+            histograming.deserialize(worker_data)
+            merged_histograming.merge(histograming)
+        self.assertEqual(merged_histograming.get_threshold_scan_steps(), 4)
+        for histogram, merged_histogram in zip(get_histograms(all_histograming), get_histograms(merged_histograming)):
+            np.testing.assert_array_equal(histogram, merged_histogram)
+        deserialized_histograming = PyDataHistograming()
+        deserialized_histograming.deserialize(merged_histograming.serialize())
+        self.assertEqual(deserialized_histograming.serialize(), all_histograming.serialize())
+
+        histograming = PyDataHistograming()
+        histograming.create_occupancy_hist(True)
+        histograming.set_no_scan_parameter()
+        with self.assertRaises(ValueError):  # different scan parameters
+            merged_histograming.merge(histograming)
+        with self.assertRaises(ValueError):  # corrupt data
+            histograming.deserialize(data[0][:-10])
+        self.assertFalse(np.any(histograming.get_occupancy()))
+
+    def test_time_slices(self):  # check the time sliced occupancy history against numpy for read out and time slices, the ring and the parallel histogramming
+        random_state = np.random.RandomState(0)
+        hits = np.zeros(shape=(20000, ), dtype=tb.dtype_from_descr(data_struct.HitInfoTable))
+        hits['event_number'] = np.sort(random_state.randint(0, 1000, size=20000))
+        hits['column'] = random_state.randint(1, 81, size=20000)
+        hits['row'] = random_state.randint(1, 337, size=20000)
+        hits['tot'] = random_state.randint(0, 15, size=20000)  # ToT 14 is no hit
+        meta_event_index = np.arange(0, 1000, 10).astype(np.uint64)  # 100 read outs
+        meta_data = np.zeros(shape=(100, ), dtype=tb.dtype_from_descr(data_struct.MetaTableV2))
+        meta_data['timestamp_start'] = 1000. + np.arange(100) * 0.5
+        meta_data['timestamp_stop'] = meta_data['timestamp_start'] + 0.5
+        selected_hits = hits[hits['tot'] <= 13]
+        read_out = selected_hits['event_number'] // 10
+        for n_threads, slice_length, n_slices in itertools.product((1, 4), (0, 2.), (1000, 10)):
+            histograming = PyDataHistograming()
+            histograming.set_n_threads(n_threads, min_hits_per_thread=1000)
+            histograming.create_occupancy_hist(True)
+            histograming.set_no_scan_parameter()
+            histograming.add_meta_event_index(meta_event_index, meta_event_index.shape[0])
+            histograming.set_meta_time_stamps(meta_data)
+            histograming.set_time_slices(n_slices, slice_length)
+            for chunk_hits in np.array_split(hits, 3):  # the slices continue in the next call
+                histograming.add_hits(chunk_hits)
+            hit_slices = read_out if slice_length == 0 else read_out // 4  # 4 read outs per slice
+            n_all_slices = hit_slices.max() + 1
+            slice_index, timestamp_start, n_hits = histograming.get_time_slices()
+            np.testing.assert_array_equal(slice_index, np.arange(max(0, n_all_slices - n_slices), n_all_slices))
+            np.testing.assert_array_equal(timestamp_start, 1000. + slice_index * (0.5 if slice_length == 0 else slice_length))
+            np.testing.assert_array_equal(n_hits, np.bincount(hit_slices, minlength=n_all_slices)[slice_index])
+            for first_slice, last_slice in ((0, len(slice_index)), (2, 5), (3, 3)):
+                occupancy, tot_sum = histograming.get_time_slice_occupancy(first_slice, last_slice)
+                window_hits = selected_hits[(hit_slices >= slice_index[0] + first_slice) & (hit_slices < slice_index[0] + last_slice)]
+                expected_occupancy, _, _ = np.histogram2d(window_hits['column'] - 1, window_hits['row'] - 1, bins=(80, 336), range=((0, 80), (0, 336)))
+                expected_tot_sum, _, _ = np.histogram2d(window_hits['column'] - 1, window_hits['row'] - 1, bins=(80, 336), range=((0, 80), (0, 336)), weights=window_hits['tot'])
+                np.testing.assert_array_equal(occupancy, expected_occupancy)
+                np.testing.assert_array_equal(tot_sum, expected_tot_sum)
+            if n_slices == 1000:
+                np.testing.assert_array_equal(histograming.get_time_slice_occupancy()[0], histograming.get_occupancy()[:, :, 0])
+            deserialized_histograming = PyDataHistograming()
+            deserialized_histograming.deserialize(histograming.serialize())
+            for time_slices, deserialized_time_slices in zip(histograming.get_time_slices(), deserialized_histograming.get_time_slices()):
+                np.testing.assert_array_equal(time_slices, deserialized_time_slices)
+            np.testing.assert_array_equal(histograming.get_time_slice_occupancy()[1], deserialized_histograming.get_time_slice_occupancy()[1])
+            with self.assertRaises(IndexError):
+                histograming.get_time_slice_occupancy(0, len(slice_index) + 1)
+            histograming.reset()
+            self.assertEqual(len(histograming.get_time_slices()[0]), 0)
+
+    def test_tdc_pixel_hist(self):  # check the sparse tdc pixel histogram against numpy for the full and a rebinned TDC range
+        hits = np.zeros(shape=(4000, ), dtype=tb.dtype_from_descr(data_struct.HitInfoTable))
+        hits['column'] = np.arange(4000) % 5 + 1
+        hits['row'] = np.arange(4000) % 3 + 1
+        hits['TDC'] = np.random.RandomState(0).randint(0, 4096, size=4000)
+        hits['event_status'] = 256  # single hit events with one TDC word
+        hits['event_status'][::10] |= 8192  # more than one hit, no TDC value
+        tdc_hits = hits[hits['event_status'] == 256]
+        expected = np.zeros(shape=(80, 336, 4096), dtype=np.uint16)
+        np.add.at(expected, (tdc_hits['column'] - 1, tdc_hits['row'] - 1, tdc_hits['TDC']), 1)
+        results = []
+        for n_threads in (1, 4):
+            histograming = PyDataHistograming()
+            histograming.set_n_threads(n_threads, min_hits_per_thread=100)
+            histograming.create_tdc_pixel_hist(True)
+            histograming.set_no_scan_parameter()
+            histograming.add_hits(hits)
+            self.assertTrue(np.all(histograming.get_tdc_pixel_hist() == expected))
+            results.append([array.copy() for array in histograming.get_tdc_pixel_hist_entries()])
+            histograming.set_tdc_pixel_hist_range(1000, 2000, 100)  # ten bins, resets the histogram
+            histograming.add_hits(hits)
+            selection = (tdc_hits['TDC'] >= 1000) & (tdc_hits['TDC'] < 2000)
+            expected_rebinned = np.zeros(shape=(80, 336, 10), dtype=np.uint16)
+            np.add.at(expected_rebinned, (tdc_hits['column'][selection] - 1, tdc_hits['row'][selection] - 1, (tdc_hits['TDC'][selection] - 1000) // 100), 1)
+            self.assertTrue(np.all(histograming.get_tdc_pixel_hist() == expected_rebinned))
+            histograming.take_snapshot()
+            self.assertTrue(np.all(histograming.get_tdc_pixel_hist(snapshot=True) == expected_rebinned))
+            self.assertRaises(ValueError, histograming.set_tdc_pixel_hist_range, 0, 5000)
+        column, row, tdc_bin, count = results[0]
+        self.assertEqual(count.sum(), tdc_hits.shape[0])
+        self.assertTrue(np.all(expected[column, row, tdc_bin] == count))
+        for result, parallel_result in zip(results[0], results[1]):
+            self.assertTrue(np.all(result == parallel_result))
+        histograming = PyDataHistograming()  # the dense histogram saturates, the entries have the full counts
+        histograming.create_tdc_pixel_hist(True)
+        histograming.set_no_scan_parameter()
+        for _ in range(70):
+            histograming.add_hits(np.repeat(tdc_hits[:1], 1000))
+        self.assertEqual(histograming.get_tdc_pixel_hist()[tdc_hits['column'][0] - 1, tdc_hits['row'][0] - 1, tdc_hits['TDC'][0]], 65535)
+        self.assertListEqual(histograming.get_tdc_pixel_hist_entries()[3].tolist(), [70000])
+
+    def test_concurrent_interpreters(self):  # check that interpreters and histograms in different threads do not share state
+        raw_data = []
+        for trigger_number in range(0, 300, 3):
+            raw_data.extend([0x80000000 | trigger_number, 0x00E90000] + [(column << 17) | (1 << 8) | (1 << 4) | 0xF for column in range(1, 4)] +
+                            [0x80000000 | (trigger_number + 1), 0x00E90001, (5 << 17) | (2 << 8) | 0x23, 0x80000000 | (trigger_number + 2), 0x00E90002])
+        raw_data = np.array(raw_data, np.uint32)
+
+        def analyze(results, index):
+            interpreter = PyDataInterpreter()
+            histograming = PyDataHistograming()
+            interpreter.set_trig_count(1)
+            interpreter.set_warning_output(False)
+            histograming.set_no_scan_parameter()
+            histograming.create_occupancy_hist(True)
+            for _ in range(10):
+                interpreter.interpret_raw_data(raw_data)
+                histograming.add_hits(interpreter.get_hits())
+            interpreter.store_event()
+            results[index] = (interpreter.get_n_events(), interpreter.get_n_hits(), histograming.get_occupancy().copy())
+
+        results = [None] * 5
+        analyze(results, 0)
+        threads = [threading.Thread(target=analyze, args=(results, index)) for index in range(1, len(results))]
+        for thread in threads:
+            thread.start()
+        for thread in threads:
+            thread.join()
+        for result in results[1:]:
+            self.assertEqual(result[:2], results[0][:2])
+            self.assertTrue(np.all(result[2] == results[0][2]))
+
+    def test_simd_version(self):  # check that all kernels use the instruction set selected at import time
+        simd_version = analysis_functions.get_simd_version()
+        self.assertIn(simd_version, ['baseline', 'SSE2', 'AVX2'])
+        self.assertEqual(PyDataInterpreter().get_simd_version(), simd_version)
+        self.assertEqual(PyDataHistograming().get_simd_version(), simd_version)
+
     def test_analysis_utils_in1d_events(self):  # check compiled get_in1d_sorted function
         event_numbers = np.array([[0, 0, 2, 2, 2, 4, 5, 5, 6, 7, 7, 7, 8], [0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0]], dtype=np.int64)
         event_numbers_2 = np.array([1, 1, 1, 2, 2, 2, 4, 4, 4, 7], dtype=np.int64)
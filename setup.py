@@ -14,8 +14,9 @@ from Cython.Build import cythonize
 import numpy as np
 import os
 
-copt = {'msvc': ['-Ipybar_fei4_interpreter/external', '/EHsc']}  # Set additional include path and EHsc exception handling for VS
-lopt = {}
+copt = {'msvc': ['-Ipybar_fei4_interpreter/external', '/EHsc'],  # Set additional include path and EHsc exception handling for VS
+        'unix': ['-pthread']}  # POSIX threads for the parallel interpretation
+lopt = {'unix': ['-pthread']}
 
 
 class build_ext_opt(build_ext):
@@ -35,7 +36,7 @@ class build_ext_opt(build_ext):
 
 
 extensions = [
-    Extension('pybar_fei4_interpreter.data_interpreter', ['pybar_fei4_interpreter/data_interpreter.pyx', 'pybar_fei4_interpreter/Interpret.cpp', 'pybar_fei4_interpreter/Basis.cpp']),
+    Extension('pybar_fei4_interpreter.data_interpreter', ['pybar_fei4_interpreter/data_interpreter.pyx', 'pybar_fei4_interpreter/Interpret.cpp', 'pybar_fei4_interpreter/OnlineInterpret.cpp', 'pybar_fei4_interpreter/Histogram.cpp', 'pybar_fei4_interpreter/Basis.cpp']),
     Extension('pybar_fei4_interpreter.data_histograming', ['pybar_fei4_interpreter/data_histograming.pyx', 'pybar_fei4_interpreter/Histogram.cpp', 'pybar_fei4_interpreter/Basis.cpp']),
     Extension('pybar_fei4_interpreter.analysis_functions', ['pybar_fei4_interpreter/analysis_functions.pyx'])
 ]